@@ -2,16 +2,13 @@
 #define AICONTROLLER_HPP
 
 #include "IController.hpp"
+#include "AIParams.hpp"
+#include "UtilityAI.hpp"
 #include "raylib.h"
 #include <vector>
 #include "core/spaceship.hpp"
 #include "core/mathUtils.hpp"
-
-enum class AIMode {
-    Offensive,
-    Defensive,
-    Nuetral
-};
+#include "core/Random.hpp"
 
 enum class ThreatType {
     None,
@@ -23,6 +20,7 @@ class AIController : public IController {
 private:
     Spaceship* self;
     Spaceship* enemy;
+    Spaceship* firstEnemy;             // As made, for Reset
     float shootCooldown;
     float energyCooldown;
     float separationFromEnemy = 600;
@@ -30,9 +28,15 @@ private:
     bool isDodging;
     Vector2 dodgeDir;
     ThreatType currentThreat;
-    AIMode mode;
+    int behaviour;                     // Index into behaviours, chosen every think
+    Vector2 plannedMove;               // The behaviour's movement this think, which dodges lean toward
+    SimClock clock;
+    Random random;
+    uint64_t seed;
+    AIParams params;
+    UtilityTable behaviours;
 
-    void DecideMode();
+    void ChooseBehaviour();
 
     void HandleShooting(ControlState& state);
     void HandleMovement(ControlState& state);
@@ -47,25 +51,29 @@ private:
     float GetXDistanceToPlayer();
     float GetYDistanceToPlayer();
 
-    bool IsBulletThreat(const Bullet& bullet);
+    // Read the ship's threat cache, filled in by the world each tick
     bool AnyBulletThreatAhead();
-    bool IsBulletThreatAtY(const Bullet& bullet, float newY);
-
     bool AnyEnergyThreatAhead();
 
     void UpdateThreatType();
 
+    // Each decides whether the ship dodges, then leaves where to to FindSafestDirection
     bool ComputeDodgeForEnergy(Vector2& outDir);
     bool ComputeDodgeForBullet(Vector2& outDir);
+    bool FindSafestDirection(Vector2& outDir);
     void UpdateDodgeDir();
 
     bool TryDodge(ControlState& state);
 
 
 public:
-    AIController(Spaceship* selfShip, Spaceship* enemyShip);
+    AIController(Spaceship* selfShip, Spaceship* enemyShip, uint64_t seed, const AIParams& aiParams = AIParams());
 
-    ControlState GetState() override;
+    ControlState GetState(const SimClock& simClock) override;
+    void SaveState(ByteWriter& out) const override;
+    void LoadState(ByteReader& in) override;
+    void Reset() override;
+    bool AllowsThinkSkipping() const override;
 };
 
 #endif
@@ -0,0 +1,51 @@
+#ifndef AIPARAMS_HPP
+#define AIPARAMS_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct UtilityDefinition;
+
+// Everything AIController weighs up that is a matter of taste rather than
+// rules. The defaults are the hand tuned values. Per mode values are the
+// default behaviours' (see UtilityDefinition), in the order offensive,
+// defensive, neutral.
+struct AIParams {
+    float shootCooldown[3] = {0.2f, 0.5f, 0.4f};   // Seconds between bullets
+    float energyCooldown[3] = {2.5f, 6.0f, 4.0f};  // Seconds between energy weapons
+    float separation[3] = {600.0f, 800.0f, 400.0f}; // Preferred distance across from the enemy
+    float dodgeWeight[3] = {0.5f, 1.0f, 0.75f};    // How much of a dodge wins over the mode's movement
+
+    float defensiveHealthRatio = 0.8f; // Defensive below this fraction of the enemy's health
+    float nearBulletWindow = 1.5f;     // Seconds. Won't move into the path of bullets this close
+    float bulletDodgeWindow = 2.0f;    // Seconds. Dodges bullets this close, at most bulletThreatWindow
+    float verticalDeadZone = 20.0f;    // Pixels off the enemy's height that count as level with it
+
+    float energyReactionTime = 0.2f;   // Seconds an energy weapon flies before it is dodged
+    float energyDodgeChance = 0.7f;    // Of dodging one on any tick
+    float energyAlignment = 0.3f;      // How directly it must head at the ship to be dodged
+    float bulletDodgeCooldown = 1.0f;  // Seconds before another dodge, give or take 0.2
+    float energyDodgeCooldown = 1.2f;
+
+    // What the AI chooses between and how. Null plays DefaultUtilityDefinition().
+    // Not saved, and not searched by the tuner
+    std::shared_ptr<const UtilityDefinition> behaviours;
+
+    // Name value lines, as the tuner writes them. Names left out keep
+    // their defaults, unknown names fail the load
+    bool Save(const std::string& path) const;
+    bool Load(const std::string& path);
+};
+
+// One tunable number in AIParams and the range it is searched over
+struct AIParamInfo {
+    const char* name;
+    float min;
+    float max;
+    float& (*field)(AIParams& params);
+};
+
+const std::vector<AIParamInfo>& AIParamTable();
+
+#endif
@@ -1,6 +1,12 @@
 #ifndef ICONTROLLER_HPP
 #define ICONTROLLER_HPP
 
+#include "core/SimClock.hpp"
+#include "core/ByteStream.hpp"
+#include <cmath>
+
+class JobSystem;
+
 struct ControlState {
     float moveX = 0.0f; // -1 = left, 1 = right
     float moveY = 0.0f; // -1 = up, 1 = down
@@ -8,10 +14,54 @@ struct ControlState {
     bool shootEnergy = false;
 };
 
+// Ships act on movement at 8 bit precision, so a replay can store exactly
+// what the simulation used
+inline float QuantizeAxis(float value) {
+    float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return std::round(clamped * 127.0f) / 127.0f;
+}
+
+inline ControlState QuantizeControl(ControlState state) {
+    state.moveX = QuantizeAxis(state.moveX);
+    state.moveY = QuantizeAxis(state.moveY);
+    return state;
+}
+
+// Work many controllers share, which the world runs once a tick before any
+// ship thinks, such as one batched inference for every ship playing the
+// same policy. Runs alone, so it may spread itself over jobs (null when the
+// world runs single threaded)
+class ThinkBatch {
+    public:
+        virtual ~ThinkBatch() = default;
+        virtual void Run(const SimClock& clock, JobSystem* jobs) = 0;
+};
+
 class IController {
     public:
         virtual ~IController() = default;
-        virtual ControlState GetState() = 0;
+        virtual ControlState GetState(const SimClock& clock) = 0;
+
+        // Called once per rendered frame, which may run zero or several sim ticks.
+        // Controllers that read one-frame input events latch them here.
+        virtual void PollInput() {}
+
+        // Internal state, for snapshots and rollback. Stateless controllers keep the defaults
+        virtual void SaveState(ByteWriter& out) const { (void)out; }
+        virtual void LoadState(ByteReader& in) { (void)in; }
+
+        // Back to the state it was made in, for a match starting over, so
+        // every episode plays out the same from the same seed
+        virtual void Reset() {}
+
+        // Whether the world may skip calls to GetState when the AI is over
+        // budget, in which case the ship carries on moving as it last chose
+        // and GetState's clock covers every tick since the last call
+        virtual bool AllowsThinkSkipping() const { return false; }
+
+        // Run by the world ahead of this tick's GetState. Controllers
+        // sharing a batch return the same one and it runs once
+        virtual ThinkBatch* GetThinkBatch() { return nullptr; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef LOOKAHEADCONTROLLER_HPP
+#define LOOKAHEADCONTROLLER_HPP
+
+#include "IController.hpp"
+#include "AIController.hpp"
+#include "raylib.h"
+#include "core/spaceship.hpp"
+#include "core/Lookahead.hpp"
+#include <memory>
+#include <vector>
+
+struct LookaheadStats {
+    long plans = 0;         // Ticks it searched on
+    long rollouts = 0;
+    double seconds = 0.0;   // Wall time spent searching, for reporting only
+    double modelledSeconds = 0.0; // What the searches cost by the rollout cost model, to check it against
+    double worstSeconds = 0.0;
+    long overBudget = 0;    // Searches that took longer than LOOKAHEAD_BUDGET_US
+};
+
+// The hard AI. Plays like AIController, which it asks every tick, but while
+// an enemy projectile may reach its ship it forks the world into a
+// LookaheadSim and plays candidate moves out for a short horizon, keeping
+// the one that takes the least damage and deals the most. Searches stop
+// once the next rollout would go over LOOKAHEAD_BUDGET_US. The budget is
+// counted in simulated work rather than wall time, so the same match
+// always makes the same choices, with a rollout's cost calibrated against
+// measured search times (see LookaheadStats::modelledSeconds).
+class LookaheadController : public IController {
+public:
+    // ships is the world's, to fork enemies from. enemy and params as for AIController
+    LookaheadController(Spaceship* selfShip, Spaceship* enemyShip, const std::vector<std::unique_ptr<Spaceship>>& worldShips, uint64_t seed, const AIParams& params = AIParams());
+
+    ControlState GetState(const SimClock& simClock) override;
+    void SaveState(ByteWriter& out) const override;
+    void LoadState(ByteReader& in) override;
+    void Reset() override;
+
+    const LookaheadStats& GetStats() const;
+
+private:
+    // Move one way for the first half of the horizon and another for the rest
+    struct Candidate {
+        Vector2 first;
+        Vector2 then;
+    };
+
+    void Plan(const SimClock& clock, const ControlState& suggested);
+    float Rollout(const Candidate& candidate);
+
+    AIController ai;
+    Spaceship* self;
+    const std::vector<std::unique_ptr<Spaceship>>& ships;
+    LookaheadSim root;  // The world as the search starts
+    LookaheadSim fork;  // Copied from root for each rollout
+    std::vector<Candidate> candidates;
+
+    Vector2 plan = {0.0f, 0.0f};
+    bool overriding = false; // Whether plan replaces the AI's movement
+    int ticksUntilPlan = 0;
+    LookaheadStats stats;
+};
+
+#endif
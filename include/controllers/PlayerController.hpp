@@ -14,10 +14,18 @@ class PlayerController : public IController {
         float moveY = 0.0f;
         float rampSpeed = 6.5f;
 
+        // Presses seen since the last tick, so a frame without a tick doesn't drop them
+        bool shootBulletPressed = false;
+        bool shootEnergyPressed = false;
+
     public:
         PlayerController(const std::vector<int>& move, int shootBullet, int shootEnergy);
 
-        ControlState GetState() override;
+        ControlState GetState(const SimClock& clock) override;
+        void PollInput() override;
+        void SaveState(ByteWriter& out) const override;
+        void LoadState(ByteReader& in) override;
+        void Reset() override;
 };
 
 #endif
\ No newline at end of file
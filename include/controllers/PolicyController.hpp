@@ -0,0 +1,61 @@
+#ifndef POLICYCONTROLLER_HPP
+#define POLICYCONTROLLER_HPP
+
+#include "IController.hpp"
+#include "core/spaceship.hpp"
+#include "core/Policy.hpp"
+#include <memory>
+#include <vector>
+
+class PolicyController;
+
+// Every ship playing one policy on one side. Each tick it observes all of
+// them and runs the policy once over the whole batch, and each
+// controller's GetState reads back its row.
+class PolicyBatch : public ThinkBatch {
+public:
+    // Outputs a policy must have: moveX, moveY, then the bullet and energy
+    // weapon triggers, fired when positive
+    static const int outputs = 4;
+
+    // policy must take observation::size inputs and give outputs outputs
+    explicit PolicyBatch(std::shared_ptr<const Policy> policy);
+
+    void Run(const SimClock& clock, JobSystem* jobs) override;
+
+private:
+    friend class PolicyController;
+
+    std::shared_ptr<const Policy> policy;
+    std::vector<PolicyController*> members; // In the order they were made
+    std::vector<PolicyController*> rows;    // Members observed this tick
+    std::vector<float> observations;
+    PolicyScratch scratch;
+    const float* results = nullptr;
+};
+
+// Plays a trained policy. Sees what VecEnv shows a learner, so a policy
+// trained there drops in for AIController on either side.
+class PolicyController : public IController {
+public:
+    // enemy is null in the arena, where the ship fights its target
+    PolicyController(Spaceship* selfShip, Spaceship* enemyShip, std::shared_ptr<PolicyBatch> batch);
+    ~PolicyController();
+
+    PolicyController(const PolicyController&) = delete;
+    PolicyController& operator=(const PolicyController&) = delete;
+
+    ControlState GetState(const SimClock& clock) override;
+    ThinkBatch* GetThinkBatch() override;
+
+private:
+    friend class PolicyBatch;
+
+    Spaceship* self;
+    Spaceship* enemy;
+    float fullHealth;
+    std::shared_ptr<PolicyBatch> batch;
+    int row = -1; // In the batch's last run, -1 if it had no enemy to observe
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef UTILITYAI_HPP
+#define UTILITYAI_HPP
+
+#include "AIParams.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a ship knows when it picks a behaviour. Considerations read these
+enum class UtilityInput : uint8_t {
+    Health,        // Own health
+    EnemyHealth,
+    HealthRatio,   // Own health over the enemy's
+    HealthLead,    // Own health minus the enemy's
+    DistanceX,     // Pixels between the ships' centers, across
+    DistanceY,     // and up or down
+    BulletThreats, // Bands of incoming bullets, see ShipThreats
+    EnergyThreats, // Energy weapons close by
+    BulletsLeft,   // Fractions of the ship's limits not in flight
+    EnergyLeft,
+    Count
+};
+
+// Maps an input to [0, 1], after clamping. x is the input
+enum class ResponseCurve : uint8_t {
+    Linear,     // m * (x - c) + b
+    Polynomial, // m * (x - c)^k + b
+    Logistic,   // k / (1 + e^(-m * (x - c))) + b
+    StepAbove,  // k if x > c, else b
+    StepBelow   // k if x < c, else b
+};
+
+// A number in a behaviour file: a literal, or $name for that AIParams entry,
+// so the tuner's values reach behaviours that ask for them
+struct UtilityValue {
+    float value = 0.0f;
+    std::string param;
+};
+
+struct UtilityConsideration {
+    UtilityInput input;
+    ResponseCurve curve;
+    UtilityValue m, k, b, c;
+};
+
+// One way to play. Its score is its weight times every consideration
+struct UtilityBehaviour {
+    std::string name;
+    UtilityValue weight;
+    std::vector<UtilityConsideration> considerations;
+
+    UtilityValue shootCooldown;  // Seconds between bullets
+    UtilityValue energyCooldown; // Seconds between energy weapons
+    UtilityValue separation;     // Preferred distance across from the enemy
+    UtilityValue dodgeWeight;    // How much of a dodge wins over the behaviour's movement
+    bool strictCooldowns = false; // Waits for a cooldown to pass zero rather than reach it
+};
+
+// Behaviours as a designer wrote them, see assets/ai/behaviours.txt for the
+// format. Load checks every name, so a loaded definition always compiles
+struct UtilityDefinition {
+    std::vector<UtilityBehaviour> behaviours;
+
+    // On failure says which line and why in error
+    bool Load(const std::string& path, std::string& error);
+};
+
+// AI_BEHAVIOURS_PATH, loaded once. The game can't play without it, so a
+// broken file is reported and ends the program
+const UtilityDefinition& DefaultUtilityDefinition();
+
+// A definition with every value looked up in one AIParams, laid out flat
+// for scoring. Behaviours are held highest weight first, so Choose stops
+// looking once no later one can beat the best so far; ties go to the
+// higher weight, then to the one listed first.
+class UtilityTable {
+public:
+    UtilityTable(const UtilityDefinition& definition, const AIParams& params);
+
+    // The best behaviour for inputs, indexed by UtilityInput
+    int Choose(const float* inputs) const;
+    int Size() const;
+
+    // Per behaviour, by Choose's index
+    std::vector<std::string> names;
+    std::vector<float> shootCooldown;
+    std::vector<float> energyCooldown;
+    std::vector<float> separation;
+    std::vector<float> dodgeWeight;
+    std::vector<uint8_t> strictCooldowns;
+
+private:
+    struct Consideration {
+        uint8_t input;
+        uint8_t curve;
+        float m, k, b, c;
+    };
+
+    std::vector<float> weight;
+    std::vector<int> firstConsideration; // Behaviour i's are [first[i], first[i + 1])
+    std::vector<Consideration> considerations;
+};
+
+#endif
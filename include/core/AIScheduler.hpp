@@ -0,0 +1,54 @@
+#ifndef AISCHEDULER_HPP
+#define AISCHEDULER_HPP
+
+#include "spaceship.hpp"
+#include "ByteStream.hpp"
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Decides which AI ships think on each tick so the AI stays within
+// AI_THINK_BUDGET_US however many ships there are. While the budget allows,
+// every ship thinks every tick. Past it, the ships whose next threat is
+// furthest off think every few ticks, staggered by id, acting on the
+// movement they last chose in between. Only controllers that allow it are
+// ever skipped.
+//
+// The budget is counted in thinks at a calibrated cost rather than measured,
+// so a match schedules the same way on every machine and every run.
+class AIScheduler {
+public:
+    void Resize(int shipCount);
+
+    // Microseconds a tick may spend on AI that can be skipped. 0 never skips
+    void SetBudget(float microseconds);
+
+    // Picks the ships that think this tick. Reads the threats and targets
+    // the tick has already worked out
+    void Schedule(const std::vector<std::unique_ptr<Spaceship>>& ships, long tick);
+
+    bool Thinks(int ship) const;
+    int TicksCovered(int ship) const; // Ticks since it last thought, this one included
+
+    // Ticks each ship thought on and skipped, over the scheduler's lifetime
+    long ThoughtCount(int ship) const;
+    long SkippedCount(int ship) const;
+
+    // When each ship last thought. Needed to pick up a saved match on the same schedule
+    void SaveState(ByteWriter& out) const;
+    bool LoadState(ByteReader& in);
+
+private:
+    float TimeToThreat(const Spaceship& ship) const;
+
+    float budgetMicroseconds = AI_THINK_BUDGET_US;
+    std::vector<std::pair<float, int>> ranked; // Seconds to the next threat and ship id
+    std::vector<int> interval;
+    std::vector<int> ticksSinceThink;
+    std::vector<int> covered;
+    std::vector<uint8_t> thinks;
+    std::vector<long> thought;
+    std::vector<long> skipped;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef ASSETARCHIVE_HPP
+#define ASSETARCHIVE_HPP
+
+#include "raylib.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Every image and sound the game loads, already decoded, in one file made
+// by `main --pack-assets`. A header and index come first, then each asset's
+// pixels or samples, starting on a page boundary:
+//
+//   u32 magic, u32 version, u32 entry count, u32 index size
+//   per entry: u16 path length, path, u8 kind, u32 x4 of Image or Wave
+//              fields, u64 offset, u64 size
+//
+// Images are RGBA8 and sounds PCM as raylib decoded them, so loading one is
+// handing raylib a pointer into the mapped file.
+class AssetArchive {
+public:
+    AssetArchive() = default;
+    ~AssetArchive();
+
+    AssetArchive(const AssetArchive&) = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    // Maps the whole file read only. False, leaving the archive closed, if
+    // it can't or the file isn't an archive of this version
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const;
+
+    // The asset packed from path. The data points into the mapping, so is
+    // only valid until Close, and must be copied before raylib changes it
+    // (ImageFormat, ImageResize and the like free what they are given)
+    bool FindImage(const std::string& path, Image& image) const;
+    bool FindWave(const std::string& path, Wave& wave) const;
+
+    std::vector<std::string> Paths() const; // Of every asset, as packed
+    size_t MappedBytes() const;
+
+private:
+    enum class Kind : uint8_t {
+        Image,
+        Wave
+    };
+
+    struct Entry {
+        std::string path;
+        Kind kind;
+        uint32_t fields[4]; // width, height, mipmaps, format or frameCount, sampleRate, sampleSize, channels
+        const uint8_t* data;
+        uint64_t size;
+    };
+
+    const Entry* Find(const std::string& path, Kind kind) const;
+
+    std::vector<Entry> entries; // By path
+    const uint8_t* mapping = nullptr;
+    size_t mappedSize = 0;
+};
+
+// Decodes every .png, .wav, .mp3 and .ogg in directories into an archive
+bool PackAssets(const std::vector<std::string>& directories, const std::string& archivePath);
+
+// Entry points for `main --pack-assets ...` and `main --bench-load ...`
+int RunPackCommand(int argc, char** argv);
+int RunLoadBenchCommand(int argc, char** argv);
+
+#endif
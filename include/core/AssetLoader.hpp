@@ -0,0 +1,56 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include "JobSystem.hpp"
+#include "ResourceManager.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Loads assets while frames keep coming. Each is decoded on a job system
+// worker as soon as it is queued, then uploaded by Update on the window's
+// thread, as many a frame as fit in its budget. Assets are ready one by one,
+// so whatever needs only some of them can start before the rest are.
+class AssetLoader {
+public:
+    AssetLoader(JobSystem& jobs, ResourceManager& resources);
+    ~AssetLoader(); // Waits for decodes still running, and drops what they made
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // As ResourceManager loads them. Each is ready once
+    // ResourceManager::IsLoaded says so
+    void QueueTexture(TextureHandle handle, const std::string& filepath, float drawScale = 0.0f);
+    void QueueSound(SoundHandle handle, const std::string& filepath);
+
+    // Other work in the same two halves, e.g. packing the texture atlas.
+    // decode must not touch the GPU or audio device
+    void QueueWork(std::function<void()> decode, std::function<void()> upload);
+
+    // Uploads whatever has decoded, until budget seconds have gone. At least
+    // one upload happens when any is waiting
+    void Update(double budget);
+    void Finish(); // Waits for everything queued and uploads it
+
+    bool IsDone() const;
+    float Progress() const; // Of everything queued so far, from 0 to 1
+
+private:
+    struct Item {
+        std::function<void()> decode;
+        std::function<void()> upload;
+        std::atomic<bool> decoded{false};
+        bool uploaded = false;
+    };
+
+    JobSystem& jobs;
+    ResourceManager& resources;
+    std::vector<std::unique_ptr<Item>> items; // Pointers, as workers hold them while the vector grows
+    std::atomic<int> pending{0};              // Decodes not yet finished
+    int uploaded = 0;
+};
+
+#endif
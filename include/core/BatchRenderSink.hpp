@@ -0,0 +1,65 @@
+#ifndef BATCHRENDERSINK_HPP
+#define BATCHRENDERSINK_HPP
+
+#include "raylib.h"
+#include "rlgl.h"
+#include "IRenderSink.hpp"
+#include "TextureAtlas.hpp"
+#include <cstdint>
+#include <vector>
+
+// Collects a frame's sprites and shapes as quads and draws them all at once,
+// sorted by layer and then texture, through its own render batch, drawn
+// every RENDER_BATCH_QUADS quads. Sprites of textures aliased in the atlas
+// and every untextured shape come from the atlas texture, so a frame is a
+// single batch of a single texture until it has more quads than that. Owns
+// GPU buffers, so it is made after the window opens and destroyed before it
+// closes.
+class BatchRenderSink : public IRenderSink {
+    public:
+        explicit BatchRenderSink(const TextureAtlas& atlas);
+        ~BatchRenderSink();
+
+        BatchRenderSink(const BatchRenderSink&) = delete;
+        BatchRenderSink& operator=(const BatchRenderSink&) = delete;
+
+        void SetLayer(RenderLayer layer) override;
+        void DrawSprite(const Texture2D& texture, Rectangle src, Rectangle dest, Vector2 origin, float rotation, Color tint) override;
+        void DrawRect(Rectangle rect, Color color) override;
+        void DrawRectLines(Rectangle rect, float thickness, Color color) override;
+        void DrawCircle(Vector2 center, float radius, Color color) override;
+
+        // Draws everything collected since the last flush over what raylib
+        // has drawn so far, and starts the layers again from the bottom
+        void Flush();
+
+        // Of the last flush. Batch draws are the ones the sink asked rlgl
+        // for. rlgl makes a draw call for each texture in a batch, and may
+        // split one with many textures, so those are not counted here
+        int LastQuads() const;
+        int LastBatchDraws() const;
+
+    private:
+        // Corners go top left, bottom left, bottom right, top right, as raylib winds them
+        struct Quad {
+            uint64_t key; // Layer, then texture id
+            Vector2 position[4];
+            Vector2 texcoord[4];
+            Color color;
+        };
+
+        Quad& AddQuad(unsigned int textureId, Color color);
+        void AddSolid(const Vector2* corners, Color color);
+        void DrawBatch();
+
+        const TextureAtlas& atlas;
+        rlRenderBatch batch;
+        RenderLayer layer = RenderLayer::Ground;
+        std::vector<Quad> quads;
+        std::vector<uint32_t> order; // Quads by key, when they were added out of order
+        bool sorted = true;
+        int lastQuads = 0;
+        int lastBatchDraws = 0;
+};
+
+#endif
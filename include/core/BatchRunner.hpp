@@ -0,0 +1,46 @@
+#ifndef BATCHRUNNER_HPP
+#define BATCHRUNNER_HPP
+
+#include "Headless.hpp"
+#include <functional>
+#include <vector>
+
+struct BatchOptions {
+    HeadlessOptions match;    // Mode, tick, time limit and seed of every match
+    int threads = 0;          // 0 uses every hardware thread
+    bool progress = true;     // Report progress on stderr while running
+};
+
+// Totals over a batch. Red and yellow are summed over teams, not ships.
+struct BatchStats {
+    int matches = 0;
+    int redWins = 0;
+    int yellowWins = 0;
+    int draws = 0;
+    long ticks = 0;
+    double simTime = 0.0;
+    double redDamage = 0.0;
+    double yellowDamage = 0.0;
+    double wallTime = 0.0;
+
+    void Add(const MatchResult& result);
+    void Merge(const BatchStats& other);
+};
+
+// Plays options.match.matches independent matches spread over worker threads.
+// Every worker builds its own matches, so nothing is shared while they run.
+BatchStats RunBatch(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const BatchOptions& options);
+
+// Sets up match index of a batch, starting from a copy of options.match, and
+// picks its seed. Returns the group its result is counted in
+using BatchSetup = std::function<int(int index, HeadlessOptions& match, uint64_t& seed)>;
+
+// As RunBatch, for total matches that setup can each make different, with
+// the stats of each of groups kept apart
+std::vector<BatchStats> RunBatchGroups(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const BatchOptions& options,
+                                       int total, int groups, const BatchSetup& setup);
+
+// Entry point for `main --batch ...`
+int RunBatchCommand(int argc, char** argv);
+
+#endif
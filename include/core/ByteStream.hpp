@@ -0,0 +1,120 @@
+#ifndef BYTESTREAM_HPP
+#define BYTESTREAM_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Little endian binary writer for replays and snapshots
+class ByteWriter {
+public:
+    void U8(uint8_t value);
+    void U16(uint16_t value);
+    void U32(uint32_t value);
+    void U64(uint64_t value);
+    void F32(float value);
+    void F64(double value);
+
+    // LEB128: 7 bits per byte, so small values take one byte
+    void Varint(uint64_t value);
+    // Zigzag first, so small negative values stay small too
+    void SignedVarint(int64_t value);
+
+    void Bytes(const void* data, size_t size);
+
+    // Overwrites a U32 written earlier at offset, e.g. a size only known afterwards
+    void PatchU32(size_t offset, uint32_t value);
+
+    // Raw copy of the first count elements, for plain arrays of numbers.
+    // Host byte order, which is little endian everywhere the game runs
+    template <typename T>
+    void Array(const std::vector<T>& values, size_t count) {
+        Bytes(values.data(), count * sizeof(T));
+    }
+
+    size_t Size() const;
+    void Clear();
+
+    std::vector<uint8_t> bytes;
+};
+
+// Reads what ByteWriter wrote. Reading past the end returns zeros and sets
+// ok to false instead of throwing, so callers check once at the end.
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size);
+    explicit ByteReader(const std::vector<uint8_t>& bytes);
+
+    uint8_t U8();
+    uint16_t U16();
+    uint32_t U32();
+    uint64_t U64();
+    float F32();
+    double F64();
+    uint64_t Varint();
+    int64_t SignedVarint();
+
+    bool Bytes(void* out, size_t size);
+    const uint8_t* Skip(size_t size); // Null if there aren't size bytes left
+
+    template <typename T>
+    void Array(std::vector<T>& values, size_t count) {
+        if (count > values.size()) {
+            ok = false;
+            return;
+        }
+        Bytes(values.data(), count * sizeof(T));
+    }
+
+    size_t Remaining() const;
+    bool AtEnd() const;
+
+    bool ok = true;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+};
+
+// Packs values of any width from 1 to 32 bits, lowest bit first
+class BitWriter {
+public:
+    void Bits(uint32_t value, int count);
+    void Bit(bool value);
+
+    // Elias gamma: 2n+1 bits for values in [2^n, 2^(n+1)), so 1 costs one bit. value >= 1
+    void Gamma(uint32_t value);
+
+    // Pads the last byte with zeros and returns everything written
+    const std::vector<uint8_t>& Flush();
+    void Clear();
+
+private:
+    std::vector<uint8_t> bytes;
+    uint64_t pending = 0;
+    int pendingBits = 0;
+};
+
+// Reading past the end returns zero bits and sets ok to false
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size);
+
+    uint32_t Bits(int count);
+    bool Bit();
+    uint32_t Gamma();
+
+    bool ok = true;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t bitPos = 0;
+};
+
+bool WriteFileBytes(const std::string& path, const std::vector<uint8_t>& bytes);
+bool ReadFileBytes(const std::string& path, std::vector<uint8_t>& bytes);
+
+#endif
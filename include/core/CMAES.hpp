@@ -0,0 +1,56 @@
+#ifndef CMAES_HPP
+#define CMAES_HPP
+
+#include "ByteStream.hpp"
+#include "Random.hpp"
+#include <cstdint>
+#include <vector>
+
+// Covariance matrix adaptation evolution strategy, after Hansen's tutorial,
+// over the unit cube. Ask for a population, score every member, Tell the
+// scores, repeat. Learns which directions and scales pay off from the
+// members that did best, so it copes with parameters that interact and are
+// scored noisily. Maximizes.
+class CMAES {
+public:
+    // Searches [0, 1]^start.size() from start with initial step sigma
+    CMAES(const std::vector<double>& start, double sigma, int population, uint64_t seed);
+
+    // The next population, clamped into the cube
+    const std::vector<std::vector<double>>& Ask();
+
+    // Scores of the population from the last Ask, in the same order
+    void Tell(const std::vector<double>& scores);
+
+    const std::vector<double>& Mean() const;
+    double Sigma() const;
+    int Generation() const;
+    int Population() const;
+
+    // Everything needed to carry on exactly where it stopped
+    void SaveState(ByteWriter& out) const;
+    bool LoadState(ByteReader& in);
+
+private:
+    void UpdateEigen();
+    double Gaussian();
+
+    int n;
+    int lambda;
+    int mu;
+    std::vector<double> weights;
+    double mueff, cc, cs, c1, cmu, damps, chiN;
+
+    std::vector<double> mean;
+    double sigma;
+    std::vector<double> pc, ps;
+    std::vector<double> C; // n * n, row major, like B
+    std::vector<double> B; // Eigenvectors of C in columns
+    std::vector<double> D; // Square roots of the eigenvalues
+    int generation = 0;
+
+    Random random;
+    std::vector<std::vector<double>> population;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef DANGERFIELD_HPP
+#define DANGERFIELD_HPP
+
+#include "raylib.h"
+#include "config.h"
+#include "ProjectilePool.hpp"
+#include <cstdint>
+#include <vector>
+
+// Side of one danger field cell, in pixels, and the cells over one half of the arena
+const int dangerCellSize = 25;
+const int dangerColumns = (WIDTH / 2 + dangerCellSize - 1) / dangerCellSize;
+const int dangerRows = (HEIGHT + dangerCellSize - 1) / dangerCellSize;
+
+// Bullets fly level, so their danger is kept in finer rows of this height
+// under the same columns. Dodging one takes only a few pixels
+const int bulletDangerRowHeight = 4;
+const int bulletDangerRows = (HEIGHT + bulletDangerRowHeight - 1) / bulletDangerRowHeight;
+
+// Seconds ahead the field looks. Cells nothing reaches sooner hold this
+const float dangerHorizon = 2.0f;
+
+// Energy weapons turn as they fly, so they only count this far ahead
+const float energyDangerHorizon = 1.0f;
+
+// Seconds until an enemy projectile could reach each cell of one team's half
+// of the arena, built once a tick and shared by every ship on the team.
+// Times are worked out from whole cells between a projectile and a cell, so
+// they only change when a projectile crosses into another cell. Build keeps
+// what each row of bullets and the energy weapons were last built from and
+// redoes only the parts whose cells changed. The field depends on nothing
+// but the projectiles, so one built from scratch after loading a state is
+// the same as one kept up to date tick by tick.
+class DangerField {
+public:
+    DangerField();
+
+    void Build(uint8_t team, const Projectiles& projectiles);
+
+    // Soonest danger to any cell area overlaps. Parts of area outside the
+    // half, where the team's ships can't go, count as already dangerous
+    float TimeIn(Rectangle area) const;
+    float TimeAt(int column, int row) const; // Soonest over the cell's bullet rows
+
+    Rectangle CellRect(int column, int row) const;
+
+private:
+    // An enemy bullet, by the column its center is in relative to the half.
+    // Sorted by velocity, then column
+    struct BulletKey {
+        float vx;
+        int column;
+
+        bool operator<(const BulletKey& other) const;
+        bool operator==(const BulletKey& other) const;
+    };
+
+    void BuildBulletRow(int row);
+    void BuildEnergy();
+
+    float left = 0.0f;                      // Of the half, in pixels
+    std::vector<float> bulletTimes;         // By column, then bullet row, as a ship spans few columns
+    std::vector<float> energyTimes;         // By row, then column
+    std::vector<BulletKey> rowKeys[bulletDangerRows];    // What each bullet row was built from
+    std::vector<BulletKey> newRowKeys[bulletDangerRows]; // This tick's, swapped in when they differ
+    std::vector<int> energyKeys;                   // Cells of enemy energy weapons in reach, packed
+    std::vector<int> newEnergyKeys;
+    std::vector<float> energyStamp; // Time from an energy weapon to a cell, by offset in cells
+};
+
+#endif
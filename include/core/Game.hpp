@@ -3,7 +3,16 @@
 
 #include "raylib.h"
 #include "ResourceManager.hpp"
-#include "spaceship.hpp"
+#include "Match.hpp"
+#include "RaylibSinks.hpp"
+#include "BatchRenderSink.hpp"
+#include "TextureAtlas.hpp"
+#include "AssetLoader.hpp"
+#include "JobSystem.hpp"
+#include "Replay.hpp"
+#include "Rollback.hpp"
+#include "Spectator.hpp"
+#include "controllers/PlayerController.hpp"
 #include "ui/UIManager.hpp"
 #include "ui/UIElements/Button.hpp"
 #include "ui/UIElements/StaticText.hpp"
@@ -12,26 +21,18 @@
 #include "ui/UIElements/Image.hpp"
 #include "ui/UIElements/Slider.hpp"
 #include <string>
+#include <memory>
 
 
 enum class GameState {
+    Loading, // Until the menu's assets are up
     Menu,
     Playing,
     GameOver,
     Settings,
-    StoryMode
-};
-
-enum class GameMode {
-    NoPlayer, 
-    SinglePlayer,
-    TwoPlayer
-};
-
-enum class Winner {
-    None,
-    Red,
-    Yellow
+    StoryMode,
+    Connecting,
+    Spectating
 };
 
 class Game {
@@ -41,10 +42,21 @@ public:
 
     void Run();
 
+    // Net play, from the command line. Shows a waiting screen until the other side turns up
+    bool HostNetMatch(uint16_t port);
+    bool JoinNetMatch(const NetAddress& host);
+
+    // Watches the matches a `--headless --serve` server is streaming
+    bool Spectate(const NetAddress& server);
+
 private:
     void Update();
     void Render();
     void Reset();
+    void StepMatch(float frameTime);
+    void StepNetMatch(float frameTime);
+    void UpdateLoading(double budget);
+    void FinishLoading();
 
     GameState state;
     Winner winner;
@@ -52,8 +64,34 @@ private:
     ui::UIManager uiManager;
 
     ResourceManager resources;
-    std::unique_ptr<Spaceship> redShip;
-    std::unique_ptr<Spaceship> yellowShip;
+    std::unique_ptr<RaylibAudioSink> audio;
+    TextureAtlas atlas;
+    std::unique_ptr<BatchRenderSink> renderer; // Needs the window, so made once it is open
+    std::unique_ptr<Match> match;
+    std::unique_ptr<ReplayRecorder> recorder; // Only with RECORD_REPLAYS
+    std::unique_ptr<JobSystem> jobs; // Decodes assets while loading, then steps arena matches
+
+    // Only while loading
+    struct Sprite {
+        TextureID id;
+        const char* path;
+        float drawScale;
+    };
+    static const Sprite matchSprites[];
+    std::unique_ptr<AssetLoader> loader;
+    bool atlasQueued = false;
+    bool atlasPacked = false;
+
+    // Only during a net match
+    std::unique_ptr<NetLobby> lobby;
+    std::unique_ptr<GatedAudioSink> netAudio;      // Muted while rollback replays ticks
+    std::unique_ptr<PlayerController> netInput;    // The local player, outside the match so it is never rolled back
+    std::unique_ptr<RollbackSession> netSession;
+
+    std::unique_ptr<SpectatorClient> spectator; // Only while spectating
+
+    float tickAccumulator = 0.0f; // Frame time not yet consumed by fixed sim ticks
+    float renderAlpha = 1.0f;     // Fraction of a tick to interpolate rendering by
 
     std::vector<ui::UIElementID> menuUIElements;
     std::vector<ui::UIElementID> gameOverUIElements;
@@ -62,6 +100,7 @@ private:
     std::vector<ui::UIElementID> storyModeUIElements;
 
     GameState previousState = GameState::Menu;
+    AIDifficulty difficulty = AIDifficulty::Normal; // Of the red AI in single player and AI vs AI
 
     void SetUpUI();
     void SetUIVisibility(const std::vector<ui::UIElementID>& ids, bool visible);
@@ -74,9 +113,14 @@ private:
 
     void HandleTransitionToSettings();
 
-    void UpdatePlayingUI();
+    void UpdatePlayingUI(const Match& shown);
     void UpdateGameOverUI();
+    ShipAssets GetShipAssets(Side side);
     void StartGame(GameMode mode);
+    void StartNetMatch();
+    void EndNetMatch();
+    void StartRecording();
+    void SaveReplay();
 
     void UpdateVolume();
 };
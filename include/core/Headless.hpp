@@ -0,0 +1,76 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include "Match.hpp"
+#include "controllers/LookaheadController.hpp"
+#include "core/TimingHistogram.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+struct HeadlessOptions {
+    int matches = 1;
+    float dt = TICK_DT;             // Fixed tick, same as the windowed game
+    double maxMatchTime = 300.0;    // Simulated seconds before a match is called a draw
+    bool verbose = false;
+    GameMode mode = GameMode::NoPlayer;
+    int shipsPerSide = ARENA_SHIPS_PER_SIDE; // Only used by GameMode::Arena
+    int jobThreads = 1;       // Threads stepping each match. 0 uses every hardware thread
+    uint64_t seed = 1;        // Match i is seeded with Random::MixSeed(seed, i)
+    bool checkDeterminism = false;
+    std::string recordPath;   // Saves a replay of every match when set. Match i goes to path-i past the first
+    AIDifficulty redDifficulty = AIDifficulty::Normal;
+    AIDifficulty yellowDifficulty = AIDifficulty::Normal;
+    AIParams redParams;
+    AIParams yellowParams;
+    std::shared_ptr<const Policy> redPolicy;    // Played instead of the AI when set
+    std::shared_ptr<const Policy> yellowPolicy;
+    bool thinkTimes = false;  // Times every GetState call
+    float aiThinkBudget = AI_THINK_BUDGET_US; // Microseconds, see AIScheduler. 0 never skips a think
+};
+
+// How one kind of controller on one side thought
+struct ThinkReport {
+    TimingHistogram times; // Only with HeadlessOptions::thinkTimes
+    long thought = 0;
+    long skipped = 0;      // Ticks the AI scheduler had it coast
+
+    void Merge(const ThinkReport& other);
+};
+
+struct MatchResult {
+    Winner winner;
+    long ticks;
+    double simTime;
+    float redHealth;     // Summed over the team's surviving ships
+    float yellowHealth;
+    int redAlive;
+    int yellowAlive;
+    float redDamage;     // Dealt by the team over the match
+    float yellowDamage;
+    uint64_t checksum;   // World::Checksum at the end of the match
+    LookaheadStats lookahead; // Summed over the hard AIs
+    std::map<std::string, ThinkReport> thinks; // By side and controller, like "red AI"
+    TimingHistogram thinkStage; // Per tick, only with HeadlessOptions::thinkTimes
+};
+
+// Builds ship assets without a GPU. Only reads the image sizes from disk.
+ShipAssets LoadHeadlessShipAssets(Side side);
+
+// Loads a policy PolicyController can play, or says why not and returns null
+std::shared_ptr<const Policy> LoadHeadlessPolicy(const std::string& path);
+
+// Loads behaviours for AIParams::behaviours, or says why not and returns null
+std::shared_ptr<const UtilityDefinition> LoadHeadlessBehaviours(const std::string& path);
+
+// "red", "yellow" or "draw"
+const char* WinnerName(Winner winner);
+
+// Plays one AI vs AI match, or an AI arena battle, to completion, as fast as the CPU allows.
+MatchResult RunHeadlessMatch(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const HeadlessOptions& options, uint64_t seed, const std::string& replayPath = "");
+
+// Entry point for `main --headless ...`. Never opens a window or audio device.
+int RunHeadless(int argc, char** argv);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef IAUDIOSINK_HPP
+#define IAUDIOSINK_HPP
+
+enum class SoundID {
+    Shoot,
+    Hit,
+    EnergyShoot,
+    Count
+};
+
+// Where the simulation sends its sound effects. The game plays them through
+// raylib, headless runs throw them away.
+class IAudioSink {
+    public:
+        virtual ~IAudioSink() = default;
+        virtual void Play(SoundID id) = 0;
+};
+
+class NullAudioSink : public IAudioSink {
+    public:
+        void Play(SoundID) override {}
+};
+
+// Passes sounds on unless muted, e.g. while rollback replays ticks already heard
+class GatedAudioSink : public IAudioSink {
+    public:
+        explicit GatedAudioSink(IAudioSink& sink) : inner(sink) {}
+        void Play(SoundID id) override {
+            if (!muted) inner.Play(id);
+        }
+
+        bool muted = false;
+
+    private:
+        IAudioSink& inner;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef IRENDERSINK_HPP
+#define IRENDERSINK_HPP
+
+#include "raylib.h"
+#include <cstdint>
+
+// What a draw is part of. Sinks that reorder draws keep lower layers under higher ones
+enum class RenderLayer : uint8_t {
+    Ground, // Under everything, like debug views of the arena
+    Ships,
+    Projectiles
+};
+
+// Where ships and projectiles send their draw calls, so the simulation
+// never talks to the GPU directly.
+class IRenderSink {
+    public:
+        virtual ~IRenderSink() = default;
+
+        // For the draws that follow. Sinks that draw straight away ignore
+        // it, so callers still go from the lowest layer up
+        virtual void SetLayer(RenderLayer layer) { (void)layer; }
+        virtual void DrawSprite(const Texture2D& texture, Rectangle src, Rectangle dest, Vector2 origin, float rotation, Color tint) = 0;
+        virtual void DrawRect(Rectangle rect, Color color) = 0;
+        virtual void DrawRectLines(Rectangle rect, float thickness, Color color) = 0;
+        virtual void DrawCircle(Vector2 center, float radius, Color color) = 0;
+};
+
+class NullRenderSink : public IRenderSink {
+    public:
+        void DrawSprite(const Texture2D&, Rectangle, Rectangle, Vector2, float, Color) override {}
+        void DrawRect(Rectangle, Color) override {}
+        void DrawRectLines(Rectangle, float, Color) override {}
+        void DrawCircle(Vector2, float, Color) override {}
+};
+
+#endif
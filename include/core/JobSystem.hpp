@@ -0,0 +1,99 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Stages of work with explicit dependencies. Built once and run every tick.
+// A task can only depend on tasks added before it, so insertion order is
+// always a valid order to run the graph in on a single thread.
+class TaskGraph {
+public:
+    using TaskID = int;
+
+    TaskID Add(std::function<void()> fn, std::initializer_list<TaskID> dependencies = {});
+    void Clear();
+
+    // Runs every task on the calling thread, in insertion order
+    void RunSerial();
+
+    int Size() const;
+
+private:
+    friend class JobSystem;
+
+    struct Task {
+        std::function<void()> fn;
+        std::vector<TaskID> successors;
+        int dependencyCount = 0;
+        std::atomic<int> remaining{0}; // Dependencies not yet finished in the current run
+    };
+
+    std::deque<Task> tasks; // deque so tasks, and their atomics, never move
+};
+
+// Small work-stealing scheduler. Every thread has its own queue: it pushes
+// and pops new jobs at the back, and idle threads steal from the front of
+// the others. Threads waiting on jobs they spawned run queued jobs meanwhile,
+// so a task may itself call ParallelFor.
+class JobSystem {
+public:
+    // threads counts the calling thread as well. 0 uses every hardware thread
+    explicit JobSystem(int threads = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int ThreadCount() const;
+
+    // Calls fn(begin, end) over [0, count) in chunks of at most grain items and
+    // returns once every chunk has run. The calling thread runs chunks too.
+    void ParallelFor(int count, int grain, const std::function<void(int, int)>& fn);
+
+    // Runs the graph, starting each task as soon as its dependencies finish
+    void Run(TaskGraph& graph);
+
+    // Queues fn for a worker and returns straight away. pending is raised
+    // now and lowered once fn has run. Without workers fn runs here and now
+    void Spawn(std::function<void()> fn, std::atomic<int>& pending);
+
+    // Returns once pending reaches 0, running queued jobs meanwhile
+    void WaitFor(std::atomic<int>& pending);
+
+private:
+    struct Job {
+        std::function<void()> fn;
+        std::atomic<int>* pending; // Decremented once fn returns
+    };
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    int QueueIndex() const;
+    void Push(Job job);
+    bool TryRunOne();
+    void WorkerLoop(int index);
+    void StartTask(TaskGraph& graph, TaskGraph::TaskID id, std::atomic<int>& pending);
+
+    std::vector<std::unique_ptr<Queue>> queues; // Queue 0 belongs to threads outside the pool
+    std::vector<std::thread> workers;
+
+    std::atomic<int> queued{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+};
+
+#endif
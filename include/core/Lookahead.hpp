@@ -0,0 +1,74 @@
+#ifndef LOOKAHEAD_HPP
+#define LOOKAHEAD_HPP
+
+#include "raylib.h"
+#include "spaceship.hpp"
+#include "ProjectilePool.hpp"
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// A ship inside a LookaheadSim
+struct LookaheadShip {
+    Rectangle rect;
+    Vector2 velocity;
+    Side side;
+    float speed;
+    float accel;
+    float decel;
+    float health;
+    float bulletVel;
+    float bulletDamage;
+    int bulletLim;
+    ControlState control;   // What it keeps doing. Ship 0 is told each step instead
+    float fireCooldown = 0.0f;
+    float damageTaken = 0.0f;
+    float damageDealt = 0.0f;
+};
+
+// A cut-down copy of the part of a world around one ship, for trying moves
+// out before making them. It holds the ship, the enemies nearest it and the
+// projectiles that can reach them, and steps them by the world's rules with
+// no grids, audio or rendering. Copying one is a handful of flat copies into
+// storage a previous copy already sized, so forks are cheap.
+//
+// Enemies are assumed to keep moving the way they are moving. Every ship
+// fires a bullet whenever it lines up with an opposing one and has a bullet
+// to spare, which is roughly what the AI does.
+class LookaheadSim {
+public:
+    // maxEnemies enemies besides self, projectile pools of the given sizes
+    LookaheadSim(int maxEnemies, int maxBullets, int maxEnergy);
+
+    // Copies self, its target and the enemies nearest it, and every
+    // projectile that can reach one of them within horizon seconds
+    void Capture(const std::vector<std::unique_ptr<Spaceship>>& worldShips, const Spaceship& self, double time, float horizon);
+
+    // One step of dt seconds with ship 0 under selfControl
+    void Step(const ControlState& selfControl, float dt);
+
+    // Ships plus projectiles, the work one Step does
+    int Size() const;
+
+    // Any enemy projectile that may reach ship 0
+    bool Threatened() const;
+
+    std::vector<LookaheadShip> ships; // Ship 0 is the one looking ahead
+    ProjectilePool bullets;           // Owners are indices in ships, or one past them
+    ProjectilePool energy;
+    double time = 0.0;
+
+private:
+    void Fire(int ship);
+    void ApplyHits(ProjectilePool& pool, bool circles);
+
+    int maxEnemies;
+    uint16_t outsider;                  // Owner of projectiles fired by ships left out
+    std::vector<int> shipOf;            // World ship id to index in ships, or -1
+    std::vector<Vector2> centers;       // For homing, by index in ships
+    std::vector<uint8_t> mask;          // Overlap kernel results
+    std::vector<std::pair<float, int>> nearest;
+};
+
+#endif
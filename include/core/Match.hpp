@@ -0,0 +1,91 @@
+#ifndef MATCH_HPP
+#define MATCH_HPP
+
+#include "raylib.h"
+#include "World.hpp"
+#include "SimClock.hpp"
+#include "IAudioSink.hpp"
+#include "IRenderSink.hpp"
+#include "controllers/AIParams.hpp"
+#include "controllers/PolicyController.hpp"
+#include <cstdint>
+#include <memory>
+
+enum class GameMode {
+    NoPlayer, 
+    SinglePlayer,
+    TwoPlayer,
+    Arena
+};
+
+enum class AIDifficulty {
+    Normal, // AIController
+    Hard    // LookaheadController
+};
+
+enum class Winner {
+    None,
+    Red,
+    Yellow
+};
+
+// One yellow (left) vs red (right) match: the world, its controllers and the
+// sim clock. Knows nothing about windows, input polling or audio devices,
+// so it can be stepped by Game every frame or by a plain loop in headless mode.
+class Match {
+public:
+    // Every AI controller draws from its own stream derived from seed and its ship id
+    Match(GameMode mode, const ShipAssets& yellowAssets, const ShipAssets& redAssets, IAudioSink& audio, uint64_t seed, int shipsPerSide = ARENA_SHIPS_PER_SIDE);
+
+    // Swap the AI on one side for one of the given difficulty, or one
+    // weighing things up by params, or for a trained policy, which takes
+    // precedence over both until it is set back to null. Every ship of a
+    // side playing a policy shares one PolicyBatch. Call before the first Step
+    void SetAIDifficulty(Side side, AIDifficulty difficulty);
+    void SetAIParams(Side side, const AIParams& params);
+    void SetAIPolicy(Side side, std::shared_ptr<const Policy> policy);
+
+    void PollInput();
+    void Step(float dt);
+    void Draw(IRenderSink& renderer, float alpha);
+    void Reset();
+
+    // Clock, tick, outcome, world and every controller's own state
+    void SaveState(ByteWriter& out) const;
+    bool LoadState(ByteReader& in);
+
+    bool IsOver() const;
+    Winner GetWinner() const;
+    GameMode GetMode() const;
+    uint64_t GetSeed() const;
+    int GetShipsPerSide() const;
+    const SimClock& GetClock() const;
+    long GetTick() const;
+
+    World world;
+
+    // First ship of each team. In the one on one modes these are the only ships
+    Spaceship* redShip;
+    Spaceship* yellowShip;
+
+private:
+    void SpawnArena(const ShipAssets& yellowAssets, const ShipAssets& redAssets);
+
+    uint64_t ControllerSeed(const Spaceship& ship) const;
+    bool IsAIShip(const Spaceship& ship) const;
+    std::unique_ptr<IController> MakeAI(Spaceship& ship);
+    void RebuildAI(Side side);
+
+    GameMode mode;
+    uint64_t seed;
+    int shipsPerSide;
+    SimClock clock;
+    long tick = 0;
+    Winner winner = Winner::None;
+    bool over = false;
+    AIDifficulty difficulty[3] = {AIDifficulty::Normal, AIDifficulty::Normal, AIDifficulty::Normal}; // By Side
+    AIParams aiParams[3];
+    std::shared_ptr<PolicyBatch> policyBatches[3]; // Null for sides without a policy
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef NETSOCKET_HPP
+#define NETSOCKET_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// IPv4 address and port, in host byte order
+struct NetAddress {
+    uint32_t ip = 0;
+    uint16_t port = 0;
+
+    // "host:port" or "host" with defaultPort. Resolves names through DNS
+    static bool Parse(const std::string& text, uint16_t defaultPort, NetAddress& out);
+    std::string ToString() const;
+
+    bool operator==(const NetAddress& other) const { return ip == other.ip && port == other.port; }
+    bool operator!=(const NetAddress& other) const { return !(*this == other); }
+};
+
+// Non-blocking UDP socket. POSIX only
+class UdpSocket {
+public:
+    UdpSocket() = default;
+    ~UdpSocket();
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Binds to port on every interface, or to any free port for 0
+    bool Open(uint16_t port);
+    void Close();
+    bool IsOpen() const;
+    uint16_t LocalPort() const;
+
+    // Room for datagrams that arrive between reads. The OS may give less
+    void SetReceiveBufferSize(int bytes);
+
+    bool Send(const NetAddress& to, const void* data, size_t size);
+
+    // Size of the datagram read into buffer, or -1 once nothing is waiting
+    int Receive(NetAddress& from, void* buffer, size_t capacity);
+
+private:
+    int handle = -1;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef OBSERVATION_HPP
+#define OBSERVATION_HPP
+
+#include "spaceship.hpp"
+
+// What a learned policy sees of a match, from one ship's point of view.
+// VecEnv trains on exactly this and PolicyController plays on it, so a
+// policy sees the same thing in training and in a match.
+//
+// Layout, x mirrored for a ship on the right so +x always points at the enemy:
+//   self:  x, y, vx, vy, health, bullets left, energy weapons left
+//   enemy: x, y, vx, vy, health
+//   the nearest bullets, then the nearest energy weapons, each as
+//   dx, dy, vx, vy from the ship and +1 for the enemy's, -1 for the ship's
+//   own or 0 for an empty slot
+// Positions are fractions of the screen, health of a full bar
+namespace observation {
+    const int nearestBullets = 8;
+    const int nearestEnergy = 4;
+    const int shipFeatures = 7;
+    const int enemyFeatures = 5;
+    const int projectileFeatures = 5;
+    const int size = shipFeatures + enemyFeatures + (nearestBullets + nearestEnergy) * projectileFeatures;
+
+    // Writes size floats. Reads the ships and the shared pools only, so any
+    // number of ships can be observed at once
+    void Write(const Spaceship& self, const Spaceship& enemy, float fullHealth, float* out);
+}
+
+#endif
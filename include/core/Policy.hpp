@@ -0,0 +1,62 @@
+#ifndef POLICY_HPP
+#define POLICY_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Ping-pong activations for Policy::Forward. Grows to the largest batch run
+// through it and is reused after that
+struct PolicyScratch {
+    std::vector<float> a;
+    std::vector<float> b;
+};
+
+// A small multilayer perceptron: ReLU hidden layers and a linear output
+// layer, run a batch at a time through kernels::Dense.
+//
+// Stored as a flat little endian file: "SBPL", a version byte, the layer
+// count, then per layer its inputs and outputs as varints, outputs by
+// inputs f32 weights (one row per output, as trainers export them) and
+// outputs f32 biases.
+class Policy {
+public:
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+
+    // Uniform He initialization, for training from scratch and benchmarks
+    static Policy Random(int inputs, const std::vector<int>& hidden, int outputs, uint64_t seed);
+
+    int Inputs() const;
+    int Outputs() const;
+    int OutputStride() const; // Floats between rows of Forward's result
+    long Parameters() const;
+
+    // Runs rows inputs at once, in holding rows * Inputs() floats. Returns
+    // the outputs, row r starting at r * OutputStride(), valid until the
+    // scratch is next used
+    const float* Forward(const float* in, int rows, PolicyScratch& scratch) const;
+
+private:
+    // Weights are stored inputs by stride, transposed from the file, with
+    // the outputs padded to kernels::denseAlign by zeros, which later
+    // layers read as inputs with zero weights
+    struct Layer {
+        int inputs = 0;  // Padded width of the layer before, or the policy's inputs
+        int outputs = 0;
+        int stride = 0;
+        std::vector<float> weights;
+        std::vector<float> bias;
+    };
+
+    void AddLayer(int inputs, int outputs);
+
+    int inputs = 0;
+    std::vector<Layer> layers;
+};
+
+// Entry point for `main --headless --policy-bench ...`. Times inference one
+// ship at a time and batched, on every backend this CPU supports
+int RunPolicyBenchCommand(int argc, char** argv);
+
+#endif
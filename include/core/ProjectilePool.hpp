@@ -0,0 +1,110 @@
+#ifndef PROJECTILEPOOL_HPP
+#define PROJECTILEPOOL_HPP
+
+#include "raylib.h"
+#include "config.h"
+#include "SpatialGrid.hpp"
+#include "ByteStream.hpp"
+#include <cstdint>
+#include <vector>
+
+// Stable reference to a projectile. Stays valid while the projectile lives,
+// even though its index in the pool changes as other projectiles are removed.
+struct ProjectileHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool IsNull() const { return slot == UINT32_MAX; }
+    bool operator==(const ProjectileHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const ProjectileHandle& other) const { return !(*this == other); }
+};
+
+// Structure-of-arrays storage for one kind of projectile. All arrays are
+// allocated once at construction; live projectiles are packed into
+// [0, Count()) and removal swaps the last one into the hole.
+class ProjectilePool {
+    public:
+        explicit ProjectilePool(int capacity, int maxOwners = 2);
+
+        // Returns a null handle when the pool is full
+        ProjectileHandle Spawn(Vector2 pos, Vector2 vel, float damage, uint16_t owner, uint8_t team, float spawnTime = 0.0f, uint16_t target = 0);
+        void Remove(int index);
+        bool Remove(ProjectileHandle handle);
+        void Clear();
+
+        // Deferred removal, so indices stay valid while collisions run
+        void MarkForRemoval(int index);
+        bool IsMarked(int index) const;
+        int RemoveMarked();
+
+        // Copies the current positions into prevX/prevY before a tick moves them
+        void SavePrevious();
+
+        int IndexOf(ProjectileHandle handle) const; // -1 if the projectile is gone
+        ProjectileHandle HandleAt(int index) const;
+
+        int Count() const;
+        int Capacity() const;
+        int CountOwnedBy(uint16_t owner) const;
+
+        // Live projectiles only, between ticks. Load gives them fresh slots,
+        // so handles taken before it are all invalid afterwards, and sets
+        // the previous positions to the current ones.
+        void SaveState(ByteWriter& out) const;
+        bool LoadState(ByteReader& in);
+
+        // Hot data, touched by the integrate and collide loops
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> vx;
+        std::vector<float> vy;
+        std::vector<float> damage;
+        std::vector<uint16_t> owner;
+        std::vector<uint8_t> team; // Side of the owner; projectiles never hit their own team
+
+        // Previous tick position, only read when rendering
+        std::vector<float> prevX;
+        std::vector<float> prevY;
+
+        // Energy weapon data, unused by bullets
+        std::vector<float> spawnTime;
+        std::vector<uint16_t> target;
+        std::vector<uint8_t> homing;
+
+    private:
+        void Resize(int capacity);
+
+        int count = 0;
+        int markedCount = 0;
+        std::vector<uint8_t> marked;
+        std::vector<uint32_t> denseToSlot;
+        std::vector<uint32_t> slotToDense;
+        std::vector<uint32_t> generations;
+        std::vector<uint32_t> freeSlots;
+        std::vector<int> ownerCounts;
+};
+
+// Every projectile in a match, shared by all ships, plus a broadphase grid
+// per pool. The grids are rebuilt whenever projectiles move or are removed,
+// so between ticks their indices always match the pools.
+struct Projectiles {
+    explicit Projectiles(int maxShips);
+
+    ProjectilePool bullets;
+    ProjectilePool energy;
+    SpatialGrid bulletGrid;
+    SpatialGrid energyGrid;
+
+    void Clear();
+    void SavePrevious();
+    void SaveState(ByteWriter& out) const;
+    bool LoadState(ByteReader& in); // Rebuilds the grids
+    void RebuildGrids();
+    void RebuildBulletGrid();
+    void RebuildEnergyGrid();
+
+    // Removes everything collisions marked and rebuilds the grids if anything went
+    void RemoveMarked();
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include "ByteStream.hpp"
+#include <cstdint>
+
+// xoshiro256** generator. Every match and every controller owns one, seeded
+// explicitly, so the same seeds and inputs replay the same match bit for bit
+// and threads never share random state.
+class Random {
+public:
+    explicit Random(uint64_t seed = 0);
+
+    void Seed(uint64_t seed);
+    uint64_t Next();
+
+    // Uniform int in [min, max], inclusive like raylib's GetRandomValue
+    int Range(int min, int max);
+
+    // Uniform float in [0, 1)
+    float Float();
+
+    void SaveState(ByteWriter& out) const;
+    void LoadState(ByteReader& in);
+
+    // Mixes two values into a well spread seed, e.g. a match seed and a ship id
+    static uint64_t MixSeed(uint64_t a, uint64_t b);
+
+private:
+    uint64_t state[4];
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef RAYLIBSINKS_HPP
+#define RAYLIBSINKS_HPP
+
+#include "raylib.h"
+#include "IAudioSink.hpp"
+#include "IRenderSink.hpp"
+#include "ResourceManager.hpp"
+
+// Plays sounds on the raylib audio device. Sounds are looked up once here
+// instead of every time a ship fires.
+class RaylibAudioSink : public IAudioSink {
+    public:
+        explicit RaylibAudioSink(ResourceManager& resources);
+        void Play(SoundID id) override;
+
+    private:
+        Sound sounds[(int)SoundID::Count];
+};
+
+// Forwards straight to raylib's immediate mode draw functions.
+class RaylibRenderSink : public IRenderSink {
+    public:
+        void DrawSprite(const Texture2D& texture, Rectangle src, Rectangle dest, Vector2 origin, float rotation, Color tint) override;
+        void DrawRect(Rectangle rect, Color color) override;
+        void DrawRectLines(Rectangle rect, float thickness, Color color) override;
+        void DrawCircle(Vector2 center, float radius, Color color) override;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include "Match.hpp"
+#include "ByteStream.hpp"
+#include "controllers/IController.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Replay file layout, little endian:
+//   header:  "SBRP", version, mode, ships per side, ship count, seed, tick dt, keyframe interval
+//   blocks:  start tick, tick count, checksum and Match::SaveState keyframe at the start tick,
+//            then one control stream per ship covering the block's ticks
+// A control stream is a bit packed list of runs of identical controls, see
+// WriteRun in Replay.cpp. A block's first run is relative to all zeros.
+// Seeking loads the closest keyframe before the tick and simulates from there.
+
+struct ReplayHeader {
+    GameMode mode = GameMode::NoPlayer;
+    int shipsPerSide = 1;
+    int shipCount = 2;
+    uint64_t seed = 0;
+    float dt = TICK_DT;
+    int keyframeInterval = REPLAY_KEYFRAME_INTERVAL;
+};
+
+struct ReplayKeyframe {
+    long tick = 0;
+    uint64_t checksum = 0;       // World::Checksum at this tick
+    std::vector<uint8_t> state;  // Match::SaveState
+};
+
+// Control bits: moveX and moveY as signed bytes, then the two fire buttons
+uint32_t PackControl(const ControlState& state);
+ControlState UnpackControl(uint32_t packed);
+
+// Captures a match as it is played. Call Record after every Match::Step.
+class ReplayRecorder {
+public:
+    explicit ReplayRecorder(const Match& match, int keyframeInterval = REPLAY_KEYFRAME_INTERVAL);
+
+    void Record(const Match& match);
+
+    // The finished file. Recording can carry on afterwards
+    std::vector<uint8_t> Finish() const;
+    bool Save(const std::string& path) const;
+
+private:
+    struct Run {
+        uint32_t control;
+        int length;
+    };
+
+    void StartBlock(const Match& match);
+    void EncodeBlock(ByteWriter& out) const;
+
+    ReplayHeader header;
+    ByteWriter finished;            // Every completed block
+    ReplayKeyframe blockKeyframe;   // Start of the block being recorded
+    long blockTicks = 0;
+    std::vector<std::vector<Run>> runs; // Per ship, this block
+};
+
+class Replay {
+public:
+    bool Load(const std::string& path);
+    bool Decode(const std::vector<uint8_t>& bytes);
+
+    // Controls ship used on tick, one of (FirstTick, LastTick]
+    ControlState GetControl(int ship, long tick) const;
+    long FirstTick() const;
+    long LastTick() const;
+
+    ReplayHeader header;
+    std::vector<ReplayKeyframe> keyframes;
+
+private:
+    std::vector<std::vector<uint32_t>> controls; // [ship][tick - FirstTick() - 1]
+};
+
+// Feeds a ship the controls a replay recorded for it
+class ReplayController : public IController {
+public:
+    ReplayController(const Replay& replay, const Match& match, int shipId);
+    ControlState GetState(const SimClock& clock) override;
+
+private:
+    const Replay& replay;
+    const Match& match;
+    int shipId;
+};
+
+// Rebuilds a recorded match and plays it back
+class ReplayPlayer {
+public:
+    ReplayPlayer(const Replay& replay, const ShipAssets& yellowAssets, const ShipAssets& redAssets, IAudioSink& audio);
+
+    // Plays one tick. At keyframe ticks the world is checked against the recording
+    void Step();
+    bool Seek(long tick);
+    bool IsFinished() const;
+
+    Match& GetMatch();
+    int Mismatches() const; // Keyframes the playback disagreed with
+
+private:
+    void UseReplayControllers();
+
+    const Replay& replay;
+    std::unique_ptr<Match> match;
+    int mismatches = 0;
+};
+
+// Entry point for `main --headless --replay ...`. Plays a replay back against
+// its keyframes and times seeking in it
+int RunReplayCommand(int argc, char** argv);
+
+// Entry point for `main --headless --replay-test`. Checks malformed replay
+// files are refused rather than read past their end
+int RunReplayTestCommand(int argc, char** argv);
+
+#endif
@@ -2,29 +2,149 @@
 #define RESOURCE_MANAGER_HPP
 
 #include "raylib.h"
+#include "AssetArchive.hpp"
+#include "IAudioSink.hpp"
+#include <cstdint>
 #include <unordered_map>
 #include <string>
-#include <stdexcept>
+#include <vector>
 
+// The game's own textures. Their handles are fixed, so need no lookup.
+// Sounds use SoundID the same way
+enum class TextureID : uint16_t {
+    Background,
+    RedShip,
+    YellowShip,
+    EnergyLeftFacing,
+    EnergyRightFacing,
+    Count
+};
+
+// A slot in the resource manager, resolved from a name once. Stays valid
+// while the asset is loaded, released and loaded again
+struct TextureHandle {
+    static constexpr uint16_t invalid = 0xFFFF;
+    uint16_t index = invalid;
+
+    constexpr TextureHandle() = default;
+    constexpr explicit TextureHandle(uint16_t slot) : index(slot) {}
+    constexpr TextureHandle(TextureID id) : index((uint16_t)id) {}
+
+    constexpr bool IsValid() const { return index != invalid; }
+    constexpr bool operator==(TextureHandle other) const { return index == other.index; }
+    constexpr bool operator!=(TextureHandle other) const { return index != other.index; }
+};
+
+struct SoundHandle {
+    static constexpr uint16_t invalid = 0xFFFF;
+    uint16_t index = invalid;
+
+    constexpr SoundHandle() = default;
+    constexpr explicit SoundHandle(uint16_t slot) : index(slot) {}
+    constexpr SoundHandle(SoundID id) : index((uint16_t)id) {}
+
+    constexpr bool IsValid() const { return index != invalid; }
+    constexpr bool operator==(SoundHandle other) const { return index == other.index; }
+    constexpr bool operator!=(SoundHandle other) const { return index != other.index; }
+};
+
+// Names are only looked up to get a handle. Everything else takes handles
+// and indexes an array with them. The GPU textures and sounds behind the
+// handles are shared by every handle loading the same file at the same
+// size, and freed when the last of them is released.
 class ResourceManager {
     public:
-        ResourceManager() = default;
+        ResourceManager(); // With the TextureID and SoundID handles registered
         ~ResourceManager();
 
+        ResourceManager(const ResourceManager&) = delete;
+        ResourceManager& operator=(const ResourceManager&) = delete;
+
+        // The handle for name, registering it the first time
+        TextureHandle GetTextureHandle(const std::string& name);
+        SoundHandle GetSoundHandle(const std::string& name);
+
+        // While open, assets packed in the archive load from it instead of
+        // their files. Close it once everything is loaded
+        bool OpenArchive(const std::string& filepath);
+        void CloseArchive();
+        const AssetArchive& GetArchive() const;
+
+        // Loading in two halves, so decoding can run on another thread: the
+        // Decode functions only read files and the archive, and the Add
+        // functions upload, on the window's thread
+        struct DecodedTexture {
+            Image image = {};
+            Vector2 imageSize = {0.0f, 0.0f};
+            std::string key;    // Of the texture in the cache
+            bool owned = false; // False when image points into the archive
+        };
+
+        struct DecodedSound {
+            Wave wave = {};
+            std::string key;
+            bool owned = false;
+        };
+
+        // drawScale 0 keeps the image as it is, without mipmaps
+        DecodedTexture DecodeTexture(const std::string& filepath, float drawScale) const;
+        DecodedSound DecodeSound(const std::string& filepath) const;
+        void AddTexture(TextureHandle handle, DecodedTexture& decoded);
+        void AddSound(SoundHandle handle, DecodedSound& decoded);
+
         // Textures
-        void loadTexture(const std::string& name, const std::string& filepath);
-        Texture2D& GetTexture(const std::string& name);
+        void loadTexture(TextureHandle handle, const std::string& filepath);
+        // A copy of the image drawScale times its size, for sprites that are
+        // only ever drawn that small, with mipmaps for when they turn or
+        // shrink further
+        void loadTexture(TextureHandle handle, const std::string& filepath, float drawScale);
+        bool IsLoaded(TextureHandle handle) const;
+        const Texture2D& GetTexture(TextureHandle handle) const; // Empty when not loaded
+        Vector2 GetImageSize(TextureHandle handle) const; // Of the file, whatever size the texture is
+        void ReleaseTexture(TextureHandle handle);
 
         // Sounds
-        void loadSound(const std::string&name, const std::string& filepath);
-        Sound& GetSound(const std::string& name);
+        void loadSound(SoundHandle handle, const std::string& filepath);
+        bool IsLoaded(SoundHandle handle) const;
+        const Sound& GetSound(SoundHandle handle) const; // Empty when not loaded
+        void ReleaseSound(SoundHandle handle);
 
-        void UnloadAll();
+        void UnloadAll(); // Handles stay registered
 
     private:
-        std::unordered_map<std::string, Texture2D> textures;
-        std::unordered_map<std::string, Sound> sounds;
+        // What a handle points at. A copy of its cache entry's texture, so
+        // reading it is one index
+        struct TextureSlot {
+            Texture2D texture = {};
+            Vector2 imageSize = {0.0f, 0.0f};
+            int entry = -1; // In textureCache, -1 while not loaded
+        };
+
+        struct SoundSlot {
+            Sound sound = {};
+            int entry = -1;
+        };
+
+        template <typename T>
+        struct CacheEntry {
+            std::string key; // File, and size for textures. Empty while unused
+            T resource = {};
+            int refs = 0;    // Slots holding it
+        };
+
+        static int FindEntry(const std::unordered_map<std::string, int>& keys, const std::string& key);
+
+        std::vector<TextureSlot> textureSlots;
+        std::vector<SoundSlot> soundSlots;
+        std::unordered_map<std::string, uint16_t> textureNames; // Only read to make handles
+        std::unordered_map<std::string, uint16_t> soundNames;
+
+        std::vector<CacheEntry<Texture2D>> textureCache;
+        std::vector<CacheEntry<Sound>> soundCache;
+        std::unordered_map<std::string, int> textureKeys; // Into the caches, only read while loading
+        std::unordered_map<std::string, int> soundKeys;
 
+        AssetArchive archive;
 };
 
-#endif
\ No newline at end of file
+#endif
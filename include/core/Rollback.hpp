@@ -0,0 +1,159 @@
+#ifndef ROLLBACK_HPP
+#define ROLLBACK_HPP
+
+#include "Match.hpp"
+#include "NetSocket.hpp"
+#include "ByteStream.hpp"
+#include "Random.hpp"
+#include "IAudioSink.hpp"
+#include "controllers/IController.hpp"
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Two player matches over UDP, GGPO style. Each side plays its own input
+// straight away and predicts the other's. When the real remote input turns
+// out different, the match is loaded from the snapshot before it and played
+// forward again, so neither player ever waits on the network for their own
+// ship. Only needs the match to be deterministic and to Save/LoadState.
+//
+// Red is ship 0 and yellow ship 1. The host plays yellow.
+
+// Finds the other player before a net match. The host picks the seed
+class NetLobby {
+public:
+    bool Host(uint16_t port, uint64_t matchSeed);
+    bool Join(const NetAddress& hostAddress);
+
+    // Sends and answers hellos. True once both sides know each other
+    bool Poll();
+
+    bool IsConnected() const;
+    bool IsHost() const;
+    uint64_t GetSeed() const;
+    int LocalShip() const;
+    const NetAddress& GetPeer() const;
+    UdpSocket& GetSocket();
+
+private:
+    UdpSocket socket;
+    NetAddress peer;
+    uint64_t seed = 0;
+    bool host = false;
+    bool connected = false;
+    int pollsSinceHello = 0;
+};
+
+// Artificial latency and loss on outgoing packets, for testing over localhost
+struct NetConditions {
+    int delayPolls = 0;   // Packets are held for this many Advance/Poll calls
+    float loss = 0.0f;    // Fraction of packets dropped
+};
+
+struct RollbackStats {
+    long rollbacks = 0;          // Mispredictions corrected
+    long resimulatedTicks = 0;
+    int longestRollback = 0;
+    long stalls = 0;             // Advance calls that waited for the remote
+    long packetsSent = 0;
+    long packetsReceived = 0;
+};
+
+class RollbackSession {
+public:
+    // Puts NetInputControllers on both ships. localInput is sampled once per
+    // tick and is not part of the match, so it is never rolled back
+    RollbackSession(Match& match, NetLobby& lobby, IController& localInput, GatedAudioSink* audio = nullptr);
+
+    // Reads packets, corrects any misprediction, then plays the next tick.
+    // Returns false without playing while the remote is MAX_ROLLBACK_TICKS behind
+    bool Advance();
+
+    // Keeps the connection going without playing a tick, e.g. once the match is over
+    void Poll();
+
+    // True at most every few ticks while this side runs ahead of the other.
+    // Skipping a tick then lets the remote catch up before it has to stall
+    bool ShouldWait();
+
+    ControlState GetInput(int ship, long tick) const;
+    long GetTick() const;
+    long GetConfirmedTick() const; // Last tick both inputs are known for
+    bool IsConfirmedOver() const;  // Over, and no late input can change that
+    bool IsDesynced() const;       // The peers disagreed on a confirmed tick
+    const RollbackStats& GetStats() const;
+
+    void SetConditions(const NetConditions& netConditions, uint64_t seed);
+
+private:
+    struct Snapshot {
+        long tick = -1;
+        uint64_t checksum = 0;
+        ByteWriter state;
+    };
+
+    struct DelayedPacket {
+        long due;
+        std::vector<uint8_t> bytes;
+    };
+
+    void Receive();
+    void ReadInputs(ByteReader& in);
+    void Rollback();
+    void SimulateTick();
+    void SendInputs();
+    void SendPacket(const ByteWriter& packet);
+    void CheckDesync();
+    uint32_t Prediction() const;
+
+    Match& match;
+    NetLobby& lobby;
+    IController& localInput;
+    GatedAudioSink* audio;
+    int localShip;
+    int remoteShip;
+
+    long tick = 0;
+    std::vector<uint32_t> inputs[2];  // PackControl'd, by ship id then tick. Remote entries past remoteConfirmed are predictions
+    long remoteConfirmed = 0;
+    long remoteAck = 0;               // Our last input the remote has
+    long remoteTick = 0;
+    int remoteAdvantage = 0;
+    long firstMispredicted = 0;       // 0 when every played tick is still right
+    long lastWaitTick = 0;
+
+    std::array<Snapshot, MAX_ROLLBACK_TICKS + 2> snapshots; // End of each recent tick, by tick % size
+    long remoteChecksumTick = 0;
+    uint64_t remoteChecksum = 0;
+    bool desynced = false;
+
+    ByteWriter packet;
+    std::vector<uint8_t> receiveBuffer;
+    NetConditions conditions;
+    Random lossRandom;
+    std::deque<DelayedPacket> delayed;
+    long polls = 0;
+
+    RollbackStats stats;
+};
+
+// Feeds a ship the inputs the session has for the tick being played
+class NetInputController : public IController {
+public:
+    NetInputController(const RollbackSession& session, const Match& match, int shipId);
+    ControlState GetState(const SimClock& clock) override;
+
+private:
+    const RollbackSession& session;
+    const Match& match;
+    int shipId;
+};
+
+// Entry points for `main --headless --netplay-test ...`, a rollback match
+// between two sessions over localhost, and `main --headless --rollback-bench
+// ...`, which times the longest rollback a session can make
+int RunNetplayTestCommand(int argc, char** argv);
+int RunRollbackBenchCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SIMCLOCK_HPP
+#define SIMCLOCK_HPP
+
+// Explicit simulation time, passed down to everything that used to ask raylib
+// for GetFrameTime()/GetTime(). Lets a match run without a window.
+struct SimClock {
+    float dt = 0.0f;   // Length of the current tick in seconds
+    double time = 0.0; // Simulated seconds since the match started
+
+    void Advance(float step) {
+        dt = step;
+        time += step;
+    }
+};
+
+#endif
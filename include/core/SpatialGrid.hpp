@@ -0,0 +1,51 @@
+#ifndef SPATIALGRID_HPP
+#define SPATIALGRID_HPP
+
+#include "raylib.h"
+#include <cstdint>
+#include <vector>
+
+// Reusable buffers for a grid query followed by a batch kernel over the hits
+struct QueryScratch {
+    std::vector<int> indices;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<uint8_t> mask;
+
+    void Reserve(int capacity);
+};
+
+// Uniform grid over the arena, rebuilt from a projectile pool every tick.
+// Each projectile is filed under the cell holding its center. Queries return
+// every projectile in the cells the area touches, padded by the largest
+// projectile extent, so callers still do the exact overlap test.
+class SpatialGrid {
+    public:
+        SpatialGrid(float width, float height, float cellSize, int capacity);
+
+        // centerOffset turns a stored position into the projectile's center.
+        // extent is how far a projectile reaches past its center.
+        void Build(const float* x, const float* y, int n, Vector2 centerOffset, float extent);
+
+        void QueryRect(Rectangle area, std::vector<int>& out) const;
+        void QueryRadius(Vector2 center, float radius, std::vector<int>& out) const;
+
+        // Copies the positions of the queried projectiles next to each other for the kernels
+        static int Gather(const float* x, const float* y, QueryScratch& scratch);
+
+    private:
+        int CellX(float x) const;
+        int CellY(float y) const;
+        void QueryCells(int minX, int minY, int maxX, int maxY, std::vector<int>& out) const;
+
+        float cellSize;
+        int cols;
+        int rows;
+        float extent = 0.0f;
+
+        std::vector<int> cellStart; // Entries of cell c are [cellStart[c], cellStart[c + 1])
+        std::vector<int> entries;   // Projectile indices, sorted by cell
+        std::vector<int> itemCell;  // Cell of each projectile, only used while building
+};
+
+#endif
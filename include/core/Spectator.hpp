@@ -0,0 +1,169 @@
+#ifndef SPECTATOR_HPP
+#define SPECTATOR_HPP
+
+#include "Match.hpp"
+#include "NetSocket.hpp"
+#include "ByteStream.hpp"
+#include "IAudioSink.hpp"
+#include "IRenderSink.hpp"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+enum class SpectatorPacket : uint8_t;
+
+// Streams a match to any number of watch-only clients over UDP. The server
+// runs the real simulation and every SPECTATOR_SEND_INTERVAL ticks sends
+// each client a frame: what changed since the last frame that client
+// acknowledged. Clients never simulate, they draw between the two frames
+// around a point SPECTATOR_DELAY behind the newest.
+
+// What a spectator needs to draw one moment of a match, quantized so deltas
+// come out the same on both sides. Positions are in 1/8 pixels, velocities
+// in pixels per second and health in 1/16 points.
+struct SpectatorShip {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t health = 0;
+    uint32_t score = 0;
+};
+
+// Keyed by pool slot and generation, which stay the same while the projectile lives
+struct SpectatorProjectile {
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t vx = 0;
+    int32_t vy = 0;
+    uint16_t owner = 0;
+};
+
+struct SpectatorFrame {
+    uint32_t number = 0; // Counts up over the whole stream. 0 is never sent
+    long tick = 0;
+    Winner winner = Winner::None;
+    bool over = false;
+    std::vector<SpectatorShip> ships;
+    std::vector<SpectatorProjectile> bullets; // Sorted by slot
+    std::vector<SpectatorProjectile> energy;
+
+    void Capture(const Match& match, uint32_t frameNumber);
+
+    // Only what changed since baseline, or everything without one. Ship
+    // fields are sent when they differ and projectiles as adds and moves,
+    // a move being the error from where the baseline's velocity would have
+    // taken it. Projectiles missing from a frame were removed.
+    void Encode(const SpectatorFrame* baseline, ByteWriter& out) const;
+    bool Decode(ByteReader& in, const SpectatorFrame* baseline);
+};
+
+struct SpectatorServerStats {
+    long framesSent = 0;   // One per client per frame
+    long fullFrames = 0;   // Sent without a baseline
+    long bytesSent = 0;
+    long encodes = 0;      // Distinct deltas built. Clients on the same baseline share one
+};
+
+class SpectatorServer {
+public:
+    bool Open(uint16_t port);
+    uint16_t LocalPort() const;
+
+    // Call after every tick. A new match (seed) starts every client over from a full frame
+    void Update(const Match& match);
+
+    int ClientCount() const;
+    const SpectatorServerStats& GetStats() const;
+
+private:
+    struct Client {
+        NetAddress address;
+        uint32_t acked = 0;       // Newest frame it has, the baseline for the next
+        uint32_t lastHeard = 0;   // Frame number when it last sent anything
+    };
+
+    struct Encoded {
+        uint32_t baseline;
+        ByteWriter packet;
+    };
+
+    void Receive();
+    const SpectatorFrame* FindFrame(uint32_t number) const;
+    const ByteWriter& PacketFor(uint32_t baseline);
+
+    UdpSocket socket;
+    std::unordered_map<uint64_t, Client> clients; // By address
+    std::deque<SpectatorFrame> history;           // Recent frames, oldest first
+    std::vector<Encoded> encoded;                 // This send's packets
+    size_t encodedCount = 0;
+    uint64_t matchId = 0;
+    GameMode mode = GameMode::NoPlayer;
+    int shipsPerSide = 1;
+    uint32_t nextFrame = 1;
+    int ticksSinceFrame = 0;
+    std::vector<uint8_t> receiveBuffer;
+    SpectatorServerStats stats;
+};
+
+struct SpectatorClientStats {
+    long framesReceived = 0;
+    long framesDropped = 0; // Their baseline was gone
+    long bytesReceived = 0;
+};
+
+// Watches a SpectatorServer. Builds a match of the same mode for the ships'
+// looks, but only ever copies received frames into it
+class SpectatorClient {
+public:
+    SpectatorClient(const ShipAssets& yellowAssets, const ShipAssets& redAssets, IAudioSink& audio);
+
+    bool Connect(const NetAddress& server);
+    void Disconnect();
+
+    // Reads frames and moves playback on by dt real seconds
+    void Poll(float dt);
+    void Draw(IRenderSink& renderer);
+
+    // Null until the first frame arrives
+    Match* GetMatch();
+    const SpectatorFrame* ShownFrame() const; // The frame playback is moving toward
+    const SpectatorFrame* NewestFrame() const;
+    const SpectatorClientStats& GetStats() const;
+
+private:
+    void Receive();
+    void ReadFrame(ByteReader& in);
+    void AdvancePlayback(float dt);
+    void ApplyFrames();
+    void Send(SpectatorPacket type, uint32_t frame = 0);
+
+    ShipAssets yellowAssets;
+    ShipAssets redAssets;
+    IAudioSink& audio;
+    UdpSocket socket;
+    NetAddress server;
+
+    std::unique_ptr<Match> match;
+    uint64_t matchId = 0;
+    std::deque<SpectatorFrame> frames; // Received, oldest first
+    double playTick = 0.0;
+    bool playing = false;
+    size_t shown = 0;       // Index in frames of the frame being drawn toward
+    float alpha = 1.0f;
+    float sinceHello = 0.0f;
+
+    ByteWriter packet;
+    std::vector<uint8_t> receiveBuffer;
+    SpectatorClientStats stats;
+};
+
+// Entry points for `main --headless --serve ...`, which streams AI matches to
+// spectators until killed, and `main --headless --spectate-bench ...`, which
+// streams one to spectators in the same process
+int RunSpectatorServerCommand(int argc, char** argv);
+int RunSpectateBenchCommand(int argc, char** argv);
+
+#endif
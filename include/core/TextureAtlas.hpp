@@ -0,0 +1,72 @@
+#ifndef TEXTUREATLAS_HPP
+#define TEXTUREATLAS_HPP
+
+#include "raylib.h"
+#include "AssetArchive.hpp"
+#include <string>
+#include <vector>
+
+// Every image in a directory packed into one texture at load time, so sprites
+// from different files can be drawn without switching textures. Textures
+// loaded from those files on their own are aliased to their packed copy,
+// which is packed at the aliased texture's size rather than the file's.
+// A small white block is packed too, for shapes drawn without a texture.
+class TextureAtlas {
+public:
+    TextureAtlas() = default;
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    // Points texture, loaded from path, at the copy of path in the atlas.
+    // Aliases are made before Build, which packs path at texture's size
+    void Alias(const Texture2D& texture, const std::string& path);
+
+    // Packs every .png in directory, or every one packed from it when the
+    // archive is open. Fails, leaving the atlas empty, when there are none
+    // or they don't fit in maxSize pixels square
+    bool Build(const std::string& directory, int maxSize, const AssetArchive* archive = nullptr);
+
+    // Build in two halves. Pack lays the images out on the CPU and may run
+    // on another thread, as long as nothing calls Alias meanwhile. Upload
+    // then replaces the texture, on the window's thread
+    bool Pack(const std::string& directory, int maxSize, const AssetArchive* archive = nullptr);
+    bool Upload();
+    void Unload(); // Aliases too
+
+    // Where texture's pixels sit in the atlas. False when it was never
+    // aliased, or its file wasn't packed
+    bool Find(const Texture2D& texture, Rectangle& region) const;
+
+    bool IsReady() const;
+    const Texture2D& GetTexture() const;
+    Vector2 WhiteTexel() const; // Texture coordinates of a white pixel
+
+private:
+    struct Entry {
+        std::string path;
+        Rectangle region;
+    };
+
+    struct TextureAlias {
+        Texture2D texture;
+        std::string path;
+        int entry; // -1 until built
+    };
+
+    void Release();
+
+    std::vector<Entry> entries;
+    std::vector<TextureAlias> aliases;
+    Texture2D texture = {};
+    Vector2 white = {0.0f, 0.0f};
+
+    // Packed, waiting for Upload
+    Image pending = {};
+    std::vector<Entry> pendingEntries;
+    std::vector<int> pendingAliasEntries; // By alias
+    Vector2 pendingWhite = {0.0f, 0.0f};
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef THREATCACHE_HPP
+#define THREATCACHE_HPP
+
+#include "raylib.h"
+#include "config.h"
+#include "ProjectilePool.hpp"
+#include "weapons.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Energy weapons further away than they can fly while homing are no threat
+const float energyThreatRadius = energySpeed * energyHomingDuration;
+
+// Bullets further off than this many seconds are no threat
+const float bulletThreatWindow = 2.0f;
+
+// Only the closest few energy weapons are weighed up for dodging
+const int maxEnergyThreats = 8;
+
+// Height of one band of the corridor occupancy, in pixels
+const int threatBandHeight = 4;
+const int threatBands = (HEIGHT + threatBandHeight - 1) / threatBandHeight;
+
+// An enemy bullet flying at a ship
+struct IncomingBullet {
+    float time; // Seconds until it reaches the ship's center line
+    float y;    // Its center height, which never changes
+};
+
+// Every bullet that can hit one team, filed by band of height and sorted
+// along x within each band. Built once a tick, so each ship finds the next
+// bullet coming at it in a band without looking at the others.
+class TeamThreats {
+public:
+    void Build(uint8_t team, const Projectiles& projectiles);
+
+    // For each band from firstBand to lastBand, lowers perBand's entry to the
+    // soonest bullet in it that reaches x within window seconds
+    void Soonest(int firstBand, int lastBand, float x, float window, IncomingBullet* perBand) const;
+
+    const std::vector<int>& EnemyEnergy() const; // Indices in the energy pool
+
+    struct Entry {
+        int list; // Band * 2, plus 1 when flying right
+        float x;  // Center
+        float y;
+        float vx;
+    };
+
+private:
+    // The entries of one list that has any
+    struct Run {
+        int list;
+        int begin;
+        int end;
+        float maxSpeed; // To stop searching once nothing further can arrive sooner
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Run> runs; // By list
+    std::vector<int> enemyEnergy;
+};
+
+// What threatens one ship, worked out once a tick by the world so AI queries
+// read it instead of searching the pools. Covers heights within the reach
+// given to Analyze of the ship's center, to band precision.
+class ShipThreats {
+public:
+    ShipThreats();
+
+    void Analyze(Rectangle shipRect, uint8_t team, float reach, const TeamThreats& incoming, const Projectiles& projectiles);
+
+    // Soonest incoming bullet centered within tolerance of y that arrives
+    // within window seconds, or null. Each band only offers its soonest
+    // bullet, so one a few pixels past tolerance can hide a later one inside
+    const IncomingBullet* BulletAt(float y, float tolerance, float window) const;
+
+    const std::vector<IncomingBullet>& Bullets() const; // The soonest in each band, soonest first
+    const std::vector<int>& Energy() const;              // Nearest first, up to maxEnergyThreats within energyThreatRadius
+
+private:
+    int firstBand = 0;
+    std::vector<IncomingBullet> bandSoonest; // From firstBand on. Time past bulletThreatWindow means none
+    std::vector<IncomingBullet> bullets;
+    std::vector<int> energy;
+    std::vector<int> nearby;                   // Grid query results, reused every tick
+    std::vector<std::pair<float, int>> ranked; // Energy weapons by squared distance
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TIMINGHISTOGRAM_HPP
+#define TIMINGHISTOGRAM_HPP
+
+#include <array>
+#include <cstdint>
+
+// Durations in nanoseconds, counted in buckets a quarter of an octave wide,
+// so percentiles come out within about 9% of the true value whatever the
+// scale. Recording is a couple of shifts and an increment, cheap enough to
+// do on every call being measured.
+class TimingHistogram {
+public:
+    void Record(uint64_t nanoseconds);
+    void Merge(const TimingHistogram& other);
+    void Clear();
+
+    uint64_t Count() const;
+    uint64_t Max() const;
+    double Mean() const;
+
+    // Duration below which fraction q of the recorded ones fall, 0 <= q <= 1
+    double Percentile(double q) const;
+
+private:
+    static const int subBuckets = 4; // Per octave
+    static const int bucketCount = 64 * subBuckets;
+
+    static int BucketOf(uint64_t nanoseconds);
+    static double BucketMiddle(int bucket);
+
+    std::array<uint64_t, bucketCount> buckets{};
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TUNER_HPP
+#define TUNER_HPP
+
+#include "Headless.hpp"
+#include "controllers/AIParams.hpp"
+#include <cstdint>
+#include <string>
+
+struct TunerOptions {
+    HeadlessOptions match;          // Mode, tick and time limit of every match
+    int generations = 100;          // In all, counting any a resumed search already ran
+    int population = 0;             // Candidates a generation. 0 lets CMAES pick
+    int matchesPerCandidate = 1000; // Against the reference, half on each side
+    int validationMatches = 4000;   // Of the result against the reference, once done
+    int threads = 0;                // 0 uses every hardware thread
+    double sigma = 0.2;             // First step, as a fraction of each parameter's range
+    uint64_t seed = 1;
+    AIParams start;                 // Where the search starts
+    AIParams reference;             // The opponent every candidate is scored against
+    std::string checkpointPath = "tune.ckpt"; // Rewritten every generation, resumed from if present
+    std::string outPath = "tuned.params";     // The search's current best guess, every generation
+    bool progress = true;
+};
+
+// Searches AIParams with CMAES for the values that beat the reference most
+// often. Each candidate plays matchesPerCandidate headless matches, in pairs
+// with the same seed and sides swapped, and every candidate of a generation
+// plays the same seeds, so candidates differ by their play rather than their
+// luck. A generation's matches are spread over every thread.
+int RunTuner(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const TunerOptions& options);
+
+// Entry point for `main --tune ...`
+int RunTuneCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef VECENV_HPP
+#define VECENV_HPP
+
+#include "Match.hpp"
+#include "JobSystem.hpp"
+#include "IAudioSink.hpp"
+#include "Observation.hpp"
+#include "controllers/IController.hpp"
+#include "controllers/AIParams.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Plays whatever the environment was last told to
+class ActionController : public IController {
+public:
+    ControlState GetState(const SimClock& clock) override;
+
+    ControlState action;
+};
+
+struct VecEnvOptions {
+    int envs = 64;
+    int threads = 0;                // 0 uses every hardware thread
+    int ticksPerStep = 1;           // Each action is held for this many ticks
+    float dt = TICK_DT;
+    double maxEpisodeTime = 60.0;   // Simulated seconds before an episode is cut short
+    Side learnerSide = Side::LEFT;  // The other ship is an AIController
+    AIParams opponent;
+    uint64_t seed = 1;              // Env i is seeded with Random::MixSeed(seed, i)
+};
+
+// How an episode stood after a step
+enum class EpisodeEnd : uint8_t {
+    Running = 0,
+    Terminated = 1, // One ship was destroyed
+    Truncated = 2   // Ran out of time
+};
+
+// A batch of independent one on one matches stepped together, for training
+// a policy against AIController. Every step takes one action per env, runs
+// every match ticksPerStep ticks spread over the job system, and writes
+// observations, rewards and how each episode stands straight into buffers
+// the caller owns. Finished episodes reset on the spot, and the observation
+// written for them is the first of the next episode.
+//
+// Observations are the learner's, see observation::Write. x is mirrored
+// for a learner on the right, so the action's moveX is mirrored to match,
+// and a policy trained on one side plays either. Rewards are damage dealt minus damage taken,
+// as a fraction of a full health bar, plus 1 for a win or -1 for a loss.
+class VecEnv {
+public:
+    static const int observationSize = observation::size; // Floats per env
+
+    explicit VecEnv(const VecEnvOptions& options);
+
+    int Size() const;
+
+    // Starts every episode over. observations holds Size() * observationSize floats
+    void Reset(float* observations);
+
+    // actions holds Size() controls, the rest Size() entries each
+    void Step(const ControlState* actions, float* observations, float* rewards, EpisodeEnd* ends);
+
+    long Steps() const; // Env steps taken so far, summed over the envs
+
+private:
+    struct Env {
+        std::unique_ptr<Match> match;
+        Spaceship* learner;
+        Spaceship* opponent;
+        ActionController* controller;
+        float fullHealth;
+        float learnerHealth; // At the end of the last step
+        float opponentHealth;
+    };
+
+    void StepEnv(Env& env, const ControlState& action, float* out, float& reward, EpisodeEnd& end);
+    void ResetEnv(Env& env);
+
+    VecEnvOptions options;
+    NullAudioSink audio;
+    std::vector<Env> envs;
+    std::unique_ptr<JobSystem> jobs;
+    long steps = 0;
+
+    // The buffers of the Step under way, for stepRange, which is built once
+    // so stepping never allocates
+    const ControlState* stepActions = nullptr;
+    float* stepObservations = nullptr;
+    float* stepRewards = nullptr;
+    EpisodeEnd* stepEnds = nullptr;
+    std::function<void(int, int)> stepRange;
+};
+
+// Entry point for `main --headless --env-bench ...`. Steps envs with random
+// actions and reports env steps a second
+int RunEnvBenchCommand(int argc, char** argv);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef WORLD_HPP
+#define WORLD_HPP
+
+#include "raylib.h"
+#include "spaceship.hpp"
+#include "ProjectilePool.hpp"
+#include "SimClock.hpp"
+#include "IAudioSink.hpp"
+#include "IRenderSink.hpp"
+#include "JobSystem.hpp"
+#include "AIScheduler.hpp"
+#include "DangerField.hpp"
+#include "TimingHistogram.hpp"
+#include <memory>
+#include <vector>
+
+// Textures a ship is built from, and the size it is in the arena. Only the
+// size matters to the simulation, so headless runs can pass textures that
+// were never uploaded, and windowed ones textures of any resolution.
+struct ShipAssets {
+    Texture2D shipImage;
+    Vector2 shipSize;
+    Texture2D energyImage;
+};
+
+struct TeamStats {
+    int alive = 0;
+    int ships = 0;
+    float health = 0.0f;
+    int score = 0;
+    float damageDealt = 0.0f;
+};
+
+// Owns every ship and projectile in a match and runs one tick of the
+// simulation for any number of ships on each side.
+class World {
+public:
+    World(IAudioSink& audio, int maxShips);
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // Ship ids are handed out in order, so ships[id]->id == id
+    Spaceship& AddShip(const ShipAssets& assets, Side team, std::unique_ptr<IController> controller);
+
+    void Step(const SimClock& clock, long tick);
+    void Draw(IRenderSink& renderer, float alpha);
+    void Reset();
+
+    TeamStats GetTeamStats(Side team) const;
+
+    // Hash of every ship and projectile's state. Equal checksums after the
+    // same number of ticks mean two runs of a match have not diverged.
+    uint64_t Checksum() const;
+
+    // Every ship and projectile, but not the controllers. Loading needs a
+    // world with the same ships, built the same way.
+    void SaveState(ByteWriter& out) const;
+    bool LoadState(ByteReader& in);
+
+    // Spreads each tick's stages over the job system's threads. Null runs
+    // them in order on the calling thread. Both give the same results.
+    void SetJobSystem(JobSystem* jobSystem);
+
+    // Microseconds a tick may spend on the AI ships that can be skipped, see
+    // AIScheduler. 0 has every ship think every tick
+    void SetAIThinkBudget(float microseconds);
+    const AIScheduler& GetAIScheduler() const;
+
+    // Times every GetState call into a histogram per ship, and the whole
+    // think stage of each tick. Off by default, as reading the clock around
+    // each call costs about as much as a cheap think
+    void SetThinkTiming(bool enabled);
+    const TimingHistogram& GetThinkTimes(int ship) const;
+    const TimingHistogram& GetThinkStageTimes() const;
+
+    std::vector<std::unique_ptr<Spaceship>> ships;
+    Projectiles projectiles;
+
+private:
+    void BuildStepGraph();
+    void ParallelFor(int count, int grain, const std::function<void(int, int)>& fn);
+    void UpdateTargets(long tick);
+    Spaceship* SelectTarget(const Spaceship& ship) const;
+
+    IAudioSink& audio;
+    std::vector<Vector2> shipCenters; // Indexed by ship id, for homing
+    TeamThreats teamThreats[3];       // Bullets that can hit each side, indexed by Side
+    DangerField dangerFields[3];      // Where each side is safe, indexed by Side
+    AIScheduler aiScheduler;
+    bool timeThinks = false;
+    std::vector<TimingHistogram> thinkTimes; // Indexed by ship id
+    std::vector<ThinkBatch*> thinkBatches;   // This tick's, scratch for the think stage
+    TimingHistogram thinkStageTimes;
+
+    JobSystem* jobs = nullptr;
+    TaskGraph stepGraph;
+    SimClock stepClock; // The tick stepGraph is running
+    long stepTick = 0;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef BATCHKERNELS_HPP
+#define BATCHKERNELS_HPP
+
+#include "raylib.h"
+#include <cstdint>
+
+// Vectorized loops over projectile arrays, and the dense layers of the
+// policy networks. The widest backend the CPU
+// supports is picked at startup; every backend gives the same results.
+namespace kernels {
+    enum class Backend {
+        Scalar,
+        SSE,
+        AVX2
+    };
+
+    Backend ActiveBackend();
+    const char* BackendName(Backend backend);
+
+    // Forces a backend, for benchmarks. Falls back to Scalar if unsupported.
+    void SetBackend(Backend backend);
+
+    // x[i] += vx[i] * dt, y[i] += vy[i] * dt
+    void Integrate(float* x, float* y, const float* vx, const float* vy, int n, float dt);
+
+    // mask[i] = 1 if the w by h box with top left corner (x[i], y[i]) overlaps rect.
+    // Matches CheckCollisionRecs. Returns the number of hits.
+    int OverlapBoxes(const float* x, const float* y, int n, float w, float h, Rectangle rect, uint8_t* mask);
+
+    // mask[i] = 1 if the circle of the given radius centered at (x[i], y[i]) overlaps rect.
+    // Matches CheckCollisionCircleRec. Returns the number of hits.
+    int OverlapCircles(const float* x, const float* y, int n, float radius, Rectangle rect, uint8_t* mask);
+
+    // One dense layer over a batch: out = in * weights + bias, then
+    // max(out, 0) if relu. in is rows by inputs, weights inputs by outputs
+    // and out rows by outputs, all row major. outputs must be a multiple of
+    // denseAlign. Every output adds its inputs in order, so a row comes out
+    // the same whatever the batch size or backend.
+    const int denseAlign = 8;
+    void Dense(const float* in, int rows, int inputs, const float* weights, const float* bias, int outputs, bool relu, float* out);
+}
+
+// Entry point for `main --headless --kernel-bench ...`. Times every backend
+// this CPU supports and checks they agree with the scalar one
+int RunKernelBenchCommand(int argc, char** argv);
+
+#endif
@@ -2,8 +2,75 @@
 
 #define DEBUG 0
 #define AITest 0
+#define RECORD_REPLAYS 0 // Save every windowed match under replays/
 
 const int WIDTH = 1000;
 const int HEIGHT = 700; 
 const int MIDDLERECTWIDTH = 10;
-const int FPS = 144;
\ No newline at end of file
+const int FPS = 144;
+
+// The simulation advances in fixed ticks, independent of the render rate.
+const int TICK_RATE = 120;
+const float TICK_DT = 1.0f / TICK_RATE;
+const int MAX_TICKS_PER_FRAME = 8; // Drop time instead of spiralling on very slow frames
+
+// Projectile pools are allocated once, at these sizes or per ship for big
+// matches. Shots past them are dropped
+const int MAX_BULLETS = 1024;
+const int MAX_ENERGY_WEAPONS = 256;
+const int BULLETS_PER_SHIP = 8;
+const int ENERGY_WEAPONS_PER_SHIP = 2;
+
+// Ships on each team in arena mode
+const int ARENA_SHIPS_PER_SIDE = 100;
+
+// Ticks between full world keyframes in a replay, which seeking starts from
+const int REPLAY_KEYFRAME_INTERVAL = TICK_RATE * 10;
+// The longest a replay file may claim, as every block's controls are
+// expanded in memory up to it
+const int REPLAY_MAX_KEYFRAME_INTERVAL = TICK_RATE * 60;
+
+// Ships are drawn and collide at this fraction of their image's size, and
+// their textures are loaded at that size
+const float SHIP_SCALE = 0.1f;
+
+// Seconds a frame may spend uploading assets while they load
+const double LOADING_FRAME_BUDGET = 0.004;
+
+// Made by `main --pack-assets`. Assets in it load without decoding their files
+const char* const ASSET_ARCHIVE = "assets.pak";
+
+// Images under ATLAS_DIRECTORY are packed into one texture of at most
+// ATLAS_MAX_SIZE pixels square, and the renderer draws its batch every
+// RENDER_BATCH_QUADS sprites and shapes
+const char* const ATLAS_DIRECTORY = "assets/images";
+const int ATLAS_MAX_SIZE = 4096;
+const int RENDER_BATCH_QUADS = 16384;
+
+// Side of one broadphase grid cell, in pixels
+const float GRID_CELL_SIZE = 64.0f;
+
+// Rollback netplay: ticks the remote input may be predicted ahead before the
+// local side waits for it, and the port --host listens on by default
+const int MAX_ROLLBACK_TICKS = 8;
+const int NET_DEFAULT_PORT = 7777;
+
+// Spectator streaming: ticks between frames sent to spectators, how far
+// behind the newest frame they play so there is always a next one to
+// interpolate toward, and the port --serve listens on by default
+const int SPECTATOR_SEND_INTERVAL = 4;
+const float SPECTATOR_DELAY = 0.1f;
+const int SPECTATOR_DEFAULT_PORT = 7778;
+// The largest arena streamed, so a full frame of it still fits one datagram
+// with room for projectiles. Clients refuse frames claiming more
+const int SPECTATOR_MAX_SHIPS_PER_SIDE = 1000;
+
+// Most time the hard AI may spend searching on one tick, per ship
+const int LOOKAHEAD_BUDGET_US = 200;
+
+// Most time the normal AI ships may spend thinking on one tick, all together.
+// Past it, ships that are out of danger think less often
+const int AI_THINK_BUDGET_US = 25;
+
+// Behaviours the normal AI chooses between, and what makes it choose them
+const char* const AI_BEHAVIOURS_PATH = "assets/ai/behaviours.txt";
@@ -4,4 +4,5 @@ namespace math {
     Vector2 NormalizeVec(const Vector2& v);
     float Dot(const Vector2& a, const Vector2& b);
     float CrossZ(const Vector2&a, const Vector2& b);
+    Vector2 Lerp(const Vector2& a, const Vector2& b, float t);
 }
\ No newline at end of file
@@ -2,12 +2,20 @@
 #define SPACESHIP_HPP
 
 #include <vector>
+#include <memory>
+#include <cstdint>
 #include "raylib.h"
 #include "config.h"
-#include "ResourceManager.hpp"
 #include "weapons.hpp"
+#include "SimClock.hpp"
+#include "IAudioSink.hpp"
+#include "IRenderSink.hpp"
+#include "ByteStream.hpp"
+#include "ThreatCache.hpp"
 #include "controllers/IController.hpp"
 
+class DangerField;
+
 enum class Side {
     NONE,
     LEFT, 
@@ -24,42 +32,76 @@ class Spaceship {
         int bulletLim;
         int maxEnergyShots;
         int score;
+        float damageDealt = 0.0f; // This match, cleared by Reset
         Side shipSide;
         float energyWeaponTimer;
         float bulletDamage;
         float energyWeaponDamage;
         Texture2D energySprite;
-        std::vector<Bullet> bullets;
-        std::vector<EnergyWeapon> energyWeapons;
+        Color bulletColor;
+        Color energyColor;
+        uint16_t id; // Owner ID of this ship's projectiles in the shared pools
+        Projectiles& projectiles;
         std::unique_ptr<IController> controller;
+        Spaceship* target = nullptr; // Enemy chosen by the world, aimed at by energy weapons and the AI
+        ShipThreats threats;         // Enemy projectiles near the ship as the current tick started
+        const DangerField* danger = nullptr; // Shared by the ship's team, set by the world
 
+        Vector2 spawnPos = {0, 0}; // Where Reset puts the ship
+        Vector2 prevPos = {0, 0}; // shipRect position at the start of the last tick
         Vector2 velocity = {0, 0};
         Vector2 desiredVelocity = {0, 0};
         float accel = 600.0f;
         float decel = 12000.0f;
         
-        Spaceship(const Texture2D& ship, Side side, Sound& shoot, Sound& hit, Texture2D& energyImage, Sound& energyShootingSound, std::unique_ptr<IController> ctrl);
+        Spaceship(const Texture2D& ship, Vector2 size, Side side, uint16_t shipID, Projectiles& pools, IAudioSink& audioSink, const Texture2D& energyImage, std::unique_ptr<IController> ctrl);
         void ApplyMovement(const ControlState& state, float dt);
-        float Accelerate(float current, float target, float& rate, float& dt);
-        void Draw();
+        static float Accelerate(float current, float target, float rate, float dt);
+        void Draw(IRenderSink& renderer, float alpha);
+        void SavePreviousState();
         void ShootBullet();
-        void ShootEnergy(Spaceship& enemy);
-        void HandleEnergyWeapon();
-        void HandleBullets();
-        void HandleBeingShot(Spaceship& enemy);
-        void Update(float dt, Spaceship& enemy);
-        bool IsDead();
+        void ShootEnergy(Spaceship& enemy, double time);
+        void HandleBeingShot(const std::vector<std::unique_ptr<Spaceship>>& ships);
+        void Update(const SimClock& clock);
+
+        // Update and HandleBeingShot split in two. Think and FindHits only
+        // read shared state, so every ship can run them at once; Act and
+        // ApplyHits write to the pools and other ships and must run in turn.
+        void Think(const SimClock& clock);
+        void Coast(); // Instead of Think, keeps the last movement and fires nothing
+        void Act(const SimClock& clock);
+        void FindHits();
+        void AnalyzeThreats(const TeamThreats& incoming, float dt);
+        void ApplyHits(const std::vector<std::unique_ptr<Spaceship>>& ships);
+
+        // The controls acted on in the last tick the ship was alive for
+        const ControlState& GetControlState() const;
+
+        // Position, motion, health and the movement a coasting ship keeps.
+        // The target is saved by the world
+        void SaveState(ByteWriter& out) const;
+        void LoadState(ByteReader& in);
+        bool IsDead() const;
         void Reset();
-        void ApplyShooting(const ControlState& state, Spaceship& enemy);
+        void SetSpawnPosition(Vector2 pos);
+        void ApplyShooting(const ControlState& state, const SimClock& clock);
         Rectangle GetHitBox() const;
+        Vector2 GetCenter() const;
+
+        // The rules above for any ship shaped body, so a lookahead can move
+        // copies of ships without the ships. Move returns the desired velocity
+        static Vector2 Move(Rectangle& shipRect, Vector2& velocity, Side shipSide, float shipVel, float accel, float decel, const ControlState& state, float dt);
+        static Rectangle HitBox(const Rectangle& shipRect);
+        static Vector2 BulletOrigin(const Rectangle& shipRect, Side shipSide); // Top left corner of a new bullet
 
     private:
-        bool InBounds(float newX, float newY);
-        Sound& shootingSound;
-        Sound& hitSound;
-        Sound& energyShootSound;
+        static bool InBounds(Side shipSide, const Rectangle& shipRect, float newX, float newY);
+        IAudioSink& audio;
+        QueryScratch scratch;
+        ControlState pendingState;        // From Think, carried out by Act
+        std::vector<int> bulletHits;      // Overlapping bullets found by FindHits
+        std::vector<int> energyHits;
         float rotation;
-        float scale;
 };
 
 #endif
\ No newline at end of file
@@ -2,47 +2,31 @@
 #define WEAPONS_HPP
 
 #include "raylib.h"
-
-class Spaceship;
-
-struct Bullet {
-    Vector2 pos;
-    float speed;
-    bool active;
-    Rectangle rect;
-    Color color;
-    float damage;
-};
-
-struct EnergyWeapon {
-    Vector2 pos; // Position of center of circle hitbox
-    float radius; // Radius of circle hitbox
-    bool active = true; // false when not homing AND off screen
-    bool isHoming = true; // false when no longer hominh
-    float spriteRotation = 0; // Clockwise rotation
-    Vector2 dir;
-    float vel;
-    Spaceship* target;
-    Color color;
-    float turnSpeed;
-    float timeEmmited;
-    float homingDuration = 4;
-    float damage;
-    float distanceToTarget;
-    Texture2D image;
-    float homingStrength = 5;
-
-    void Render();
-
-    void UpdateDirection();
-
-    void UpdateSpriteRotation();
-
-    void Move();
-
-    void Update();
-
-    void UpdateStatus();
-};
-
-#endif
\ No newline at end of file
+#include "SimClock.hpp"
+#include "ProjectilePool.hpp"
+
+const Vector2 bulletSize = {15, 5}; // width, height. Bullet position is the top left corner
+const float energyRadius = 10.0f;   // Radius of circle hitbox. Energy position is the center
+const float energySpeed = 300.0f;
+const float energyHomingDuration = 4.0f;  // Seconds an energy weapon keeps steering
+const float energyHomingStrength = 5.0f;  // tweak this higher/lower to adjust responsiveness
+
+namespace weapons {
+    // Moves every bullet and removes the ones that left the arena
+    void UpdateBullets(ProjectilePool& bullets, float dt);
+
+    // Steers homing energy weapons toward shipCenters[target], moves them and
+    // removes the ones that stopped homing and left the arena
+    void UpdateEnergyWeapons(ProjectilePool& energy, const SimClock& clock, const Vector2* shipCenters);
+
+    // The two halves of the updates above. Moving only touches [begin, end),
+    // so disjoint ranges can move on different threads. Culling reorders the pool.
+    void MoveBullets(ProjectilePool& bullets, float dt, int begin, int end);
+    void CullBullets(ProjectilePool& bullets);
+    void MoveEnergyWeapons(ProjectilePool& energy, const SimClock& clock, const Vector2* shipCenters, int begin, int end);
+    void CullEnergyWeapons(ProjectilePool& energy);
+
+    Vector2 EnergyDirection(const ProjectilePool& energy, int i);
+}
+
+#endif
@@ -22,7 +22,9 @@ namespace ui{
         SettingsButton,
         VolumeSlider,
         BackFromSettingsButton,
-        StoryModeButton
+        StoryModeButton,
+        ArenaButton,
+        DifficultyButton
     };
 
     class UIElement {
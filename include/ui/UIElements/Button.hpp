@@ -13,6 +13,7 @@ namespace ui{
             void Update(float dt) override;
             void Render() override;
             bool WasClicked() const;
+            void SetText(const std::string& newText); // Keeps the button centered where it was
 
         private:
             Rectangle bounds;
@@ -1,29 +1,53 @@
 #include "controllers/AIController.hpp"
+#include "core/DangerField.hpp"
 #include "raylib.h"
+#include <algorithm>
 #include <cmath>
 
-AIController::AIController(Spaceship* selfShip, Spaceship* enemyShip)
+// Seconds of full speed movement ahead a dodge looks for somewhere safer.
+// Ships are slow to get going, so nearer spots are usually no safer
+const float dodgeLookahead = 0.8f;
+
+// Where a dodge can head: staying put, then the eight ways a ship moves
+static const Vector2 dodgeDirections[] = {
+    {0.0f, 0.0f},
+    {0.0f, -1.0f}, {0.0f, 1.0f}, {-1.0f, 0.0f}, {1.0f, 0.0f},
+    {-0.70710678f, -0.70710678f}, {0.70710678f, -0.70710678f}, {-0.70710678f, 0.70710678f}, {0.70710678f, 0.70710678f}
+};
+
+AIController::AIController(Spaceship* selfShip, Spaceship* enemyShip, uint64_t randomSeed, const AIParams& aiParams)
     : self(selfShip),
       enemy(enemyShip),
+      firstEnemy(enemyShip),
       shootCooldown(0.0f),
       energyCooldown(0.0f),
       dodgeCooldown(0.0f),
       isDodging(false),
       dodgeDir({0.0f, 0.0f}),
       currentThreat(ThreatType::None),
-      mode(AIMode::Nuetral) {}
-
-
-ControlState AIController::GetState() {
+      behaviour(0),
+      plannedMove({0.0f, 0.0f}),
+      random(randomSeed),
+      seed(randomSeed),
+      params(aiParams),
+      behaviours(aiParams.behaviours ? *aiParams.behaviours : DefaultUtilityDefinition(), aiParams) {}
+
+ControlState AIController::GetState(const SimClock& simClock) {
     ControlState state;
+    clock = simClock;
+
+    // In the arena the world picks who to fight, and may change its mind
+    if (self->target) enemy = self->target;
+    if (!enemy) return state;
 
-    DecideMode();
+    ChooseBehaviour();
     UpdateCooldowns();
     UpdateEnemySeparation();
     
     HandleShooting(state);
     HandleMovement(state);
     Vector2 modeMove = {state.moveX, state.moveY};
+    plannedMove = modeMove;
 
      if (isDodging) {
         UpdateDodgeDir();
@@ -39,86 +63,101 @@ ControlState AIController::GetState() {
     return state;
 }
 
-void AIController::DecideMode() {
-    if (self->health < enemy->health * 0.8f) {
-        mode = AIMode::Defensive;
-    }
-    else if (self->health > enemy->health) {
-        mode = AIMode::Offensive;
-    }
-    else{
-        mode = AIMode::Nuetral;
-    }
+void AIController::SaveState(ByteWriter& out) const {
+    out.F32(shootCooldown);
+    out.F32(energyCooldown);
+    out.F32(separationFromEnemy);
+    out.F32(dodgeCooldown);
+    out.U8(isDodging ? 1 : 0);
+    out.F32(dodgeDir.x);
+    out.F32(dodgeDir.y);
+    out.U8((uint8_t)currentThreat);
+    out.U8((uint8_t)behaviour);
+    random.SaveState(out);
+}
+
+void AIController::LoadState(ByteReader& in) {
+    shootCooldown = in.F32();
+    energyCooldown = in.F32();
+    separationFromEnemy = in.F32();
+    dodgeCooldown = in.F32();
+    isDodging = in.U8() != 0;
+    dodgeDir.x = in.F32();
+    dodgeDir.y = in.F32();
+    currentThreat = (ThreatType)in.U8();
+    behaviour = std::min((int)in.U8(), behaviours.Size() - 1);
+    random.LoadState(in);
+}
+
+void AIController::Reset() {
+    enemy = firstEnemy;
+    shootCooldown = 0.0f;
+    energyCooldown = 0.0f;
+    separationFromEnemy = 600;
+    dodgeCooldown = 0.0f;
+    isDodging = false;
+    dodgeDir = {0.0f, 0.0f};
+    currentThreat = ThreatType::None;
+    behaviour = 0;
+    plannedMove = {0.0f, 0.0f};
+    clock = SimClock{};
+    random.Seed(seed);
+}
+
+bool AIController::AllowsThinkSkipping() const {
+    return true;
+}
+
+void AIController::ChooseBehaviour() {
+    float in[(int)UtilityInput::Count];
+    in[(int)UtilityInput::Health] = self->health;
+    in[(int)UtilityInput::EnemyHealth] = enemy->health;
+    in[(int)UtilityInput::HealthRatio] = enemy->health > 0.0f ? self->health / enemy->health : INFINITY;
+    in[(int)UtilityInput::HealthLead] = self->health - enemy->health;
+    in[(int)UtilityInput::DistanceX] = std::fabs(GetXDistanceToPlayer());
+    in[(int)UtilityInput::DistanceY] = std::fabs(GetYDistanceToPlayer());
+    in[(int)UtilityInput::BulletThreats] = (float)self->threats.Bullets().size();
+    in[(int)UtilityInput::EnergyThreats] = (float)self->threats.Energy().size();
+    in[(int)UtilityInput::BulletsLeft] = 1.0f - (float)self->projectiles.bullets.CountOwnedBy(self->id) / std::max(self->bulletLim, 1);
+    in[(int)UtilityInput::EnergyLeft] = 1.0f - (float)self->projectiles.energy.CountOwnedBy(self->id) / std::max(self->maxEnergyShots, 1);
+
+    behaviour = behaviours.Choose(in);
 }
 
 void AIController::HandleShooting(ControlState& state) {
-    switch (mode) {
-        case AIMode::Offensive:
-            if (shootCooldown <= 0.0f) {
-                state.shootBullet = true;
-                shootCooldown = 0.2f;
-            }
-            if (energyCooldown <= 0.0f && (int)self->energyWeapons.size() < self->maxEnergyShots) {
-                state.shootEnergy = true;
-                energyCooldown = 2.5;
-            }
-            break;
-        case AIMode::Defensive:
-            if (shootCooldown <= 0.0f) {
-                state.shootBullet = true;
-                shootCooldown = 0.5f;
-            }
-
-            if (energyCooldown <= 0.0f && (int)self->energyWeapons.size() < self->maxEnergyShots) {
-                state.shootEnergy = true;
-                energyCooldown = 6.0f;
-            }
-            break;
-        case AIMode::Nuetral:
-            if (shootCooldown < 0.0f) {
-                state.shootBullet = true;
-                shootCooldown = 0.4f;
-            }
-            if (energyCooldown < 0.0f && (int)self->energyWeapons.size() < self->maxEnergyShots) {
-                state.shootEnergy = true;
-                energyCooldown = 4.0f;
-            }
-            break;
+    // Strict behaviours only fire once a cooldown has gone below zero
+    bool strict = behaviours.strictCooldowns[behaviour];
+    bool bulletReady = strict ? shootCooldown < 0.0f : shootCooldown <= 0.0f;
+    bool energyReady = strict ? energyCooldown < 0.0f : energyCooldown <= 0.0f;
+
+    if (bulletReady) {
+        state.shootBullet = true;
+        shootCooldown = behaviours.shootCooldown[behaviour];
+    }
+    if (energyReady && self->projectiles.energy.CountOwnedBy(self->id) < self->maxEnergyShots) {
+        state.shootEnergy = true;
+        energyCooldown = behaviours.energyCooldown[behaviour];
     }
 }
 
 void AIController::HandleMovement(ControlState& state) {
-    switch (mode) {
-        case AIMode::Offensive:
-            HandleVerticalMovement(state);
-            HandleHorizontalMovement(state);
-            break;
-        case AIMode::Defensive:
-            HandleVerticalMovement(state);
-            HandleHorizontalMovement(state);
-            break;
-        case AIMode::Nuetral:
-            HandleHorizontalMovement(state);
-            HandleVerticalMovement(state);
-            break;
-    }
+    HandleVerticalMovement(state);
+    HandleHorizontalMovement(state);
 }
 
 void AIController::HandleVerticalMovement(ControlState& state) {
     if (isDodging) return;
 
     float yDiff = GetYDistanceToPlayer();
-    float deadZone = 20.0f;
+    float deadZone = params.verticalDeadZone;
 
-    float dt = GetFrameTime();
+    float dt = clock.dt;
     float newYCenter = self->shipRect.y + self->shipRect.height / 2
                       + (yDiff > 0 ? 1.0f : -1.0f) * self->shipVel * dt;
 
-    for (auto& b : enemy->bullets) {
-        if(IsBulletThreatAtY(b, newYCenter)) {
-            state.moveY = 0.0f;
-            return;
-        }
+    if (self->threats.BulletAt(newYCenter, self->shipRect.height * 0.5f, params.nearBulletWindow)) {
+        state.moveY = 0.0f;
+        return;
     }
 
     if (std::fabs(yDiff) > deadZone) {
@@ -130,7 +169,7 @@ void AIController::HandleVerticalMovement(ControlState& state) {
 }
 
 void AIController::HandleHorizontalMovement(ControlState& state) {
-    float buffer = GetRandomValue(50, 90);
+    float buffer = random.Range(50, 90);
     float minDistance = separationFromEnemy - buffer;
     float maxDistance = separationFromEnemy + buffer;
 
@@ -149,19 +188,7 @@ void AIController::HandleHorizontalMovement(ControlState& state) {
 
 
 Vector2 AIController::BlendMovement(const Vector2& modeMove, const Vector2& dodgeMove) {
-    float dodgeWeight;
-
-    switch (mode) {
-        case AIMode::Defensive:
-            dodgeWeight = 1.0f;
-            break;
-        case AIMode::Nuetral:
-            dodgeWeight = 0.75f;
-            break;
-        case AIMode::Offensive:
-            dodgeWeight = 0.5f;
-            break;
-    }
+    float dodgeWeight = behaviours.dodgeWeight[behaviour];
 
     float modeWeight = 1.0f - dodgeWeight;
 
@@ -174,24 +201,14 @@ Vector2 AIController::BlendMovement(const Vector2& modeMove, const Vector2& dodg
 }
 
 void AIController::UpdateCooldowns() {
-    float dt = GetFrameTime();
+    float dt = clock.dt;
     shootCooldown -= dt;
     energyCooldown -= dt;
     dodgeCooldown -= dt;
 }
 
 void AIController::UpdateEnemySeparation() {
-    switch (mode) {
-        case AIMode::Offensive:
-            separationFromEnemy = 600.0f;
-            break;
-        case AIMode::Defensive:
-            separationFromEnemy = 800.0f;
-            break;
-        case AIMode::Nuetral:
-            separationFromEnemy = 400.0;
-            break;
-    }
+    separationFromEnemy = behaviours.separation[behaviour];
 }
 
 float AIController::GetXDistanceToPlayer() {
@@ -211,65 +228,13 @@ float AIController::GetYDistanceToPlayer() {
     return yDiff;
 }
 
-bool AIController::IsBulletThreat(const Bullet& bullet) {
-    if (!bullet.active) return false;
-
-    float bx = bullet.rect.x + bullet.rect.width / 2;
-    float by = bullet.rect.y + bullet.rect.height / 2;
-
-    float sx = self->shipRect.x + self->shipRect.width / 2;
-    float sy = self->shipRect.y + self->shipRect.height / 2;
-
-    float vx = bullet.speed;
-
-    float tImpact = (sx - bx) / vx;
-    if (tImpact <= 0.0f) return false; // behind or already passed
-
-    const float reactionWindow = 2.0f; 
-    if (tImpact > reactionWindow) return false; 
-
-    float predictedY = by;
-    float verticalTolerance = self->shipRect.height * 0.6f; // tune
-    if (std::fabs(predictedY - sy) > verticalTolerance) return false;
-
-    return true;
-}
-
 bool AIController::AnyBulletThreatAhead() {
     float currentY = self->shipRect.y + self->shipRect.height / 2;
-    for (auto& bullet : enemy->bullets) {
-        if(IsBulletThreatAtY(bullet, currentY)) {
-            return true;
-        }
-    }
-    return false;
-}
-
-bool AIController::IsBulletThreatAtY(const Bullet& bullet, float Y) {
-    if (!bullet.active) return false;
-
-    float bx = bullet.rect.x + bullet.rect.width * 0.5f;
-    float by = bullet.rect.y + bullet.rect.height * 0.5f;
-
-    float sx = self->shipRect.x + self->shipRect.width * 0.5f;
-    float verticalTolerance = self->shipRect.height * 0.5f;
-
-    if (std::fabs(by - Y) > verticalTolerance) return false;
-
-    float vx = bullet.speed;
-    if (vx == 0.0f) return false;
-
-    float tImpact = (sx - bx) / vx;
-
-    const float nearWindow = 1.5f;
-    return (tImpact > 0.0f && tImpact <= nearWindow);
+    return self->threats.BulletAt(currentY, self->shipRect.height * 0.5f, params.nearBulletWindow) != nullptr;
 }
 
 bool AIController::AnyEnergyThreatAhead() {
-    for (auto ew : enemy->energyWeapons) {
-        if (ew.active) return true;
-    }
-    return false;
+    return !self->threats.Energy().empty();
 }
 
 
@@ -285,89 +250,76 @@ void AIController::UpdateThreatType() {
 
 }
 
+// Whether to dodge is each ship's own call, with its reaction time and
+// chance to miss a homing energy weapon
 bool AIController::ComputeDodgeForEnergy(Vector2& outDir) {
     Vector2 selfCenter = {
         self->shipRect.x + self->shipRect.width / 2,
         self->shipRect.y + self->shipRect.height / 2
     };
 
-    float bestScore = -1e9;
-    Vector2 bestDir = {0.0f, 0.0f};
-
-    for (auto &ew : enemy->energyWeapons) {
-        if(!ew.active || !ew.isHoming) continue;
+    const ProjectilePool& energy = self->projectiles.energy;
+    for (int i : self->threats.Energy()) {
+        if (!energy.homing[i]) continue;
 
-        float timeAlive = GetTime() - ew.timeEmmited;
+        float timeAlive = clock.time - energy.spawnTime[i];
         // Reaction time delay
-        if (timeAlive <= 0.2f) continue;
+        if (timeAlive <= params.energyReactionTime) continue;
 
-        // 30% chance not to dodge on a frame
-        if (GetRandomValue(0, 100) > 70) continue;
+        // Some chance not to dodge on a frame
+        if (random.Range(0, 100) > (int)std::lround(params.energyDodgeChance * 100.0f)) continue;
 
-        Vector2 toSelf = {selfCenter.x - ew.pos.x, selfCenter.y - ew.pos.y};
+        Vector2 ewDir = weapons::EnergyDirection(energy, i);
+        Vector2 toSelf = {selfCenter.x - energy.x[i], selfCenter.y - energy.y[i]};
 
         float dist2 = toSelf.x*toSelf.x + toSelf.y*toSelf.y;
         if (dist2 < 1e-6) continue;
-        Vector2 toSelfNorm = math::NormalizeVec(toSelf);
-
-        float alignment = math::Dot(toSelfNorm, ew.dir);
-        if (alignment < 0.3f) continue;
-
-        float score = alignment / sqrtf(dist2);
-
-        if (score > bestScore) {
-            Vector2 left = {-ew.dir.y, ew.dir.x};
-            Vector2 right = {ew.dir.y, -ew.dir.x};
-
-            float cross = math::CrossZ(ew.dir, toSelfNorm);
-
-            Vector2 chosen = (cross > 0.0f) ? left : right;
-
-            Vector2 selfAfter = {selfCenter.x + chosen.x * 100.0f, selfCenter.y + chosen.y * 100.0f};
-
-            bool insideY = (selfAfter.y + self->shipRect.height / 2  > 0.0f && selfAfter.y < (float)HEIGHT - self->shipRect.height / 2);
-            bool insideX = (selfAfter.x + self->shipRect.width / 2 < (self->shipSide == Side::LEFT ? WIDTH / 2 : WIDTH) && selfAfter.x > (self->shipSide == Side::LEFT ? 0.0f : WIDTH / 2));
 
-            if (!insideY || !insideX) {
-                // If chosen side would go-offscreen, flip to other perp vector
-                chosen = (chosen.x == left.x && chosen.y == left.y) ? right : left;
-            }
+        float alignment = math::Dot(math::NormalizeVec(toSelf), ewDir);
+        if (alignment < params.energyAlignment) continue;
 
-            bestScore = score;
-            bestDir = chosen;
-        }
-    }
-    if (bestScore > -1e8f) {
-        outDir = bestDir;
-        return true;
+        return FindSafestDirection(outDir);
     }
     return false;
 }
 
 bool AIController::ComputeDodgeForBullet(Vector2& outDir) {
-    Vector2 selfCenter = {
-        self->shipRect.x + self->shipRect.width / 2,
-        self->shipRect.y + self->shipRect.height / 2
-    };
-
-    for (auto& b : enemy->bullets) {
-        if (!b.active) continue;
-
-        if (!IsBulletThreat(b)) continue;
-
-        float by = b.rect.y + b.rect.height * 0.5f;
-        float yDiff = selfCenter.y - by;
+    float selfCenterY = self->shipRect.y + self->shipRect.height / 2;
 
-        outDir = {0.0f, (yDiff > 0.0f) ? 1.0f : -1.0f};
+    // Dodge once a bullet in line with the ship is close enough
+    if (!self->threats.BulletAt(selfCenterY, self->shipRect.height * 0.6f, params.bulletDodgeWindow)) return false;
 
-        float candidateY = selfCenter.y + outDir.y * 100;
-        if (candidateY < self->shipRect.height / 2) outDir.y = 1.0f;
-        if (candidateY > HEIGHT - self->shipRect.height / 2) outDir.y = -1.0f;
+    return FindSafestDirection(outDir);
+}
 
-        return true;
+// Looks where the ship could be a moment from now in the danger field its
+// team shares. The spot danger reaches last wins, and of equally safe ones
+// the one closest to where the behaviour was heading
+bool AIController::FindSafestDirection(Vector2& outDir) {
+    if (!self->danger) return false;
+
+    float step = self->shipVel * dodgeLookahead;
+    float minX = self->shipSide == Side::RIGHT ? WIDTH / 2 : 0.0f;
+    float maxX = minX + WIDTH / 2 - self->shipRect.width;
+    float maxY = HEIGHT - self->shipRect.height;
+
+    float bestTime = -1.0f;
+    float bestLean = 0.0f;
+    for (const Vector2& dir : dodgeDirections) {
+        // Moves into a wall slide along it, as the ship would
+        Rectangle moved = self->shipRect;
+        moved.x = std::clamp(moved.x + dir.x * step, minX, maxX);
+        moved.y = std::clamp(moved.y + dir.y * step, 0.0f, maxY);
+
+        float time = self->danger->TimeIn(Spaceship::HitBox(moved));
+        float lean = math::Dot(dir, plannedMove);
+        if (time > bestTime || (time == bestTime && lean > bestLean)) {
+            bestTime = time;
+            bestLean = lean;
+            outDir = dir;
+        }
     }
-
-    return false;
+    return true;
 }
 
 void AIController::UpdateDodgeDir() {
@@ -408,7 +360,7 @@ bool AIController::TryDodge(ControlState& state) {
         dodgeDir = newDir;
         isDodging = true;
         currentThreat = ThreatType::Energy;
-        dodgeCooldown = 1.2f + GetRandomValue(-20, 20) / 100.0f;
+        dodgeCooldown = params.energyDodgeCooldown + random.Range(-20, 20) / 100.0f;
         state.moveX = dodgeDir.x;
         state.moveY = dodgeDir.y;
         return true;
@@ -418,7 +370,7 @@ bool AIController::TryDodge(ControlState& state) {
         dodgeDir = newDir;
         isDodging = true;
         currentThreat = ThreatType::Bullet;
-        dodgeCooldown = 1.0f + GetRandomValue(-20, 20) / 100.0f;
+        dodgeCooldown = params.bulletDodgeCooldown + random.Range(-20, 20) / 100.0f;
         state.moveX = dodgeDir.x;
         state.moveY = dodgeDir.y;
         return true;
@@ -0,0 +1,74 @@
+#include "controllers/AIParams.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#define AI_PARAM(name, min, max, member) {name, min, max, [](AIParams& p) -> float& { return p.member; }}
+
+const std::vector<AIParamInfo>& AIParamTable() {
+    static const std::vector<AIParamInfo> table = {
+        AI_PARAM("shootCooldown.offensive", 0.05f, 1.5f, shootCooldown[0]),
+        AI_PARAM("shootCooldown.defensive", 0.05f, 1.5f, shootCooldown[1]),
+        AI_PARAM("shootCooldown.neutral", 0.05f, 1.5f, shootCooldown[2]),
+        AI_PARAM("energyCooldown.offensive", 0.5f, 10.0f, energyCooldown[0]),
+        AI_PARAM("energyCooldown.defensive", 0.5f, 10.0f, energyCooldown[1]),
+        AI_PARAM("energyCooldown.neutral", 0.5f, 10.0f, energyCooldown[2]),
+        AI_PARAM("separation.offensive", 100.0f, 950.0f, separation[0]),
+        AI_PARAM("separation.defensive", 100.0f, 950.0f, separation[1]),
+        AI_PARAM("separation.neutral", 100.0f, 950.0f, separation[2]),
+        AI_PARAM("dodgeWeight.offensive", 0.0f, 1.0f, dodgeWeight[0]),
+        AI_PARAM("dodgeWeight.defensive", 0.0f, 1.0f, dodgeWeight[1]),
+        AI_PARAM("dodgeWeight.neutral", 0.0f, 1.0f, dodgeWeight[2]),
+        AI_PARAM("defensiveHealthRatio", 0.2f, 1.0f, defensiveHealthRatio),
+        AI_PARAM("nearBulletWindow", 0.1f, 2.0f, nearBulletWindow),
+        AI_PARAM("bulletDodgeWindow", 0.1f, 2.0f, bulletDodgeWindow),
+        AI_PARAM("verticalDeadZone", 0.0f, 80.0f, verticalDeadZone),
+        AI_PARAM("energyReactionTime", 0.0f, 1.0f, energyReactionTime),
+        AI_PARAM("energyDodgeChance", 0.0f, 1.0f, energyDodgeChance),
+        AI_PARAM("energyAlignment", -0.5f, 0.95f, energyAlignment),
+        AI_PARAM("bulletDodgeCooldown", 0.2f, 3.0f, bulletDodgeCooldown),
+        AI_PARAM("energyDodgeCooldown", 0.2f, 3.0f, energyDodgeCooldown),
+    };
+    return table;
+}
+
+#undef AI_PARAM
+
+bool AIParams::Save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    AIParams copy = *this;
+    for (const AIParamInfo& info : AIParamTable()) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%s %.9g\n", info.name, info.field(copy));
+        file << line;
+    }
+    return (bool)file;
+}
+
+bool AIParams::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    AIParams loaded = *this;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string name;
+        float value;
+        if (!(in >> name) || name[0] == '#') continue;
+        if (!(in >> value)) return false;
+
+        bool known = false;
+        for (const AIParamInfo& info : AIParamTable()) {
+            if (name != info.name) continue;
+            info.field(loaded) = value;
+            known = true;
+        }
+        if (!known) return false;
+    }
+
+    *this = loaded;
+    return true;
+}
@@ -0,0 +1,152 @@
+#include "controllers/LookaheadController.hpp"
+#include "core/config.h"
+#include <chrono>
+
+// Rollouts play this many seconds, a step of lookaheadStepTicks ticks at a time
+const float lookaheadHorizon = 0.5f;
+const int lookaheadStepTicks = 2;
+const int lookaheadSteps = (int)(lookaheadHorizon * TICK_RATE) / lookaheadStepTicks;
+
+// Ticks a plan is followed before searching again
+const int replanInterval = 4;
+
+// Ships and projectiles copied into a fork
+const int lookaheadEnemies = 3;
+const int lookaheadBullets = 96;
+const int lookaheadEnergy = 24;
+
+// What a rollout step costs, flat and per ship and projectile pair in the
+// fork as every ship is hit tested against every projectile, which turns
+// LOOKAHEAD_BUDGET_US into a number of rollouts. A line above the 99th
+// percentile of measured time per rollout step, copy included, over duels
+// (24 to 38 pairs) and arenas (up to 520 pairs) of --hard both, so searches
+// only go over the budget when the thread is preempted. Measured cost
+// levels off past about 240 pairs, so a squared term buys nothing. The
+// headless lookahead report prints measured against modelled time
+const float stepNanoseconds = 450.0f;
+const float pairNanoseconds = 14.0f;
+
+// Damage taken counts for more than damage dealt
+const float takenWeight = 2.0f;
+
+LookaheadController::LookaheadController(Spaceship* selfShip, Spaceship* enemyShip, const std::vector<std::unique_ptr<Spaceship>>& worldShips, uint64_t seed, const AIParams& params)
+    : ai(selfShip, enemyShip, seed, params), self(selfShip), ships(worldShips),
+      root(lookaheadEnemies, lookaheadBullets, lookaheadEnergy),
+      fork(lookaheadEnemies, lookaheadBullets, lookaheadEnergy) {
+    candidates.reserve(20);
+}
+
+ControlState LookaheadController::GetState(const SimClock& simClock) {
+    ControlState state = ai.GetState(simClock);
+
+    if (--ticksUntilPlan <= 0) {
+        Plan(simClock, state);
+        ticksUntilPlan = replanInterval;
+    }
+
+    if (overriding) {
+        state.moveX = plan.x;
+        state.moveY = plan.y;
+    }
+    return state;
+}
+
+// The AI's own move goes first and wins ties, so the search only steps in
+// when it finds something clearly better. When not even that fits the
+// budget there is no search, and the AI's move stands
+void LookaheadController::Plan(const SimClock& clock, const ControlState& suggested) {
+    overriding = false;
+
+    root.Capture(ships, *self, clock.time, lookaheadHorizon);
+    if (!root.Threatened()) return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    Vector2 own = {suggested.moveX, suggested.moveY};
+    candidates.clear();
+    candidates.push_back({own, own});
+    for (int pass = 0; pass < 2; pass++) {
+        for (float y : {0.0f, -1.0f, 1.0f}) {
+            for (float x : {0.0f, -1.0f, 1.0f}) {
+                Vector2 dir = {x, y};
+                Vector2 then = pass == 0 ? dir : Vector2{0.0f, 0.0f};
+                if (dir.x == own.x && dir.y == own.y && then.x == own.x && then.y == own.y) continue;
+                if (pass == 1 && x == 0.0f && y == 0.0f) continue;
+                candidates.push_back({dir, then});
+            }
+        }
+    }
+
+    // Bullets fired during a rollout add to its cost, so allow for a couple a ship
+    float budget = LOOKAHEAD_BUDGET_US * 1000.0f;
+    int shipCount = (int)root.ships.size();
+    float pairs = (float)shipCount * (root.Size() + shipCount * 2);
+    float rolloutCost = lookaheadSteps * (stepNanoseconds + pairNanoseconds * pairs);
+
+    float bestScore = 0.0f;
+    size_t best = 0;
+    float spent = 0.0f;
+    for (size_t c = 0; c < candidates.size() && spent + rolloutCost <= budget; c++) {
+        float score = Rollout(candidates[c]);
+        spent += rolloutCost;
+        stats.rollouts++;
+
+        if (c == 0 || score > bestScore) {
+            bestScore = score;
+            best = c;
+        }
+    }
+
+    overriding = best != 0;
+    plan = candidates[best].first;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.plans++;
+    stats.seconds += seconds;
+    stats.modelledSeconds += spent * 1e-9;
+    stats.worstSeconds = std::max(stats.worstSeconds, seconds);
+    if (seconds * 1e6 > LOOKAHEAD_BUDGET_US) stats.overBudget++;
+}
+
+float LookaheadController::Rollout(const Candidate& candidate) {
+    fork = root;
+
+    ControlState control;
+    for (int step = 0; step < lookaheadSteps; step++) {
+        Vector2 dir = step < lookaheadSteps / 2 ? candidate.first : candidate.then;
+        control.moveX = dir.x;
+        control.moveY = dir.y;
+        fork.Step(control, TICK_DT * lookaheadStepTicks);
+    }
+
+    const LookaheadShip& ship = fork.ships[0];
+    return ship.damageDealt - ship.damageTaken * takenWeight;
+}
+
+void LookaheadController::SaveState(ByteWriter& out) const {
+    ai.SaveState(out);
+    out.F32(plan.x);
+    out.F32(plan.y);
+    out.U8(overriding ? 1 : 0);
+    out.Varint((uint64_t)std::max(ticksUntilPlan, 0));
+}
+
+void LookaheadController::LoadState(ByteReader& in) {
+    ai.LoadState(in);
+    plan.x = in.F32();
+    plan.y = in.F32();
+    overriding = in.U8() != 0;
+    ticksUntilPlan = (int)in.Varint();
+}
+
+// Stats carry on, as they count every search the controller has made
+void LookaheadController::Reset() {
+    ai.Reset();
+    plan = {0.0f, 0.0f};
+    overriding = false;
+    ticksUntilPlan = 0;
+}
+
+const LookaheadStats& LookaheadController::GetStats() const {
+    return stats;
+}
@@ -5,7 +5,7 @@
 PlayerController::PlayerController(const std::vector<int>& move, int shootBullet, int shootEnergy)
     : moveKeys(move), shootBulletKey(shootBullet), shootEnergyKey(shootEnergy) {}
 
-ControlState PlayerController::GetState() {
+ControlState PlayerController::GetState(const SimClock& clock) {
     ControlState state;
     float targetX = 0.0f;
     float targetY = 0.0f;
@@ -15,7 +15,7 @@ ControlState PlayerController::GetState() {
     if (IsKeyDown(moveKeys[2])) targetX -= 1.0f;
     if (IsKeyDown(moveKeys[3])) targetX += 1.0f;
 
-    float dt = GetFrameTime();
+    float dt = clock.dt;
 
     auto lerp = [&](float current, float target) {
         return current + (target - current) * rampSpeed * dt;
@@ -25,8 +25,36 @@ ControlState PlayerController::GetState() {
 
     state.moveX = moveX;
     state.moveY = moveY;
-    state.shootBullet = IsKeyPressed(shootBulletKey);
-    state.shootEnergy = IsKeyPressed(shootEnergyKey);
+    state.shootBullet = shootBulletPressed;
+    state.shootEnergy = shootEnergyPressed;
+    shootBulletPressed = false;
+    shootEnergyPressed = false;
 
     return state;
+}
+
+void PlayerController::SaveState(ByteWriter& out) const {
+    out.F32(moveX);
+    out.F32(moveY);
+    out.U8((uint8_t)shootBulletPressed | (uint8_t)(shootEnergyPressed << 1));
+}
+
+void PlayerController::LoadState(ByteReader& in) {
+    moveX = in.F32();
+    moveY = in.F32();
+    uint8_t pressed = in.U8();
+    shootBulletPressed = pressed & 1;
+    shootEnergyPressed = (pressed >> 1) & 1;
+}
+
+void PlayerController::Reset() {
+    moveX = 0.0f;
+    moveY = 0.0f;
+    shootBulletPressed = false;
+    shootEnergyPressed = false;
+}
+
+void PlayerController::PollInput() {
+    if (IsKeyPressed(shootBulletKey)) shootBulletPressed = true;
+    if (IsKeyPressed(shootEnergyKey)) shootEnergyPressed = true;
 }
\ No newline at end of file
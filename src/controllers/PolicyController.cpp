@@ -0,0 +1,70 @@
+#include "controllers/PolicyController.hpp"
+#include "core/Observation.hpp"
+#include "core/JobSystem.hpp"
+#include <algorithm>
+
+// Ships observed per job
+const int observeGrain = 16;
+
+PolicyBatch::PolicyBatch(std::shared_ptr<const Policy> batchPolicy)
+    : policy(std::move(batchPolicy)) {}
+
+void PolicyBatch::Run(const SimClock& clock, JobSystem* jobs) {
+    (void)clock;
+
+    rows.clear();
+    for (PolicyController* member : members) {
+        member->row = -1;
+        Spaceship* enemy = member->enemy ? member->enemy : member->self->target;
+        if (member->self->IsDead() || !enemy) continue;
+
+        member->row = (int)rows.size();
+        rows.push_back(member);
+    }
+    if (rows.empty()) return;
+
+    size_t needed = rows.size() * observation::size;
+    if (observations.size() < needed) observations.resize(needed);
+
+    auto observe = [this](int begin, int end) {
+        for (int r = begin; r < end; r++) {
+            PolicyController& member = *rows[r];
+            const Spaceship& enemy = member.enemy ? *member.enemy : *member.self->target;
+            observation::Write(*member.self, enemy, member.fullHealth, observations.data() + (size_t)r * observation::size);
+        }
+    };
+    if (jobs) jobs->ParallelFor((int)rows.size(), observeGrain, observe);
+    else observe(0, (int)rows.size());
+
+    results = policy->Forward(observations.data(), (int)rows.size(), scratch);
+}
+
+PolicyController::PolicyController(Spaceship* selfShip, Spaceship* enemyShip, std::shared_ptr<PolicyBatch> policyBatch)
+    : self(selfShip), enemy(enemyShip), fullHealth(selfShip->health), batch(std::move(policyBatch)) {
+    batch->members.push_back(this);
+}
+
+PolicyController::~PolicyController() {
+    auto& members = batch->members;
+    members.erase(std::find(members.begin(), members.end(), this));
+}
+
+ThinkBatch* PolicyController::GetThinkBatch() {
+    return batch.get();
+}
+
+// Movement is mirrored back for a ship on the right, as in VecEnv
+ControlState PolicyController::GetState(const SimClock& clock) {
+    (void)clock;
+
+    ControlState state;
+    if (row < 0) return state;
+
+    const float* out = batch->results + (size_t)row * batch->policy->OutputStride();
+    float flip = self->shipSide == Side::RIGHT ? -1.0f : 1.0f;
+    state.moveX = QuantizeAxis(flip * out[0]);
+    state.moveY = QuantizeAxis(out[1]);
+    state.shootBullet = out[2] > 0.0f;
+    state.shootEnergy = out[3] > 0.0f;
+    return state;
+}
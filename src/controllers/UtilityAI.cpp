@@ -0,0 +1,244 @@
+#include "controllers/UtilityAI.hpp"
+#include "core/config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+// As written in behaviour files, in enum order
+static const char* inputNames[] = {
+    "health", "enemy_health", "health_ratio", "health_lead", "distance_x", "distance_y",
+    "bullet_threats", "energy_threats", "bullets_left", "energy_left"
+};
+static const char* curveNames[] = {"linear", "polynomial", "logistic", "step_above", "step_below"};
+
+static_assert(sizeof(inputNames) / sizeof(inputNames[0]) == (size_t)UtilityInput::Count, "an input without a name");
+
+template <size_t N>
+static int FindName(const char* (&names)[N], const std::string& name) {
+    for (size_t i = 0; i < N; i++) {
+        if (name == names[i]) return (int)i;
+    }
+    return -1;
+}
+
+static bool KnownParam(const std::string& name) {
+    for (const AIParamInfo& info : AIParamTable()) {
+        if (name == info.name) return true;
+    }
+    return false;
+}
+
+static bool ParseValue(const std::string& text, UtilityValue& out) {
+    if (text.size() > 1 && text[0] == '$') {
+        out.param = text.substr(1);
+        return KnownParam(out.param);
+    }
+    char* end = nullptr;
+    out.value = std::strtof(text.c_str(), &end);
+    out.param.clear();
+    return end != text.c_str() && *end == '\0';
+}
+
+// Properties every behaviour must set, as bits of a mask
+enum RequiredProperty {
+    ShootCooldownSet = 1,
+    EnergyCooldownSet = 2,
+    SeparationSet = 4,
+    DodgeWeightSet = 8,
+    AllSet = 15
+};
+
+bool UtilityDefinition::Load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    UtilityDefinition loaded;
+    std::vector<int> set; // RequiredProperty mask per behaviour
+    std::string line;
+    int number = 0;
+    auto fail = [&](const std::string& why) {
+        error = path + ":" + std::to_string(number) + ": " + why;
+        return false;
+    };
+
+    while (std::getline(file, line)) {
+        number++;
+        std::istringstream in(line);
+        std::string key;
+        if (!(in >> key) || key[0] == '#') continue;
+
+        if (key == "behaviour") {
+            std::string name;
+            if (!(in >> name)) return fail("behaviour needs a name");
+            loaded.behaviours.emplace_back();
+            loaded.behaviours.back().name = name;
+            loaded.behaviours.back().weight.value = 1.0f;
+            set.push_back(0);
+        }
+        else if (loaded.behaviours.empty()) {
+            return fail(key + " before the first behaviour");
+        }
+        else if (key == "consider") {
+            std::string input, curve, option;
+            if (!(in >> input >> curve)) return fail("consider needs an input and a curve");
+
+            UtilityConsideration consideration;
+            int inputIndex = FindName(inputNames, input);
+            int curveIndex = FindName(curveNames, curve);
+            if (inputIndex < 0) return fail("unknown input " + input);
+            if (curveIndex < 0) return fail("unknown curve " + curve);
+            consideration.input = (UtilityInput)inputIndex;
+            consideration.curve = (ResponseCurve)curveIndex;
+            consideration.m.value = 1.0f;
+            consideration.k.value = 1.0f;
+
+            // m=, k=, b= and c=, in any order, each defaulting as above
+            while (in >> option) {
+                UtilityValue* target = nullptr;
+                if (option.size() > 2 && option[1] == '=') {
+                    switch (option[0]) {
+                        case 'm': target = &consideration.m; break;
+                        case 'k': target = &consideration.k; break;
+                        case 'b': target = &consideration.b; break;
+                        case 'c': target = &consideration.c; break;
+                    }
+                }
+                if (!target || !ParseValue(option.substr(2), *target)) return fail("bad curve option " + option);
+            }
+            loaded.behaviours.back().considerations.push_back(consideration);
+            continue;
+        }
+        else {
+            UtilityBehaviour& behaviour = loaded.behaviours.back();
+            std::string text;
+            if (!(in >> text)) return fail(key + " needs a value");
+
+            UtilityValue* target = nullptr;
+            int bit = 0;
+            if (key == "weight") target = &behaviour.weight;
+            else if (key == "shootCooldown") { target = &behaviour.shootCooldown; bit = ShootCooldownSet; }
+            else if (key == "energyCooldown") { target = &behaviour.energyCooldown; bit = EnergyCooldownSet; }
+            else if (key == "separation") { target = &behaviour.separation; bit = SeparationSet; }
+            else if (key == "dodgeWeight") { target = &behaviour.dodgeWeight; bit = DodgeWeightSet; }
+            else if (key == "strictCooldowns") {
+                if (text != "0" && text != "1") return fail("strictCooldowns is 0 or 1");
+                behaviour.strictCooldowns = text == "1";
+            }
+            else return fail("unknown setting " + key);
+
+            if (target && !ParseValue(text, *target)) return fail("bad value " + text + " for " + key);
+            set.back() |= bit;
+        }
+
+        std::string extra;
+        if (in >> extra) return fail("unexpected " + extra);
+    }
+
+    if (loaded.behaviours.empty()) return fail("no behaviours");
+    for (size_t i = 0; i < loaded.behaviours.size(); i++) {
+        if (set[i] != AllSet) {
+            error = path + ": " + loaded.behaviours[i].name + " needs shootCooldown, energyCooldown, separation and dodgeWeight";
+            return false;
+        }
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
+
+const UtilityDefinition& DefaultUtilityDefinition() {
+    static const UtilityDefinition definition = []() {
+        UtilityDefinition loaded;
+        std::string error;
+        if (!loaded.Load(AI_BEHAVIOURS_PATH, error)) {
+            std::fprintf(stderr, "could not load AI behaviours: %s\n", error.c_str());
+            std::exit(1);
+        }
+        return loaded;
+    }();
+    return definition;
+}
+
+UtilityTable::UtilityTable(const UtilityDefinition& definition, const AIParams& params) {
+    AIParams lookup = params;
+    auto resolve = [&lookup](const UtilityValue& value) {
+        if (value.param.empty()) return value.value;
+        for (const AIParamInfo& info : AIParamTable()) {
+            if (value.param == info.name) return info.field(lookup);
+        }
+        return value.value;
+    };
+
+    const std::vector<UtilityBehaviour>& behaviours = definition.behaviours;
+    std::vector<float> weights;
+    for (const UtilityBehaviour& behaviour : behaviours) {
+        weights.push_back(resolve(behaviour.weight));
+    }
+    std::vector<int> order(behaviours.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return weights[a] > weights[b]; });
+
+    firstConsideration.push_back(0);
+    for (int i : order) {
+        const UtilityBehaviour& behaviour = behaviours[i];
+        names.push_back(behaviour.name);
+        weight.push_back(weights[i]);
+        shootCooldown.push_back(resolve(behaviour.shootCooldown));
+        energyCooldown.push_back(resolve(behaviour.energyCooldown));
+        separation.push_back(resolve(behaviour.separation));
+        dodgeWeight.push_back(resolve(behaviour.dodgeWeight));
+        strictCooldowns.push_back(behaviour.strictCooldowns);
+
+        for (const UtilityConsideration& consideration : behaviour.considerations) {
+            considerations.push_back({
+                (uint8_t)consideration.input, (uint8_t)consideration.curve,
+                resolve(consideration.m), resolve(consideration.k), resolve(consideration.b), resolve(consideration.c)
+            });
+        }
+        firstConsideration.push_back((int)considerations.size());
+    }
+}
+
+int UtilityTable::Size() const {
+    return (int)weight.size();
+}
+
+int UtilityTable::Choose(const float* inputs) const {
+    int best = 0;
+    float bestScore = -1.0f;
+
+    for (int i = 0; i < Size(); i++) {
+        // Considerations only scale a weight down, and later weights are no higher
+        if (weight[i] <= bestScore) break;
+
+        float score = weight[i];
+        for (int j = firstConsideration[i]; j < firstConsideration[i + 1] && score > bestScore; j++) {
+            const Consideration& consideration = considerations[j];
+            float x = inputs[consideration.input];
+            float y;
+            switch ((ResponseCurve)consideration.curve) {
+                case ResponseCurve::Linear: y = consideration.m * (x - consideration.c) + consideration.b; break;
+                case ResponseCurve::Polynomial: y = consideration.m * std::pow(x - consideration.c, consideration.k) + consideration.b; break;
+                case ResponseCurve::Logistic: y = consideration.k / (1.0f + std::exp(-consideration.m * (x - consideration.c))) + consideration.b; break;
+                case ResponseCurve::StepAbove: y = x > consideration.c ? consideration.k : consideration.b; break;
+                case ResponseCurve::StepBelow: y = x < consideration.c ? consideration.k : consideration.b; break;
+                default: y = 0.0f; break;
+            }
+            // Also catches NaN, from a fractional power of a negative
+            score *= y > 0.0f ? std::min(y, 1.0f) : 0.0f;
+        }
+
+        if (score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+    return best;
+}
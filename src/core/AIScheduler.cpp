@@ -0,0 +1,129 @@
+#include "core/AIScheduler.hpp"
+#include "core/config.h"
+#include <algorithm>
+#include <cmath>
+
+// What one AIController think costs, measured with --think-times at the
+// slow end of arena battles, threat and danger field queries included
+const float thinkNanoseconds = 1000.0f;
+
+// Longest a ship may go without thinking, in ticks. Ships about to be hit,
+// with less than imminentThreat seconds to go, are held to every other tick
+const int maxThinkInterval = 8;
+const int maxImminentInterval = 2;
+const float imminentThreat = 0.35f;
+
+// A target this far away counts as a threat this many seconds out
+const float targetClosingSpeed = 600.0f;
+
+void AIScheduler::Resize(int shipCount) {
+    interval.assign(shipCount, 1);
+    ticksSinceThink.assign(shipCount, 0);
+    covered.assign(shipCount, 1);
+    thinks.assign(shipCount, 1);
+    thought.assign(shipCount, 0);
+    skipped.assign(shipCount, 0);
+}
+
+void AIScheduler::SetBudget(float microseconds) {
+    budgetMicroseconds = microseconds;
+}
+
+// Seconds until the soonest bullet or energy weapon could hit, or until the
+// ship closes on its target, whichever is first
+float AIScheduler::TimeToThreat(const Spaceship& ship) const {
+    float soonest = bulletThreatWindow;
+    const std::vector<IncomingBullet>& bullets = ship.threats.Bullets();
+    if (!bullets.empty()) soonest = std::min(soonest, bullets.front().time);
+
+    Vector2 center = ship.GetCenter();
+    const std::vector<int>& energy = ship.threats.Energy();
+    if (!energy.empty()) {
+        const ProjectilePool& pool = ship.projectiles.energy;
+        float distance = std::hypot(pool.x[energy.front()] - center.x, pool.y[energy.front()] - center.y);
+        soonest = std::min(soonest, distance / energySpeed);
+    }
+
+    if (ship.target) {
+        Vector2 other = ship.target->GetCenter();
+        soonest = std::min(soonest, std::hypot(other.x - center.x, other.y - center.y) / targetClosingSpeed);
+    }
+    return soonest;
+}
+
+// Every AI ship thinks every tick while the budget covers it. Past that,
+// ships are let off in order of how far off their next threat is, calm ones
+// down to every maxThinkInterval ticks and imminent ones to every other
+// tick, until what is left fits. If even that is over, the budget goes
+// over rather than leave ships in danger any less attended
+void AIScheduler::Schedule(const std::vector<std::unique_ptr<Spaceship>>& ships, long tick) {
+    ranked.clear();
+    for (auto& ship : ships) {
+        interval[ship->id] = 1;
+        if (ship->IsDead() || !ship->controller->AllowsThinkSkipping()) continue;
+        ranked.push_back({0.0f, ship->id});
+    }
+
+    float affordable = budgetMicroseconds * 1000.0f / thinkNanoseconds;
+    if (budgetMicroseconds > 0.0f && ranked.size() > affordable) {
+        for (auto& [time, id] : ranked) {
+            time = TimeToThreat(*ships[id]);
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        });
+
+        float thinksPerTick = (float)ranked.size();
+        for (auto& [time, id] : ranked) {
+            if (thinksPerTick <= affordable) break;
+
+            interval[id] = time < imminentThreat ? maxImminentInterval : maxThinkInterval;
+            thinksPerTick -= 1.0f - 1.0f / interval[id];
+        }
+    }
+
+    for (auto& ship : ships) {
+        int i = ship->id;
+        thinks[i] = 0;
+        if (ship->IsDead()) continue;
+
+        ticksSinceThink[i]++;
+        thinks[i] = ticksSinceThink[i] >= interval[i] || (tick + i) % interval[i] == 0;
+        covered[i] = ticksSinceThink[i];
+        if (thinks[i]) {
+            ticksSinceThink[i] = 0;
+            thought[i]++;
+        } else {
+            skipped[i]++;
+        }
+    }
+}
+
+bool AIScheduler::Thinks(int ship) const {
+    return thinks[ship] != 0;
+}
+
+int AIScheduler::TicksCovered(int ship) const {
+    return covered[ship];
+}
+
+long AIScheduler::ThoughtCount(int ship) const {
+    return thought[ship];
+}
+
+long AIScheduler::SkippedCount(int ship) const {
+    return skipped[ship];
+}
+
+void AIScheduler::SaveState(ByteWriter& out) const {
+    for (int since : ticksSinceThink) {
+        out.Varint((uint64_t)since);
+    }
+}
+
+bool AIScheduler::LoadState(ByteReader& in) {
+    for (int& since : ticksSinceThink) {
+        since = (int)std::min<uint64_t>(in.Varint(), maxThinkInterval);
+    }
+    return in.ok;
+}
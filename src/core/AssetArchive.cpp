@@ -0,0 +1,347 @@
+#include "core/AssetArchive.hpp"
+#include "core/ByteStream.hpp"
+#include "core/config.h"
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+static const uint32_t archiveMagic = 0x4B504753; // "SGPK"
+static const uint32_t archiveVersion = 1;
+static const size_t headerSize = 16;
+
+// Asset data starts on boundaries of this, so each asset is whole pages
+// that are only read in when it is loaded
+static const size_t archivePage = 4096;
+
+static std::string NormalPath(const std::string& path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+static size_t PageAlign(size_t offset) {
+    return (offset + archivePage - 1) / archivePage * archivePage;
+}
+
+// Bytes the fields say the data is, or 0 if they make no sense. Kind 0 is
+// an image, 1 a wave
+static uint64_t ExpectedSize(uint8_t kind, const uint32_t* fields) {
+    if (kind == 0) {
+        if (fields[3] != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || fields[2] != 1) return 0;
+        return (uint64_t)fields[0] * fields[1] * 4;
+    }
+    if (fields[2] != 8 && fields[2] != 16 && fields[2] != 32) return 0;
+    return (uint64_t)fields[0] * fields[3] * (fields[2] / 8);
+}
+
+AssetArchive::~AssetArchive() {
+    Close();
+}
+
+bool AssetArchive::Open(const std::string& path) {
+    Close();
+
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size >= (off_t)headerSize) {
+        mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file); // The mapping keeps the file
+    if (mapped == MAP_FAILED) return false;
+
+    mapping = (const uint8_t*)mapped;
+    mappedSize = (size_t)info.st_size;
+
+    ByteReader header(mapping, headerSize);
+    uint32_t magic = header.U32();
+    uint32_t version = header.U32();
+    uint32_t count = header.U32();
+    uint32_t indexSize = header.U32();
+    if (magic != archiveMagic || version != archiveVersion || indexSize > mappedSize - headerSize) {
+        Close();
+        return false;
+    }
+
+    ByteReader index(mapping + headerSize, indexSize);
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count && index.ok; i++) {
+        Entry entry;
+        uint16_t length = index.U16();
+        const uint8_t* name = index.Skip(length);
+        if (!name) break;
+
+        entry.path.assign((const char*)name, length);
+        uint8_t kind = index.U8();
+        for (uint32_t& field : entry.fields) {
+            field = index.U32();
+        }
+        uint64_t offset = index.U64();
+        entry.size = index.U64();
+
+        // Data the fields don't account for, or past the end, means a
+        // damaged archive rather than one asset to skip
+        if (kind > 1 || offset > mappedSize || entry.size > mappedSize - offset || entry.size != ExpectedSize(kind, entry.fields)) {
+            index.ok = false;
+            break;
+        }
+        entry.kind = (Kind)kind;
+        entry.data = mapping + offset;
+        entries.push_back(std::move(entry));
+    }
+
+    if (!index.ok || entries.size() != count) {
+        Close();
+        return false;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    return true;
+}
+
+void AssetArchive::Close() {
+    if (mapping) munmap((void*)mapping, mappedSize);
+    mapping = nullptr;
+    mappedSize = 0;
+    entries.clear();
+}
+
+bool AssetArchive::IsOpen() const {
+    return mapping != nullptr;
+}
+
+const AssetArchive::Entry* AssetArchive::Find(const std::string& path, Kind kind) const {
+    std::string normal = NormalPath(path);
+    auto found = std::lower_bound(entries.begin(), entries.end(), normal, [](const Entry& entry, const std::string& key) { return entry.path < key; });
+    if (found == entries.end() || found->path != normal || found->kind != kind) return nullptr;
+    return &*found;
+}
+
+bool AssetArchive::FindImage(const std::string& path, Image& image) const {
+    const Entry* entry = Find(path, Kind::Image);
+    if (!entry) return false;
+
+    image = {(void*)entry->data, (int)entry->fields[0], (int)entry->fields[1], (int)entry->fields[2], (int)entry->fields[3]};
+    return true;
+}
+
+bool AssetArchive::FindWave(const std::string& path, Wave& wave) const {
+    const Entry* entry = Find(path, Kind::Wave);
+    if (!entry) return false;
+
+    wave = {entry->fields[0], entry->fields[1], entry->fields[2], entry->fields[3], (void*)entry->data};
+    return true;
+}
+
+std::vector<std::string> AssetArchive::Paths() const {
+    std::vector<std::string> paths;
+    for (const Entry& entry : entries) {
+        paths.push_back(entry.path);
+    }
+    return paths;
+}
+
+size_t AssetArchive::MappedBytes() const {
+    return mappedSize;
+}
+
+bool PackAssets(const std::vector<std::string>& directories, const std::string& archivePath) {
+    struct Packed {
+        std::string path;
+        uint8_t kind;
+        uint32_t fields[4];
+        std::vector<uint8_t> data;
+    };
+    std::vector<Packed> assets;
+
+    std::vector<std::string> paths;
+    for (const std::string& directory : directories) {
+        std::error_code error;
+        for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+            paths.push_back(NormalPath(file.path().string()));
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for (const std::string& path : paths) {
+        std::string extension = std::filesystem::path(path).extension().string();
+        Packed asset;
+        asset.path = path;
+
+        if (extension == ".png") {
+            Image image = LoadImage(path.c_str());
+            if (!image.data) {
+                std::fprintf(stderr, "could not load %s\n", path.c_str());
+                return false;
+            }
+            ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+            asset.kind = 0;
+            uint32_t fields[4] = {(uint32_t)image.width, (uint32_t)image.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+            std::memcpy(asset.fields, fields, sizeof(fields));
+            const uint8_t* pixels = (const uint8_t*)image.data;
+            asset.data.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+            UnloadImage(image);
+        }
+        else if (extension == ".wav" || extension == ".mp3" || extension == ".ogg") {
+            Wave wave = LoadWave(path.c_str());
+            if (!wave.data) {
+                std::fprintf(stderr, "could not load %s\n", path.c_str());
+                return false;
+            }
+
+            asset.kind = 1;
+            uint32_t fields[4] = {wave.frameCount, wave.sampleRate, wave.sampleSize, wave.channels};
+            std::memcpy(asset.fields, fields, sizeof(fields));
+            const uint8_t* samples = (const uint8_t*)wave.data;
+            asset.data.assign(samples, samples + (size_t)wave.frameCount * wave.channels * (wave.sampleSize / 8));
+            UnloadWave(wave);
+        }
+        else continue;
+
+        assets.push_back(std::move(asset));
+    }
+
+    // The index's size is known before any offset is, as offsets are fixed width
+    size_t indexSize = 0;
+    for (const Packed& asset : assets) {
+        indexSize += 2 + asset.path.size() + 1 + 4 * 4 + 8 + 8;
+    }
+
+    ByteWriter out;
+    out.U32(archiveMagic);
+    out.U32(archiveVersion);
+    out.U32((uint32_t)assets.size());
+    out.U32((uint32_t)indexSize);
+
+    size_t offset = PageAlign(headerSize + indexSize);
+    for (const Packed& asset : assets) {
+        out.U16((uint16_t)asset.path.size());
+        out.Bytes(asset.path.data(), asset.path.size());
+        out.U8(asset.kind);
+        for (uint32_t field : asset.fields) {
+            out.U32(field);
+        }
+        out.U64(offset);
+        out.U64(asset.data.size());
+        offset = PageAlign(offset + asset.data.size());
+    }
+
+    for (const Packed& asset : assets) {
+        out.bytes.resize(PageAlign(out.Size()), 0);
+        out.Bytes(asset.data.data(), asset.data.size());
+    }
+
+    if (!WriteFileBytes(archivePath, out.bytes)) {
+        std::fprintf(stderr, "could not write %s\n", archivePath.c_str());
+        return false;
+    }
+    std::printf("packed %zu assets into %s, %zu bytes\n", assets.size(), archivePath.c_str(), out.Size());
+    return true;
+}
+
+int RunPackCommand(int argc, char** argv) {
+    std::string out = ASSET_ARCHIVE;
+    std::vector<std::string> directories;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) out = argv[++i];
+        else if (arg.rfind("--", 0) == 0) {
+            std::printf("usage: main --pack-assets [--out FILE] [DIRECTORY...]\n");
+            return 1;
+        }
+        else directories.push_back(arg);
+    }
+    if (directories.empty()) directories = {"assets/images", "assets/sounds"};
+
+    return PackAssets(directories, out) ? 0 : 1;
+}
+
+// What the window and audio device are handed at startup, worked out either
+// way. Both end by reading every byte, as uploading them would, so the
+// archive's pages are counted as they would be in the game
+int RunLoadBenchCommand(int argc, char** argv) {
+    std::string archivePath;
+    std::vector<std::string> directories = {"assets/images", "assets/sounds"};
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--archive" && i + 1 < argc) archivePath = argv[++i];
+        else {
+            std::printf("usage: main --bench-load [--archive FILE]\n");
+            std::printf("loads from the files under assets/ without --archive. Run each way in its own process,\n");
+            std::printf("after dropping the page cache for a cold start\n");
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t checksum = 0;
+    int images = 0;
+    int waves = 0;
+    auto Sum = [&checksum](const void* data, size_t size) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++) {
+            checksum += bytes[i];
+        }
+    };
+
+    if (archivePath.empty()) {
+        for (const std::string& directory : directories) {
+            std::error_code error;
+            for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+                std::string path = file.path().string();
+                std::string extension = file.path().extension().string();
+                if (extension == ".png") {
+                    Image image = LoadImage(path.c_str());
+                    if (!image.data) continue;
+                    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+                    Sum(image.data, (size_t)image.width * image.height * 4);
+                    UnloadImage(image);
+                    images++;
+                }
+                else if (extension == ".wav" || extension == ".mp3" || extension == ".ogg") {
+                    Wave wave = LoadWave(path.c_str());
+                    if (!wave.data) continue;
+                    Sum(wave.data, (size_t)wave.frameCount * wave.channels * (wave.sampleSize / 8));
+                    UnloadWave(wave);
+                    waves++;
+                }
+            }
+        }
+    }
+    else {
+        AssetArchive archive;
+        if (!archive.Open(archivePath)) {
+            std::fprintf(stderr, "could not open archive %s\n", archivePath.c_str());
+            return 1;
+        }
+        for (const std::string& path : archive.Paths()) {
+            Image image;
+            Wave wave;
+            if (archive.FindImage(path, image)) {
+                Sum(image.data, (size_t)image.width * image.height * 4);
+                images++;
+            }
+            else if (archive.FindWave(path, wave)) {
+                Sum(wave.data, (size_t)wave.frameCount * wave.channels * (wave.sampleSize / 8));
+                waves++;
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::printf("loaded %d images and %d sounds from %s in %.2fms, peak RSS %ld KiB (checksum %llu)\n",
+        images, waves, archivePath.empty() ? "files" : archivePath.c_str(), seconds * 1000.0, usage.ru_maxrss,
+        (unsigned long long)checksum);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "core/AssetLoader.hpp"
+#include <chrono>
+#include <limits>
+
+// Decoded data waiting for upload. Frees it if the loader goes away first
+struct PendingTexture {
+    ResourceManager::DecodedTexture decoded;
+
+    ~PendingTexture() {
+        if (decoded.owned && decoded.image.data) UnloadImage(decoded.image);
+    }
+};
+
+struct PendingSound {
+    ResourceManager::DecodedSound decoded;
+
+    ~PendingSound() {
+        if (decoded.owned && decoded.wave.data) UnloadWave(decoded.wave);
+    }
+};
+
+AssetLoader::AssetLoader(JobSystem& jobSystem, ResourceManager& resourceManager)
+    : jobs(jobSystem), resources(resourceManager) {}
+
+AssetLoader::~AssetLoader() {
+    jobs.WaitFor(pending);
+}
+
+void AssetLoader::QueueTexture(TextureHandle handle, const std::string& filepath, float drawScale) {
+    auto texture = std::make_shared<PendingTexture>();
+    ResourceManager& manager = resources;
+
+    QueueWork(
+        [texture, &manager, filepath, drawScale]() { texture->decoded = manager.DecodeTexture(filepath, drawScale); },
+        [texture, &manager, handle]() { manager.AddTexture(handle, texture->decoded); });
+}
+
+void AssetLoader::QueueSound(SoundHandle handle, const std::string& filepath) {
+    auto sound = std::make_shared<PendingSound>();
+    ResourceManager& manager = resources;
+
+    QueueWork(
+        [sound, &manager, filepath]() { sound->decoded = manager.DecodeSound(filepath); },
+        [sound, &manager, handle]() { manager.AddSound(handle, sound->decoded); });
+}
+
+void AssetLoader::QueueWork(std::function<void()> decode, std::function<void()> upload) {
+    items.push_back(std::make_unique<Item>());
+    Item* item = items.back().get();
+    item->decode = std::move(decode);
+    item->upload = std::move(upload);
+
+    jobs.Spawn([item]() {
+        item->decode();
+        item->decoded.store(true, std::memory_order_release);
+    }, pending);
+}
+
+void AssetLoader::Update(double budget) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto& item : items) {
+        if (item->uploaded || !item->decoded.load(std::memory_order_acquire)) continue;
+
+        item->upload();
+        item->uploaded = true;
+        uploaded++;
+
+        // Done with, and what they captured may be large
+        item->decode = nullptr;
+        item->upload = nullptr;
+
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budget) break;
+    }
+}
+
+void AssetLoader::Finish() {
+    jobs.WaitFor(pending);
+    Update(std::numeric_limits<double>::infinity());
+}
+
+bool AssetLoader::IsDone() const {
+    return uploaded == (int)items.size();
+}
+
+float AssetLoader::Progress() const {
+    return items.empty() ? 1.0f : (float)uploaded / items.size();
+}
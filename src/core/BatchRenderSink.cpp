@@ -0,0 +1,209 @@
+#include "core/BatchRenderSink.hpp"
+#include "core/config.h"
+#include <algorithm>
+#include <cmath>
+
+// Sides of the polygon a circle is drawn as, as raylib's DrawCircleV uses
+static const int circleSegments = 36;
+
+// With a quad to spare, so rlgl never runs out of room and draws the batch
+// before the sink does
+BatchRenderSink::BatchRenderSink(const TextureAtlas& textureAtlas)
+    : atlas(textureAtlas), batch(rlLoadRenderBatch(1, RENDER_BATCH_QUADS + 1)) {
+    quads.reserve(1024);
+}
+
+BatchRenderSink::~BatchRenderSink() {
+    rlUnloadRenderBatch(batch);
+}
+
+void BatchRenderSink::SetLayer(RenderLayer drawLayer) {
+    layer = drawLayer;
+}
+
+BatchRenderSink::Quad& BatchRenderSink::AddQuad(unsigned int textureId, Color color) {
+    uint64_t key = ((uint64_t)layer << 32) | textureId;
+    if (!quads.empty() && key < quads.back().key) sorted = false;
+
+    quads.emplace_back();
+    Quad& quad = quads.back();
+    quad.key = key;
+    quad.color = color;
+    return quad;
+}
+
+// Untextured shapes sample the atlas's white block, or raylib's white
+// texture if there is no atlas
+void BatchRenderSink::AddSolid(const Vector2* corners, Color color) {
+    bool packed = atlas.IsReady();
+    Quad& quad = AddQuad(packed ? atlas.GetTexture().id : rlGetTextureIdDefault(), color);
+    Vector2 white = packed ? atlas.WhiteTexel() : Vector2{0.0f, 0.0f};
+    for (int k = 0; k < 4; k++) {
+        quad.position[k] = corners[k];
+        quad.texcoord[k] = white;
+    }
+}
+
+// The corners and texture coordinates DrawTexturePro would use
+void BatchRenderSink::DrawSprite(const Texture2D& texture, Rectangle src, Rectangle dest, Vector2 origin, float rotation, Color tint) {
+    if (texture.id == 0 || texture.width == 0 || texture.height == 0) return;
+
+    bool flipX = src.width < 0.0f;
+    bool flipY = src.height < 0.0f;
+    src.width = std::fabs(src.width);
+    src.height = std::fabs(src.height);
+
+    // Source rectangles are in the texture's own pixels, which may be
+    // stored at another size in the atlas
+    Rectangle region = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
+    unsigned int textureId = texture.id;
+    float sheetWidth = (float)texture.width;
+    float sheetHeight = (float)texture.height;
+    if (atlas.Find(texture, region)) {
+        textureId = atlas.GetTexture().id;
+        sheetWidth = (float)atlas.GetTexture().width;
+        sheetHeight = (float)atlas.GetTexture().height;
+    }
+    float scaleX = region.width / texture.width;
+    float scaleY = region.height / texture.height;
+
+    float u0 = (region.x + src.x * scaleX) / sheetWidth;
+    float u1 = (region.x + (src.x + src.width) * scaleX) / sheetWidth;
+    float v0 = (region.y + src.y * scaleY) / sheetHeight;
+    float v1 = (region.y + (src.y + src.height) * scaleY) / sheetHeight;
+    if (flipX) std::swap(u0, u1);
+    if (flipY) std::swap(v0, v1);
+
+    Vector2 topLeft, topRight, bottomLeft, bottomRight;
+    if (rotation == 0.0f) {
+        float x = dest.x - origin.x;
+        float y = dest.y - origin.y;
+        topLeft = {x, y};
+        topRight = {x + dest.width, y};
+        bottomLeft = {x, y + dest.height};
+        bottomRight = {x + dest.width, y + dest.height};
+    }
+    else {
+        float radians = rotation * (float)M_PI / 180.0f;
+        float s = std::sin(radians);
+        float c = std::cos(radians);
+        float dx = -origin.x;
+        float dy = -origin.y;
+
+        topLeft = {dest.x + dx * c - dy * s, dest.y + dx * s + dy * c};
+        topRight = {dest.x + (dx + dest.width) * c - dy * s, dest.y + (dx + dest.width) * s + dy * c};
+        bottomLeft = {dest.x + dx * c - (dy + dest.height) * s, dest.y + dx * s + (dy + dest.height) * c};
+        bottomRight = {dest.x + (dx + dest.width) * c - (dy + dest.height) * s, dest.y + (dx + dest.width) * s + (dy + dest.height) * c};
+    }
+
+    Quad& quad = AddQuad(textureId, tint);
+    quad.position[0] = topLeft;
+    quad.position[1] = bottomLeft;
+    quad.position[2] = bottomRight;
+    quad.position[3] = topRight;
+    quad.texcoord[0] = {u0, v0};
+    quad.texcoord[1] = {u0, v1};
+    quad.texcoord[2] = {u1, v1};
+    quad.texcoord[3] = {u1, v0};
+}
+
+void BatchRenderSink::DrawRect(Rectangle rect, Color color) {
+    Vector2 corners[4] = {
+        {rect.x, rect.y},
+        {rect.x, rect.y + rect.height},
+        {rect.x + rect.width, rect.y + rect.height},
+        {rect.x + rect.width, rect.y}
+    };
+    AddSolid(corners, color);
+}
+
+// Four bars, as DrawRectangleLinesEx draws them
+void BatchRenderSink::DrawRectLines(Rectangle rect, float thickness, Color color) {
+    thickness = std::min(thickness, std::min(rect.width, rect.height) / 2);
+    DrawRect({rect.x, rect.y, rect.width, thickness}, color);
+    DrawRect({rect.x, rect.y + rect.height - thickness, rect.width, thickness}, color);
+    DrawRect({rect.x, rect.y + thickness, thickness, rect.height - thickness * 2}, color);
+    DrawRect({rect.x + rect.width - thickness, rect.y + thickness, thickness, rect.height - thickness * 2}, color);
+}
+
+// Two segments of the polygon per quad, wound the way raylib winds them
+void BatchRenderSink::DrawCircle(Vector2 center, float radius, Color color) {
+    float step = 2.0f * (float)M_PI / circleSegments;
+    for (int i = 0; i < circleSegments; i += 2) {
+        float angle = i * step;
+        Vector2 corners[4] = {
+            center,
+            {center.x + std::cos(angle + step * 2) * radius, center.y + std::sin(angle + step * 2) * radius},
+            {center.x + std::cos(angle + step) * radius, center.y + std::sin(angle + step) * radius},
+            {center.x + std::cos(angle) * radius, center.y + std::sin(angle) * radius}
+        };
+        AddSolid(corners, color);
+    }
+}
+
+void BatchRenderSink::Flush() {
+    lastQuads = (int)quads.size();
+    lastBatchDraws = 0;
+    layer = RenderLayer::Ground;
+    if (quads.empty()) return;
+
+    // Stable, so draws within a layer and texture keep their order
+    if (!sorted) {
+        order.resize(quads.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = (uint32_t)i;
+        }
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return quads[a].key < quads[b].key; });
+    }
+
+    // Switching to our batch draws whatever raylib had batched before
+    rlSetRenderBatchActive(&batch);
+
+    unsigned int current = 0;
+    int inBatch = 0;
+    for (size_t i = 0; i < quads.size(); i++) {
+        const Quad& quad = quads[sorted ? i : order[i]];
+        unsigned int textureId = (unsigned int)(quad.key & 0xFFFFFFFFu);
+
+        bool full = inBatch == RENDER_BATCH_QUADS;
+        if (i == 0 || textureId != current || full) {
+            if (i > 0) rlEnd();
+            if (full) {
+                DrawBatch();
+                inBatch = 0;
+            }
+            rlSetTexture(textureId);
+            rlBegin(RL_QUADS);
+            rlNormal3f(0.0f, 0.0f, 1.0f);
+            current = textureId;
+        }
+
+        rlColor4ub(quad.color.r, quad.color.g, quad.color.b, quad.color.a);
+        for (int k = 0; k < 4; k++) {
+            rlTexCoord2f(quad.texcoord[k].x, quad.texcoord[k].y);
+            rlVertex2f(quad.position[k].x, quad.position[k].y);
+        }
+        inBatch++;
+    }
+    rlEnd();
+    rlSetTexture(0);
+
+    DrawBatch();
+    rlSetRenderBatchActive(nullptr);
+
+    quads.clear();
+    sorted = true;
+}
+
+void BatchRenderSink::DrawBatch() {
+    lastBatchDraws++;
+    rlDrawRenderBatchActive();
+}
+
+int BatchRenderSink::LastQuads() const {
+    return lastQuads;
+}
+
+int BatchRenderSink::LastBatchDraws() const {
+    return lastBatchDraws;
+}
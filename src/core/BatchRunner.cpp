@@ -0,0 +1,176 @@
+#include "core/BatchRunner.hpp"
+#include "core/Random.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+void BatchStats::Add(const MatchResult& result) {
+    matches++;
+    if (result.winner == Winner::Red) redWins++;
+    else if (result.winner == Winner::Yellow) yellowWins++;
+    else draws++;
+
+    ticks += result.ticks;
+    simTime += result.simTime;
+    redDamage += result.redDamage;
+    yellowDamage += result.yellowDamage;
+}
+
+void BatchStats::Merge(const BatchStats& other) {
+    matches += other.matches;
+    redWins += other.redWins;
+    yellowWins += other.yellowWins;
+    draws += other.draws;
+    ticks += other.ticks;
+    simTime += other.simTime;
+    redDamage += other.redDamage;
+    yellowDamage += other.yellowDamage;
+}
+
+BatchStats RunBatch(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const BatchOptions& options) {
+    BatchSetup setup = [&options](int index, HeadlessOptions&, uint64_t& seed) {
+        seed = Random::MixSeed(options.match.seed, (uint64_t)index);
+        return 0;
+    };
+    return RunBatchGroups(yellowAssets, redAssets, options, options.match.matches, 1, setup)[0];
+}
+
+std::vector<BatchStats> RunBatchGroups(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const BatchOptions& options,
+                                       int total, int groups, const BatchSetup& setup) {
+    int threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+    threads = std::max(1, std::min(threads, total));
+
+    std::atomic<int> nextMatch{0};
+    std::atomic<int> finished{0};
+    std::vector<std::vector<BatchStats>> workerStats(threads, std::vector<BatchStats>(groups));
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Workers claim match indices one at a time, so slow matches don't leave
+    // other threads idle at the end
+    for (int w = 0; w < threads; w++) {
+        workers.emplace_back([&, w]() {
+            for (int i = nextMatch++; i < total; i = nextMatch++) {
+                HeadlessOptions match = options.match;
+                uint64_t seed = match.seed;
+                int group = setup(i, match, seed);
+                workerStats[w][group].Add(RunHeadlessMatch(yellowAssets, redAssets, match, seed));
+                finished++;
+            }
+        });
+    }
+
+    if (options.progress) {
+        double lastReport = 0.0;
+        while (finished < total) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed - lastReport < 1.0) continue;
+            lastReport = elapsed;
+
+            int done = finished;
+            std::fprintf(stderr, "\r%d/%d matches, %.0f matches/s", done, total, done / elapsed);
+        }
+        if (lastReport > 0.0) std::fprintf(stderr, "\r\033[K");
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<BatchStats> stats(groups);
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int g = 0; g < groups; g++) {
+        for (const std::vector<BatchStats>& worker : workerStats) {
+            stats[g].Merge(worker[g]);
+        }
+        stats[g].wallTime = wallTime;
+    }
+    return stats;
+}
+
+static void PrintUsage() {
+    std::printf("usage: main --batch [--matches N] [--threads N] [--seed N] [--dt SECONDS] [--max-time SECONDS]\n");
+    std::printf("                    [--arena SHIPS_PER_SIDE] [--red-params FILE] [--yellow-params FILE]\n");
+    std::printf("                    [--red-behaviours FILE] [--yellow-behaviours FILE] [--red-policy FILE] [--yellow-policy FILE] [--quiet]\n");
+}
+
+// Win rate with a 95% confidence interval, so a balance change can be told apart from noise
+static void PrintWinRate(const char* name, int wins, int matches) {
+    double p = (double)wins / matches;
+    double margin = 1.96 * std::sqrt(p * (1.0 - p) / matches);
+    std::printf("%-7s %8d wins  %6.2f%% +- %.2f%%\n", name, wins, p * 100.0, margin * 100.0);
+}
+
+int RunBatchCommand(int argc, char** argv) {
+    BatchOptions options;
+    options.match.matches = 1000;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--matches" && hasValue) options.match.matches = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.match.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--dt" && hasValue) options.match.dt = (float)std::atof(argv[++i]);
+        else if (arg == "--max-time" && hasValue) options.match.maxMatchTime = std::atof(argv[++i]);
+        else if (arg == "--arena" && hasValue) {
+            options.match.mode = GameMode::Arena;
+            options.match.shipsPerSide = std::atoi(argv[++i]);
+        }
+        else if ((arg == "--red-params" || arg == "--yellow-params") && hasValue) {
+            AIParams& params = arg == "--red-params" ? options.match.redParams : options.match.yellowParams;
+            if (!params.Load(argv[++i])) {
+                std::fprintf(stderr, "could not read AI params %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if ((arg == "--red-behaviours" || arg == "--yellow-behaviours") && hasValue) {
+            AIParams& params = arg == "--red-behaviours" ? options.match.redParams : options.match.yellowParams;
+            params.behaviours = LoadHeadlessBehaviours(argv[++i]);
+            if (!params.behaviours) return 1;
+        }
+        else if ((arg == "--red-policy" || arg == "--yellow-policy") && hasValue) {
+            auto& policy = arg == "--red-policy" ? options.match.redPolicy : options.match.yellowPolicy;
+            policy = LoadHeadlessPolicy(argv[++i]);
+            if (!policy) return 1;
+        }
+        else if (arg == "--quiet") options.progress = false;
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (options.match.matches <= 0 || options.match.dt <= 0.0f || options.match.shipsPerSide <= 0 || options.threads < 0) {
+        PrintUsage();
+        return 1;
+    }
+
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+
+    BatchStats stats = RunBatch(yellowAssets, redAssets, options);
+
+    int threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+    std::printf("matches: %d  threads: %d  seed: %llu\n", stats.matches, threads, (unsigned long long)options.match.seed);
+    PrintWinRate("red", stats.redWins, stats.matches);
+    PrintWinRate("yellow", stats.yellowWins, stats.matches);
+    PrintWinRate("draw", stats.draws, stats.matches);
+    std::printf("avg match length %.2fs (%.0f ticks)\n", stats.simTime / stats.matches, (double)stats.ticks / stats.matches);
+    std::printf("avg damage dealt red %.2f yellow %.2f\n", stats.redDamage / stats.matches, stats.yellowDamage / stats.matches);
+    std::printf("wall %.3fs, %.1f matches/s, %.0fx real time\n",
+        stats.wallTime, stats.matches / stats.wallTime, stats.simTime / stats.wallTime);
+
+    return 0;
+}
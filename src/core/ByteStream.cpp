@@ -0,0 +1,239 @@
+#include "core/ByteStream.hpp"
+#include <fstream>
+#include <iterator>
+
+void ByteWriter::U8(uint8_t value) {
+    bytes.push_back(value);
+}
+
+void ByteWriter::U16(uint16_t value) {
+    U8((uint8_t)value);
+    U8((uint8_t)(value >> 8));
+}
+
+void ByteWriter::U32(uint32_t value) {
+    U16((uint16_t)value);
+    U16((uint16_t)(value >> 16));
+}
+
+void ByteWriter::U64(uint64_t value) {
+    U32((uint32_t)value);
+    U32((uint32_t)(value >> 32));
+}
+
+void ByteWriter::F32(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    U32(bits);
+}
+
+void ByteWriter::F64(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    U64(bits);
+}
+
+void ByteWriter::Varint(uint64_t value) {
+    while (value >= 0x80) {
+        U8((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    U8((uint8_t)value);
+}
+
+void ByteWriter::SignedVarint(int64_t value) {
+    Varint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void ByteWriter::Bytes(const void* data, size_t size) {
+    const uint8_t* begin = (const uint8_t*)data;
+    bytes.insert(bytes.end(), begin, begin + size);
+}
+
+void ByteWriter::PatchU32(size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        bytes[offset + i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+size_t ByteWriter::Size() const {
+    return bytes.size();
+}
+
+void ByteWriter::Clear() {
+    bytes.clear();
+}
+
+ByteReader::ByteReader(const uint8_t* bytes, size_t length)
+    : data(bytes), size(length) {}
+
+ByteReader::ByteReader(const std::vector<uint8_t>& bytes)
+    : data(bytes.data()), size(bytes.size()) {}
+
+uint8_t ByteReader::U8() {
+    if (pos >= size) {
+        ok = false;
+        return 0;
+    }
+    return data[pos++];
+}
+
+uint16_t ByteReader::U16() {
+    uint16_t low = U8();
+    return (uint16_t)(low | (U8() << 8));
+}
+
+uint32_t ByteReader::U32() {
+    uint32_t low = U16();
+    return low | ((uint32_t)U16() << 16);
+}
+
+uint64_t ByteReader::U64() {
+    uint64_t low = U32();
+    return low | ((uint64_t)U32() << 32);
+}
+
+float ByteReader::F32() {
+    uint32_t bits = U32();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double ByteReader::F64() {
+    uint64_t bits = U64();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint64_t ByteReader::Varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = U8();
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    ok = false;
+    return 0;
+}
+
+int64_t ByteReader::SignedVarint() {
+    uint64_t value = Varint();
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+bool ByteReader::Bytes(void* out, size_t length) {
+    const uint8_t* src = Skip(length);
+    if (!src) {
+        std::memset(out, 0, length);
+        return false;
+    }
+    std::memcpy(out, src, length);
+    return true;
+}
+
+const uint8_t* ByteReader::Skip(size_t length) {
+    if (length > size - pos) {
+        ok = false;
+        pos = size;
+        return nullptr;
+    }
+    const uint8_t* start = data + pos;
+    pos += length;
+    return start;
+}
+
+size_t ByteReader::Remaining() const {
+    return size - pos;
+}
+
+bool ByteReader::AtEnd() const {
+    return pos >= size;
+}
+
+void BitWriter::Bits(uint32_t value, int count) {
+    if (count < 32) value &= (1u << count) - 1;
+    pending |= (uint64_t)value << pendingBits;
+    pendingBits += count;
+
+    while (pendingBits >= 8) {
+        bytes.push_back((uint8_t)pending);
+        pending >>= 8;
+        pendingBits -= 8;
+    }
+}
+
+void BitWriter::Bit(bool value) {
+    Bits(value ? 1 : 0, 1);
+}
+
+void BitWriter::Gamma(uint32_t value) {
+    int length = 0;
+    while ((value >> (length + 1)) != 0) length++;
+
+    Bits(0, length);
+    Bit(true);
+    Bits(value, length); // The leading one is implied by the zeros before it
+}
+
+const std::vector<uint8_t>& BitWriter::Flush() {
+    if (pendingBits > 0) {
+        bytes.push_back((uint8_t)pending);
+        pending = 0;
+        pendingBits = 0;
+    }
+    return bytes;
+}
+
+void BitWriter::Clear() {
+    bytes.clear();
+    pending = 0;
+    pendingBits = 0;
+}
+
+BitReader::BitReader(const uint8_t* bytes, size_t length)
+    : data(bytes), size(length) {}
+
+uint32_t BitReader::Bits(int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++) {
+        if (Bit()) value |= 1u << i;
+    }
+    return value;
+}
+
+bool BitReader::Bit() {
+    if (bitPos >= size * 8) {
+        ok = false;
+        return false;
+    }
+    bool bit = (data[bitPos >> 3] >> (bitPos & 7)) & 1;
+    bitPos++;
+    return bit;
+}
+
+uint32_t BitReader::Gamma() {
+    int length = 0;
+    while (!Bit()) {
+        if (!ok || ++length >= 32) {
+            ok = false;
+            return 0;
+        }
+    }
+    return (1u << length) | Bits(length);
+}
+
+bool WriteFileBytes(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+    return (bool)file;
+}
+
+bool ReadFileBytes(const std::string& path, std::vector<uint8_t>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
@@ -0,0 +1,228 @@
+#include "core/CMAES.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+CMAES::CMAES(const std::vector<double>& start, double initialSigma, int populationSize, uint64_t seed)
+    : n((int)start.size()), mean(start), sigma(initialSigma), random(seed) {
+    lambda = populationSize > 0 ? populationSize : 4 + (int)(3.0 * std::log((double)n));
+    mu = lambda / 2;
+
+    // Log weights, best member first, summing to one
+    weights.resize(mu);
+    for (int i = 0; i < mu; i++) {
+        weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+    }
+    double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double sumSquares = 0.0;
+    for (double& w : weights) {
+        w /= sum;
+        sumSquares += w * w;
+    }
+    mueff = 1.0 / sumSquares;
+
+    cc = (4.0 + mueff / n) / (n + 4.0 + 2.0 * mueff / n);
+    cs = (mueff + 2.0) / (n + mueff + 5.0);
+    c1 = 2.0 / ((n + 1.3) * (n + 1.3) + mueff);
+    cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((n + 2.0) * (n + 2.0) + mueff));
+    damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (n + 1.0)) - 1.0) + cs;
+    chiN = std::sqrt((double)n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+    pc.assign(n, 0.0);
+    ps.assign(n, 0.0);
+    C.assign(n * n, 0.0);
+    for (int i = 0; i < n; i++) {
+        C[i * n + i] = 1.0;
+    }
+    UpdateEigen();
+}
+
+// Box-Muller, one value per call
+double CMAES::Gaussian() {
+    double u1 = ((random.Next() >> 11) + 1.0) * 0x1.0p-53;
+    double u2 = (random.Next() >> 11) * 0x1.0p-53;
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+}
+
+const std::vector<std::vector<double>>& CMAES::Ask() {
+    population.assign(lambda, std::vector<double>(n));
+    std::vector<double> z(n);
+
+    for (auto& x : population) {
+        for (double& value : z) {
+            value = Gaussian();
+        }
+        for (int i = 0; i < n; i++) {
+            double y = 0.0;
+            for (int j = 0; j < n; j++) {
+                y += B[i * n + j] * D[j] * z[j];
+            }
+            x[i] = std::clamp(mean[i] + sigma * y, 0.0, 1.0);
+        }
+    }
+    return population;
+}
+
+// Members are clamped into the cube before scoring and the update learns
+// from where they were scored, so the search never drifts out of bounds
+void CMAES::Tell(const std::vector<double>& scores) {
+    std::vector<int> order(lambda);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+
+    std::vector<double> old = mean;
+    for (int i = 0; i < n; i++) {
+        mean[i] = 0.0;
+        for (int k = 0; k < mu; k++) {
+            mean[i] += weights[k] * population[order[k]][i];
+        }
+    }
+
+    std::vector<double> step(n);
+    for (int i = 0; i < n; i++) {
+        step[i] = (mean[i] - old[i]) / sigma;
+    }
+
+    // C^-1/2 step = B D^-1 B^T step
+    std::vector<double> rotated(n, 0.0);
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            rotated[j] += B[i * n + j] * step[i];
+        }
+        rotated[j] /= D[j];
+    }
+    double psNorm = 0.0;
+    for (int i = 0; i < n; i++) {
+        double whitened = 0.0;
+        for (int j = 0; j < n; j++) {
+            whitened += B[i * n + j] * rotated[j];
+        }
+        ps[i] = (1.0 - cs) * ps[i] + std::sqrt(cs * (2.0 - cs) * mueff) * whitened;
+        psNorm += ps[i] * ps[i];
+    }
+    psNorm = std::sqrt(psNorm);
+
+    generation++;
+    bool stalled = psNorm / std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * generation)) / chiN >= 1.4 + 2.0 / (n + 1.0);
+    double hsig = stalled ? 0.0 : 1.0;
+    for (int i = 0; i < n; i++) {
+        pc[i] = (1.0 - cc) * pc[i] + hsig * std::sqrt(cc * (2.0 - cc) * mueff) * step[i];
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double rankMu = 0.0;
+            for (int k = 0; k < mu; k++) {
+                const std::vector<double>& x = population[order[k]];
+                rankMu += weights[k] * (x[i] - old[i]) / sigma * (x[j] - old[j]) / sigma;
+            }
+            double rankOne = pc[i] * pc[j] + (1.0 - hsig) * cc * (2.0 - cc) * C[i * n + j];
+            double value = (1.0 - c1 - cmu) * C[i * n + j] + c1 * rankOne + cmu * rankMu;
+            C[i * n + j] = value;
+            C[j * n + i] = value;
+        }
+    }
+
+    sigma *= std::exp((cs / damps) * (psNorm / chiN - 1.0));
+    UpdateEigen();
+}
+
+// Cyclic Jacobi rotations. The matrices are a few dozen rows, where this is
+// quick and never fails to converge
+void CMAES::UpdateEigen() {
+    std::vector<double> a = C;
+    B.assign(n * n, 0.0);
+    for (int i = 0; i < n; i++) {
+        B[i * n + i] = 1.0;
+    }
+
+    for (int sweep = 0; sweep < 64; sweep++) {
+        double off = 0.0;
+        for (int p = 0; p < n; p++) {
+            for (int q = p + 1; q < n; q++) {
+                off += a[p * n + q] * a[p * n + q];
+            }
+        }
+        if (off < 1e-30) break;
+
+        for (int p = 0; p < n; p++) {
+            for (int q = p + 1; q < n; q++) {
+                double apq = a[p * n + q];
+                if (std::fabs(apq) < 1e-300) continue;
+
+                double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < n; k++) {
+                    double akp = a[k * n + p];
+                    double akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < n; k++) {
+                    double apk = a[p * n + k];
+                    double aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < n; k++) {
+                    double bkp = B[k * n + p];
+                    double bkq = B[k * n + q];
+                    B[k * n + p] = c * bkp - s * bkq;
+                    B[k * n + q] = s * bkp + c * bkq;
+                }
+            }
+        }
+    }
+
+    D.resize(n);
+    for (int i = 0; i < n; i++) {
+        D[i] = std::sqrt(std::max(a[i * n + i], 1e-20));
+    }
+}
+
+const std::vector<double>& CMAES::Mean() const {
+    return mean;
+}
+
+double CMAES::Sigma() const {
+    return sigma;
+}
+
+int CMAES::Generation() const {
+    return generation;
+}
+
+int CMAES::Population() const {
+    return lambda;
+}
+
+void CMAES::SaveState(ByteWriter& out) const {
+    out.Varint((uint64_t)n);
+    out.Varint((uint64_t)lambda);
+    out.Varint((uint64_t)generation);
+    out.F64(sigma);
+    for (double value : mean) out.F64(value);
+    for (double value : pc) out.F64(value);
+    for (double value : ps) out.F64(value);
+    for (double value : C) out.F64(value);
+    random.SaveState(out);
+}
+
+bool CMAES::LoadState(ByteReader& in) {
+    if ((int)in.Varint() != n || (int)in.Varint() != lambda) return false;
+
+    generation = (int)in.Varint();
+    sigma = in.F64();
+    for (double& value : mean) value = in.F64();
+    for (double& value : pc) value = in.F64();
+    for (double& value : ps) value = in.F64();
+    for (double& value : C) value = in.F64();
+    random.LoadState(in);
+    if (!in.ok) return false;
+
+    UpdateEigen();
+    return true;
+}
@@ -0,0 +1,198 @@
+#include "core/DangerField.hpp"
+#include "core/spaceship.hpp"
+#include "core/weapons.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Cells from an energy weapon's that it could reach within energyDangerHorizon,
+// allowing for it and the threatened point being anywhere in their cells
+static const int energyReach = (int)((energyDangerHorizon * energySpeed + energyRadius) / dangerCellSize + 1.5f) + 1;
+static const int energyStampWidth = energyReach * 2 + 1;
+static const int energyKeyColumns = dangerColumns + energyReach * 2;
+
+static int CellOf(float position) {
+    return (int)std::floor(position / dangerCellSize);
+}
+
+static int BulletRowOf(float y) {
+    return (int)std::floor(y / bulletDangerRowHeight);
+}
+
+bool DangerField::BulletKey::operator<(const BulletKey& other) const {
+    return vx < other.vx || (vx == other.vx && column < other.column);
+}
+
+bool DangerField::BulletKey::operator==(const BulletKey& other) const {
+    return vx == other.vx && column == other.column;
+}
+
+DangerField::DangerField()
+    : bulletTimes(dangerColumns * bulletDangerRows, dangerHorizon),
+      energyTimes(dangerColumns * dangerRows, dangerHorizon),
+      energyStamp(energyStampWidth * energyStampWidth) {
+    // Centers of cells d apart are at most sqrt(2) cells closer at their corners
+    for (int dr = -energyReach; dr <= energyReach; dr++) {
+        for (int dc = -energyReach; dc <= energyReach; dc++) {
+            float gap = (std::sqrt((float)(dc * dc + dr * dr)) - 1.5f) * dangerCellSize - energyRadius;
+            float time = std::max(gap, 0.0f) / energySpeed;
+            energyStamp[(dr + energyReach) * energyStampWidth + dc + energyReach] = time < energyDangerHorizon ? time : dangerHorizon;
+        }
+    }
+}
+
+void DangerField::Build(uint8_t team, const Projectiles& projectiles) {
+    left = team == (uint8_t)Side::RIGHT ? WIDTH / 2 : 0.0f;
+
+    for (std::vector<BulletKey>& keys : newRowKeys) {
+        keys.clear();
+    }
+
+    const ProjectilePool& bullets = projectiles.bullets;
+    for (int i = 0; i < bullets.Count(); i++) {
+        if (bullets.team[i] == team || bullets.vx[i] == 0.0f) continue;
+
+        int firstRow = std::max(BulletRowOf(bullets.y[i]), 0);
+        int lastRow = std::min(BulletRowOf(bullets.y[i] + bulletSize.y), bulletDangerRows - 1);
+        BulletKey key = {bullets.vx[i], CellOf(bullets.x[i] + bulletSize.x * 0.5f - left)};
+        for (int row = firstRow; row <= lastRow; row++) {
+            newRowKeys[row].push_back(key);
+        }
+    }
+
+    for (int row = 0; row < bulletDangerRows; row++) {
+        std::vector<BulletKey>& keys = newRowKeys[row];
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        if (keys == rowKeys[row]) continue;
+
+        rowKeys[row].swap(keys);
+        BuildBulletRow(row);
+    }
+
+    newEnergyKeys.clear();
+    const ProjectilePool& energy = projectiles.energy;
+    for (int i = 0; i < energy.Count(); i++) {
+        if (energy.team[i] == team) continue;
+
+        int column = CellOf(energy.x[i] - left);
+        int row = CellOf(energy.y[i]);
+        if (column < -energyReach || column >= dangerColumns + energyReach) continue;
+        if (row < -energyReach || row >= dangerRows + energyReach) continue;
+        newEnergyKeys.push_back((row + energyReach) * energyKeyColumns + column + energyReach);
+    }
+
+    std::sort(newEnergyKeys.begin(), newEnergyKeys.end());
+    newEnergyKeys.erase(std::unique(newEnergyKeys.begin(), newEnergyKeys.end()), newEnergyKeys.end());
+    if (newEnergyKeys != energyKeys) {
+        energyKeys.swap(newEnergyKeys);
+        BuildEnergy();
+    }
+}
+
+// Bullets never change height, so a cell's danger is the nearest bullet of
+// each speed still coming at it along the row. A bullet in the cell or the
+// next one over could already be touching it
+void DangerField::BuildBulletRow(int row) {
+    float times[dangerColumns];
+    std::fill(times, times + dangerColumns, dangerHorizon);
+
+    const std::vector<BulletKey>& keys = rowKeys[row];
+    for (size_t begin = 0, end; begin < keys.size(); begin = end) {
+        float vx = keys[begin].vx;
+        for (end = begin; end < keys.size() && keys[end].vx == vx; end++) {}
+
+        float secondsPerCell = dangerCellSize / std::fabs(vx);
+        if (vx > 0.0f) {
+            size_t next = begin;
+            int nearest = 0;
+            bool any = false;
+            for (int column = 0; column < dangerColumns; column++) {
+                for (; next < end && keys[next].column <= column; next++) {
+                    nearest = keys[next].column;
+                    any = true;
+                }
+                if (!any) continue;
+                float time = std::max(column - nearest - 1, 0) * secondsPerCell;
+                if (time < times[column]) times[column] = time;
+            }
+        }
+        else {
+            size_t next = end;
+            int nearest = 0;
+            bool any = false;
+            for (int column = dangerColumns - 1; column >= 0; column--) {
+                for (; next > begin && keys[next - 1].column >= column; next--) {
+                    nearest = keys[next - 1].column;
+                    any = true;
+                }
+                if (!any) continue;
+                float time = std::max(nearest - column - 1, 0) * secondsPerCell;
+                if (time < times[column]) times[column] = time;
+            }
+        }
+    }
+
+    for (int column = 0; column < dangerColumns; column++) {
+        bulletTimes[column * bulletDangerRows + row] = times[column];
+    }
+}
+
+// Energy weapons home, so they are taken as coming straight at every cell
+void DangerField::BuildEnergy() {
+    std::fill(energyTimes.begin(), energyTimes.end(), dangerHorizon);
+
+    for (int key : energyKeys) {
+        int keyRow = key / energyKeyColumns - energyReach;
+        int keyColumn = key % energyKeyColumns - energyReach;
+        int firstColumn = std::max(keyColumn - energyReach, 0);
+        int lastColumn = std::min(keyColumn + energyReach, dangerColumns - 1);
+        if (firstColumn > lastColumn) continue;
+
+        for (int row = std::max(keyRow - energyReach, 0); row <= std::min(keyRow + energyReach, dangerRows - 1); row++) {
+            const float* stamp = energyStamp.data() + (row - keyRow + energyReach) * energyStampWidth + firstColumn - keyColumn + energyReach;
+            float* times = energyTimes.data() + row * dangerColumns + firstColumn;
+            for (int c = 0; c <= lastColumn - firstColumn; c++) {
+                times[c] = std::min(times[c], stamp[c]);
+            }
+        }
+    }
+}
+
+float DangerField::TimeAt(int column, int row) const {
+    float soonest = energyTimes[row * dangerColumns + column];
+    int lastRow = std::min((row + 1) * dangerCellSize / bulletDangerRowHeight, bulletDangerRows - 1);
+    for (int bulletRow = row * dangerCellSize / bulletDangerRowHeight; bulletRow <= lastRow; bulletRow++) {
+        soonest = std::min(soonest, bulletTimes[column * bulletDangerRows + bulletRow]);
+    }
+    return soonest;
+}
+
+float DangerField::TimeIn(Rectangle area) const {
+    if (area.x < left || area.x + area.width > left + WIDTH / 2 || area.y < 0.0f || area.y + area.height > HEIGHT) return 0.0f;
+
+    int firstColumn = CellOf(area.x - left);
+    int lastColumn = std::min(CellOf(area.x + area.width - left), dangerColumns - 1);
+    int firstRow = CellOf(area.y);
+    int lastRow = std::min(CellOf(area.y + area.height), dangerRows - 1);
+
+    float soonest = dangerHorizon;
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            soonest = std::min(soonest, energyTimes[row * dangerColumns + column]);
+        }
+    }
+
+    int firstBulletRow = BulletRowOf(area.y);
+    int lastBulletRow = std::min(BulletRowOf(area.y + area.height), bulletDangerRows - 1);
+    for (int column = firstColumn; column <= lastColumn; column++) {
+        const float* times = bulletTimes.data() + column * bulletDangerRows;
+        for (int row = firstBulletRow; row <= lastBulletRow; row++) {
+            soonest = std::min(soonest, times[row]);
+        }
+    }
+    return soonest;
+}
+
+Rectangle DangerField::CellRect(int column, int row) const {
+    return {left + column * dangerCellSize, (float)row * dangerCellSize, (float)dangerCellSize, (float)dangerCellSize};
+}
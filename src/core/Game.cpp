@@ -1,13 +1,23 @@
 #include "raylib.h"
 #include "core/ResourceManager.hpp"
-#include "core/spaceship.hpp"
 #include "core/Game.hpp"
-#include "controllers/PlayerController.hpp"
-#include "controllers/AIController.hpp"
 #include "core/config.h"
 #include <string>
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <random>
+#include <ctime>
+#include <filesystem>
+#include <limits>
+
+// Match sprites are loaded at the size they are drawn at
+const Game::Sprite Game::matchSprites[] = {
+    {TextureID::RedShip, "assets/images/spaceship_red.png", SHIP_SCALE},
+    {TextureID::YellowShip, "assets/images/spaceship_yellow.png", SHIP_SCALE},
+    {TextureID::EnergyLeftFacing, "assets/images/energyLeftFacing.png", 1.0f},
+    {TextureID::EnergyRightFacing, "assets/images/energyRightFacing.png", 1.0f}
+};
 
 
 Game::Game() {
@@ -16,7 +26,7 @@ Game::Game() {
     SetTargetFPS(FPS);
     SetExitKey(KEY_NULL);
 
-    state = GameState::Menu;
+    state = GameState::Loading;
     winner = Winner::None;
 
     menuUIElements = {
@@ -26,7 +36,8 @@ Game::Game() {
         ui::UIElementID::TitleText,
         ui::UIElementID::BackgroundImage,
         ui::UIElementID::SettingsButton,
-        ui::UIElementID::StoryModeButton
+        ui::UIElementID::StoryModeButton,
+        ui::UIElementID::ArenaButton
     };
 
     gameOverUIElements = {
@@ -49,29 +60,34 @@ Game::Game() {
     settingsUIElements = {
         ui::UIElementID::BackFromSettingsButton,
         ui::UIElementID::BackgroundImage,
-        ui::UIElementID::VolumeSlider
+        ui::UIElementID::VolumeSlider,
+        ui::UIElementID::DifficultyButton
     };
 
     storyModeUIElements = {
         ui::UIElementID::BackgroundImage
     };
 
-    resources.loadTexture("redShip", "assets/images/spaceship_red.png");
-    resources.loadTexture("yellowShip", "assets/images/spaceship_yellow.png");
-    resources.loadTexture("background", "assets/images/space.png");
-    resources.loadTexture("energyLeftFacing", "assets/images/energyLeftFacing.png");
-    resources.loadTexture("energyRightFacing", "assets/images/energyRightFacing.png");
-    resources.loadSound("shoot", "assets/sounds/Gun+Silencer.mp3");
-    resources.loadSound("hit", "assets/sounds/Grenade+1.mp3");
-    resources.loadSound("energyShoot", "assets/sounds/spaceLaser.wav");
-
-    SetUpUI();
-
-    SetMenuUIVisible();
+    if (!resources.OpenArchive(ASSET_ARCHIVE)) TraceLog(LOG_INFO, "No asset archive at %s, decoding the asset files", ASSET_ARCHIVE);
+    jobs = std::make_unique<JobSystem>();
+    renderer = std::make_unique<BatchRenderSink>(atlas);
 
+    // Everything decodes in the background. The menu's own assets come
+    // first, so it can show while the match assets are still loading
+    loader = std::make_unique<AssetLoader>(*jobs, resources);
+    loader->QueueTexture(TextureID::Background, "assets/images/space.png");
+    for (const Sprite& sprite : matchSprites) {
+        loader->QueueTexture(sprite.id, sprite.path, sprite.drawScale);
+    }
+    loader->QueueSound(SoundID::Shoot, "assets/sounds/Gun+Silencer.mp3");
+    loader->QueueSound(SoundID::Hit, "assets/sounds/Grenade+1.mp3");
+    loader->QueueSound(SoundID::EnergyShoot, "assets/sounds/spaceLaser.wav");
 };
 
 Game::~Game() {
+    loader.reset();
+    renderer.reset();
+    atlas.Unload();
     resources.UnloadAll();
     CloseAudioDevice();
     CloseWindow();
@@ -84,11 +100,62 @@ void Game::Run() {
     }
 }
 
+// Takes on whatever the assets uploaded so far allow, a stage at a time
+void Game::UpdateLoading(double budget) {
+    if (!loader) return;
+    loader->Update(budget);
+
+    if (state == GameState::Loading && resources.IsLoaded(TextureID::Background)) {
+        SetUpUI();
+        state = GameState::Menu;
+        SetMenuUIVisible();
+    }
+
+    // Once the sprites are up, they are packed into the atlas so the frame
+    // is one draw call. Without it they are still batched, a call per texture
+    bool spritesReady = true;
+    for (const Sprite& sprite : matchSprites) {
+        spritesReady = spritesReady && resources.IsLoaded(sprite.id);
+    }
+    if (spritesReady && !atlasQueued) {
+        for (const Sprite& sprite : matchSprites) {
+            atlas.Alias(resources.GetTexture(sprite.id), sprite.path);
+        }
+
+        const AssetArchive* archive = &resources.GetArchive();
+        loader->QueueWork(
+            [this, archive]() { atlasPacked = atlas.Pack(ATLAS_DIRECTORY, ATLAS_MAX_SIZE, archive); },
+            [this]() {
+                if (!atlasPacked || !atlas.Upload()) TraceLog(LOG_WARNING, "Could not pack the images in %s into an atlas", ATLAS_DIRECTORY);
+            });
+        atlasQueued = true;
+    }
+
+    if (loader->IsDone()) {
+        audio = std::make_unique<RaylibAudioSink>(resources);
+        resources.CloseArchive(); // Everything is uploaded, so the pages can go
+        loader.reset();
+    }
+}
+
+// Matches can't start without their assets, so one started before loading
+// is done waits for it
+void Game::FinishLoading() {
+    while (loader) {
+        loader->Finish();
+        UpdateLoading(std::numeric_limits<double>::infinity());
+    }
+}
+
 void Game::Update() {
     float dt = GetFrameTime();
+    UpdateLoading(LOADING_FRAME_BUDGET);
     uiManager.Update(dt);
 
     switch (state) {
+        case GameState::Loading:
+            break;
+
         case GameState::Menu: {
             auto singleBtn = dynamic_cast<ui::Button*>(uiManager.GetElement(ui::UIElementID::SinglePlayerButton));
             if (singleBtn && singleBtn->WasClicked()) {
@@ -114,6 +181,14 @@ void Game::Update() {
                 SetStateUIVisibility(state);
             }
 
+            auto arenaBtn = dynamic_cast<ui::Button*>(uiManager.GetElement(ui::UIElementID::ArenaButton));
+            if (arenaBtn && arenaBtn->WasClicked()) {
+                StartGame(GameMode::Arena);
+                state = GameState::Playing;
+                previousState = GameState::Menu;
+                SetStateUIVisibility(state);
+            }
+
             auto settingsBtn = dynamic_cast<ui::Button*>(uiManager.GetElement(ui::UIElementID::SettingsButton));
             if (settingsBtn && settingsBtn->WasClicked()) {
                 HandleTransitionToSettings();
@@ -132,19 +207,44 @@ void Game::Update() {
 
             break;
         }
-        case GameState::Playing: {
-            redShip->Update(dt, *yellowShip);
-            yellowShip->Update(dt, *redShip);
+        case GameState::Connecting: {
+            if (lobby->Poll()) {
+                StartNetMatch();
+                state = GameState::Playing;
+                previousState = GameState::Menu;
+                SetStateUIVisibility(state);
+            }
 
-            if (redShip->IsDead()) {
-                winner = Winner::Yellow;
-                state = GameState::GameOver;
-                previousState = GameState::Playing;
+            if (IsKeyPressed(KEY_ESCAPE)) {
+                EndNetMatch();
+                state = GameState::Menu;
+                previousState = GameState::Connecting;
+                SetStateUIVisibility(state);
+            }
+            break;
+        }
+
+        case GameState::Spectating: {
+            spectator->Poll(dt);
+
+            if (IsKeyPressed(KEY_ESCAPE)) {
+                spectator->Disconnect();
+                spectator.reset();
+                state = GameState::Menu;
+                previousState = GameState::Spectating;
                 SetStateUIVisibility(state);
             }
+            break;
+        }
+
+        case GameState::Playing: {
+            if (netSession) StepNetMatch(dt);
+            else StepMatch(dt);
 
-            if (yellowShip->IsDead()) {
-                winner = Winner::Red;
+            // A net match is only over once no late input can undo the last hit
+            if (netSession ? netSession->IsConfirmedOver() : match->IsOver()) {
+                winner = match->GetWinner();
+                SaveReplay();
                 state = GameState::GameOver;
                 previousState = GameState::Playing;
                 SetStateUIVisibility(state);
@@ -157,6 +257,9 @@ void Game::Update() {
         }
 
         case GameState::GameOver: {
+            // Keep answering so the other side can confirm the ending too
+            if (netSession) netSession->Poll();
+
             auto restartBtn = dynamic_cast<ui::Button*>(uiManager.GetElement(ui::UIElementID::RestartButton));
             if (restartBtn && restartBtn->WasClicked()) {
                 Reset();
@@ -166,6 +269,7 @@ void Game::Update() {
             }
             auto menuBtn = dynamic_cast<ui::Button*>(uiManager.GetElement(ui::UIElementID::BackToMenuButton));
             if (menuBtn && menuBtn->WasClicked()) {
+                EndNetMatch();
                 state = GameState::Menu;
                 previousState = GameState::GameOver;
                 SetStateUIVisibility(state);
@@ -182,6 +286,8 @@ void Game::Update() {
         }
 
         case GameState::Settings: {
+            if (netSession) netSession->Poll();
+
             auto backBtn = dynamic_cast<ui::Button*>(uiManager.GetElement(ui::UIElementID::BackFromSettingsButton));
             if (backBtn && backBtn->WasClicked()) {
                 state = previousState;
@@ -195,6 +301,12 @@ void Game::Update() {
                 SetStateUIVisibility(state);
             }
 
+            auto difficultyBtn = dynamic_cast<ui::Button*>(uiManager.GetElement(ui::UIElementID::DifficultyButton));
+            if (difficultyBtn && difficultyBtn->WasClicked()) {
+                difficulty = difficulty == AIDifficulty::Normal ? AIDifficulty::Hard : AIDifficulty::Normal;
+                difficultyBtn->SetText(difficulty == AIDifficulty::Hard ? "AI: Hard" : "AI: Normal");
+            }
+
             UpdateVolume();
             break;
         }
@@ -214,17 +326,43 @@ void Game::Render() {
     ClearBackground(BLACK);
 
     switch (state) {
+        case GameState::Loading: {
+            // Raylib's own font, as nothing else is up yet
+            const char* message = "Loading";
+            DrawText(message, WIDTH / 2 - MeasureText(message, 40) / 2, HEIGHT / 2 - 40, 40, WHITE);
+
+            Rectangle bar = {WIDTH / 2.0f - 150, HEIGHT / 2.0f + 20, 300, 20};
+            DrawRectangleLinesEx(bar, 2, GRAY);
+            DrawRectangleRec({bar.x + 4, bar.y + 4, (bar.width - 8) * (loader ? loader->Progress() : 1.0f), bar.height - 8}, LIGHTGRAY);
+            break;
+        }
+
         case GameState::Menu:
             uiManager.Render();
             break;
 
         case GameState::Playing:
-            UpdatePlayingUI();
+            UpdatePlayingUI(*match);
             uiManager.Render();
-            redShip->Draw();
-            yellowShip->Draw();
+            match->Draw(*renderer, renderAlpha);
+            renderer->Flush();
             break;
 
+        case GameState::Spectating: {
+            Match* shown = spectator->GetMatch();
+            if (shown) UpdatePlayingUI(*shown);
+            uiManager.Render();
+            spectator->Draw(*renderer);
+            renderer->Flush();
+
+            const SpectatorFrame* frame = spectator->ShownFrame();
+            const char* message = !frame ? "Waiting for the server"
+                                : frame->over ? (frame->winner == Winner::Red ? "RED WINS!" : "YELLOW WINS!")
+                                : nullptr;
+            if (message) DrawText(message, WIDTH / 2 - MeasureText(message, 40) / 2, HEIGHT / 2 - 20, 40, WHITE);
+            break;
+        }
+
         case GameState::GameOver:
             UpdateGameOverUI();
             uiManager.Render();
@@ -237,6 +375,15 @@ void Game::Render() {
         case GameState::StoryMode:
             uiManager.Render();
             break;
+
+        case GameState::Connecting: {
+            uiManager.Render();
+            const char* message = lobby->IsHost()
+                ? TextFormat("Waiting for opponent on port %d", (int)lobby->GetSocket().LocalPort())
+                : TextFormat("Connecting to %s", lobby->GetPeer().ToString().c_str());
+            DrawText(message, WIDTH / 2 - MeasureText(message, 30) / 2, HEIGHT / 2, 30, WHITE);
+            break;
+        }
     }
 
     EndDrawing();
@@ -293,6 +440,8 @@ void Game::SetStoryModeUIVisible() {
 
 void Game::SetStateUIVisibility(GameState state){
     switch (state) {
+        case GameState::Loading:
+            break;
         case GameState::Menu:
             SetMenuUIVisible();
             break;
@@ -308,13 +457,92 @@ void Game::SetStateUIVisibility(GameState state){
         case GameState::StoryMode:
             SetStoryModeUIVisible();
             break;
+        case GameState::Connecting:
+            SetStoryModeUIVisible(); // Just the background
+            break;
+        case GameState::Spectating:
+            SetPlayingUIVisible();
+            break;
+    }
+
+    // Both sides would have to agree to a rematch, so net matches go back to the menu
+    if (state == GameState::GameOver && netSession) {
+        uiManager.GetElement(ui::UIElementID::RestartButton)->isVisible = false;
     }
 }
 
 void Game::Reset() {
-    redShip->Reset();
-    yellowShip->Reset();
+    match->Reset();
     winner = Winner::None;
+    tickAccumulator = 0.0f;
+    StartRecording();
+}
+
+void Game::StartRecording() {
+    #if RECORD_REPLAYS
+    recorder = std::make_unique<ReplayRecorder>(*match);
+    #endif
+}
+
+// Saves the finished match as replays/<unix time>.rep
+void Game::SaveReplay() {
+    if (!recorder) return;
+
+    std::error_code error;
+    std::filesystem::create_directories("replays", error);
+    std::string path = "replays/" + std::to_string((long long)std::time(nullptr)) + ".rep";
+    if (!recorder->Save(path)) {
+        TraceLog(LOG_WARNING, "Could not save replay %s", path.c_str());
+    }
+    recorder.reset();
+}
+
+// Runs as many fixed ticks as the frame time covers. Whatever is left over
+// becomes the interpolation factor for rendering between the last two ticks.
+void Game::StepMatch(float frameTime) {
+    match->PollInput();
+
+    tickAccumulator += frameTime;
+
+    int ticks = 0;
+    while (tickAccumulator >= TICK_DT && ticks < MAX_TICKS_PER_FRAME) {
+        match->Step(TICK_DT);
+        if (recorder) recorder->Record(*match);
+        tickAccumulator -= TICK_DT;
+        ticks++;
+
+        if (match->IsOver()) break;
+    }
+
+    if (ticks == MAX_TICKS_PER_FRAME) {
+        tickAccumulator = std::min(tickAccumulator, TICK_DT);
+    }
+
+    renderAlpha = tickAccumulator / TICK_DT;
+}
+
+// Like StepMatch, but the session plays the ticks: it may stall while the
+// other side is too far behind, and skips the odd tick when this side is ahead
+void Game::StepNetMatch(float frameTime) {
+    netInput->PollInput();
+
+    tickAccumulator += frameTime;
+
+    int ticks = 0;
+    while (tickAccumulator >= TICK_DT && ticks < MAX_TICKS_PER_FRAME) {
+        if (!netSession->ShouldWait() && !netSession->Advance()) break;
+        tickAccumulator -= TICK_DT;
+        ticks++;
+    }
+
+    if (ticks == 0) netSession->Poll();
+    tickAccumulator = std::min(tickAccumulator, MAX_ROLLBACK_TICKS * TICK_DT);
+
+    if (netSession->IsDesynced()) {
+        TraceLog(LOG_WARNING, "Net match desynced at tick %ld", netSession->GetConfirmedTick());
+    }
+
+    renderAlpha = std::min(tickAccumulator / TICK_DT, 1.0f);
 }
 
 void Game::SetUpUI() {
@@ -324,8 +552,10 @@ void Game::SetUpUI() {
     std::unique_ptr<ui::Button> twoPlayerButton = std::make_unique<ui::Button>("Two Player", WIDTH / 2 + 100, HEIGHT / 2, 30, GRAY, DARKGRAY, BLACK);
     std::unique_ptr<ui::Button> noPlayerButton = std::make_unique<ui::Button>("AI vs AI", WIDTH / 2 - 100, HEIGHT / 2 + 75, 30, GRAY, DARKGRAY, BLACK);
     std::unique_ptr<ui::Button> storyModeButton = std::make_unique<ui::Button>("Story mode", WIDTH / 2 + 100, HEIGHT / 2 + 74, 30, GRAY, DARKGRAY, BLACK);
+    std::unique_ptr<ui::Button> arenaButton = std::make_unique<ui::Button>("Arena", WIDTH / 2, HEIGHT / 2 + 150, 30, GRAY, DARKGRAY, BLACK);
     std::unique_ptr<ui::Button> settingsButton = std::make_unique<ui::Button>("|||", WIDTH - 50, HEIGHT - 60, 30, GRAY, DARKGRAY, BLACK);
     std::unique_ptr<ui::Button> backFromSettingsButton = std::make_unique<ui::Button>("Back", WIDTH - 50, 20, 30, GRAY, DARKGRAY, BLACK);
+    std::unique_ptr<ui::Button> difficultyButton = std::make_unique<ui::Button>("AI: Normal", WIDTH / 2, HEIGHT / 2 + 60, 30, GRAY, DARKGRAY, BLACK);
 
     std::unique_ptr<ui::FloatingText> titleText = std::make_unique<ui::FloatingText>("Space Battle", WIDTH / 2, HEIGHT / 2 - 150, WHITE, 100, 10);
     std::unique_ptr<ui::StaticText> yellowShipHealthText = std::make_unique<ui::StaticText>(TextFormat("Health: %.1f", 100.0f), 80, 25, WHITE, 25);
@@ -336,7 +566,7 @@ void Game::SetUpUI() {
 
     std::unique_ptr<ui::Border> middleDivider = std::make_unique<ui::Border>(WIDTH / 2 - MIDDLERECTWIDTH, 0, MIDDLERECTWIDTH, HEIGHT, BLACK);
 
-    std::unique_ptr<ui::Image> backgroundImage = std::make_unique<ui::Image>(resources.GetTexture("background"), 0, 0, WIDTH, HEIGHT);
+    std::unique_ptr<ui::Image> backgroundImage = std::make_unique<ui::Image>(resources.GetTexture(TextureID::Background), 0, 0, WIDTH, HEIGHT);
 
     std::unique_ptr<ui::Slider> volumeSlider = std::make_unique<ui::Slider>("Volume", WIDTH / 2, HEIGHT / 2, 300, 20, 0.0f, 1.0f, 0.5f, DARKGRAY, LIGHTGRAY);
 
@@ -348,6 +578,8 @@ void Game::SetUpUI() {
     uiManager.AddElement(ui::UIElementID::SettingsButton, std::move(settingsButton));
     uiManager.AddElement(ui::UIElementID::BackFromSettingsButton, std::move(backFromSettingsButton));
     uiManager.AddElement(ui::UIElementID::StoryModeButton, std::move(storyModeButton));
+    uiManager.AddElement(ui::UIElementID::ArenaButton, std::move(arenaButton));
+    uiManager.AddElement(ui::UIElementID::DifficultyButton, std::move(difficultyButton));
 
     uiManager.AddElement(ui::UIElementID::TitleText, std::move(titleText));
     uiManager.AddElement(ui::UIElementID::YellowShipHealthText, std::move(yellowShipHealthText));
@@ -369,12 +601,20 @@ void Game::HandleTransitionToSettings() {
         SetStateUIVisibility(state);
 }
 
-void Game::UpdatePlayingUI() {
+// Team health and, in the arena, how many ships each side has left
+static const char* TeamHealthText(const TeamStats& stats, bool arena) {
+    if (arena) return TextFormat("Ships: %d  Health: %.0f", stats.alive, stats.health);
+    return TextFormat("Health: %.1f", stats.health);
+}
+
+void Game::UpdatePlayingUI(const Match& shown) {
+    bool arena = shown.GetMode() == GameMode::Arena;
+
     auto yellowShipHealthText = dynamic_cast<ui::StaticText*>(uiManager.GetElement(ui::UIElementID::YellowShipHealthText));
-    yellowShipHealthText->UpdateText(TextFormat("Health: %.1f", yellowShip->health));
+    yellowShipHealthText->UpdateText(TeamHealthText(shown.world.GetTeamStats(Side::LEFT), arena));
 
     auto redShipHealthText = dynamic_cast<ui::StaticText*>(uiManager.GetElement(ui::UIElementID::RedShipHealthText));
-    redShipHealthText->UpdateText(TextFormat("Health: %.1f", redShip->health));
+    redShipHealthText->UpdateText(TeamHealthText(shown.world.GetTeamStats(Side::RIGHT), arena));
 }
 
 void Game::UpdateGameOverUI() {
@@ -384,10 +624,10 @@ void Game::UpdateGameOverUI() {
     winnerText->UpdateText(winnerMessage);
 
     auto yellowShipScoreText = dynamic_cast<ui::StaticText*>(uiManager.GetElement(ui::UIElementID::YellowShipScoreText));
-    yellowShipScoreText->UpdateText(TextFormat("%d", yellowShip->score));
+    yellowShipScoreText->UpdateText(TextFormat("%d", match->world.GetTeamStats(Side::LEFT).score));
 
     auto redShipScoreText = dynamic_cast<ui::StaticText*>(uiManager.GetElement(ui::UIElementID::RedShipScoreText));
-    redShipScoreText->UpdateText(TextFormat("%d", redShip->score));
+    redShipScoreText->UpdateText(TextFormat("%d", match->world.GetTeamStats(Side::RIGHT).score));
 }
 
 void Game::UpdateVolume() {
@@ -398,64 +638,100 @@ void Game::UpdateVolume() {
     }
 }
 
-void Game::StartGame(GameMode mode) {
-        yellowShip = std::make_unique<Spaceship>(
-        resources.GetTexture("yellowShip"), Side::LEFT,
-        resources.GetSound("shoot"), resources.GetSound("hit"), 
-        resources.GetTexture("energyLeftFacing"), resources.GetSound("energyShoot"),
-        nullptr
-    );
-
-    redShip = std::make_unique<Spaceship>(
-        resources.GetTexture("redShip"), Side::RIGHT,
-        resources.GetSound("shoot"), resources.GetSound("hit"), 
-        resources.GetTexture("energyRightFacing"), resources.GetSound("energyShoot"),
-        nullptr
-    );
-
-    switch (mode) {
-        case GameMode::TwoPlayer: {
-            std::unique_ptr yellowController = std::make_unique<PlayerController>(
-                std::vector<int>{KEY_W, KEY_S, KEY_A, KEY_D}, KEY_C, KEY_V
-            );
-
-            std::unique_ptr redController = std::make_unique<PlayerController>(
-            std::vector<int>{KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT}, KEY_M, KEY_K
-            );
-
-            yellowShip->controller = std::move(yellowController);
-            redShip->controller = std::move(redController);
-            break;
-        }
-
-        case GameMode::SinglePlayer: {
-            std::unique_ptr yellowController = std::make_unique<PlayerController>(
-                std::vector<int>{KEY_W, KEY_S, KEY_A, KEY_D}, KEY_C, KEY_V
-            );
+bool Game::HostNetMatch(uint16_t port) {
+    FinishLoading(); // The waiting screen is drawn over the menu's background
+    std::random_device entropy;
+    uint64_t seed = ((uint64_t)entropy() << 32) | entropy();
 
-            std::unique_ptr redAIController = std::make_unique<AIController>(redShip.get(), yellowShip.get());
+    lobby = std::make_unique<NetLobby>();
+    if (!lobby->Host(port, seed)) {
+        TraceLog(LOG_WARNING, "Could not listen on port %d", (int)port);
+        lobby.reset();
+        return false;
+    }
 
-            yellowShip->controller = std::move(yellowController);
-            redShip->controller = std::move(redAIController);
+    state = GameState::Connecting;
+    SetStateUIVisibility(state);
+    return true;
+}
 
-            #if AITest
-            yellowShip->health = 100;
-            redShip->health = 100;
-            #endif
+bool Game::JoinNetMatch(const NetAddress& host) {
+    FinishLoading();
+    lobby = std::make_unique<NetLobby>();
+    if (!lobby->Join(host)) {
+        TraceLog(LOG_WARNING, "Could not open a socket to join %s", host.ToString().c_str());
+        lobby.reset();
+        return false;
+    }
 
-            break;
-        }
+    state = GameState::Connecting;
+    SetStateUIVisibility(state);
+    return true;
+}
 
-        case GameMode::NoPlayer: {
-            yellowShip->controller = std::make_unique<AIController>(yellowShip.get(), redShip.get());
-            redShip->controller = std::make_unique<AIController>(redShip.get(), yellowShip.get());
+bool Game::Spectate(const NetAddress& server) {
+    ShipAssets yellowAssets = GetShipAssets(Side::LEFT);
+    ShipAssets redAssets = GetShipAssets(Side::RIGHT);
 
-            #if AITest
-            yellowShip->health = 100;
-            redShip->health = 100;
-            #endif
-            
-            break;
-        }
+    spectator = std::make_unique<SpectatorClient>(yellowAssets, redAssets, *audio);
+    if (!spectator->Connect(server)) {
+        TraceLog(LOG_WARNING, "Could not open a socket to watch %s", server.ToString().c_str());
+        spectator.reset();
+        return false;
     }
+
+    state = GameState::Spectating;
+    SetStateUIVisibility(state);
+    return true;
+}
+
+// Each side plays its own ship with the one player keys. Net matches aren't
+// recorded: the controls seen while predicting aren't final
+void Game::StartNetMatch() {
+    ShipAssets yellowAssets = GetShipAssets(Side::LEFT);
+    ShipAssets redAssets = GetShipAssets(Side::RIGHT);
+
+    netAudio = std::make_unique<GatedAudioSink>(*audio);
+    match = std::make_unique<Match>(GameMode::TwoPlayer, yellowAssets, redAssets, *netAudio, lobby->GetSeed());
+    netInput = std::make_unique<PlayerController>(std::vector<int>{KEY_W, KEY_S, KEY_A, KEY_D}, KEY_C, KEY_V);
+    netSession = std::make_unique<RollbackSession>(*match, *lobby, *netInput, netAudio.get());
+
+    recorder.reset();
+    tickAccumulator = 0.0f;
+}
+
+void Game::EndNetMatch() {
+    netSession.reset();
+    netInput.reset();
+    lobby.reset();
+}
+
+// The ship's size comes from its image file, as headless runs size it, so
+// matches play the same whatever size its texture was loaded at
+ShipAssets Game::GetShipAssets(Side side) {
+    FinishLoading();
+    TextureID ship = side == Side::LEFT ? TextureID::YellowShip : TextureID::RedShip;
+    Vector2 imageSize = resources.GetImageSize(ship);
+    return {
+        resources.GetTexture(ship),
+        {imageSize.x * SHIP_SCALE, imageSize.y * SHIP_SCALE},
+        resources.GetTexture(side == Side::LEFT ? TextureID::EnergyLeftFacing : TextureID::EnergyRightFacing)
+    };
+}
+
+void Game::StartGame(GameMode mode) {
+    EndNetMatch();
+
+    ShipAssets yellowAssets = GetShipAssets(Side::LEFT);
+    ShipAssets redAssets = GetShipAssets(Side::RIGHT);
+
+    std::random_device entropy;
+    uint64_t seed = ((uint64_t)entropy() << 32) | entropy();
+    match = std::make_unique<Match>(mode, yellowAssets, redAssets, *audio, seed);
+    if (mode == GameMode::SinglePlayer || mode == GameMode::NoPlayer) match->SetAIDifficulty(Side::RIGHT, difficulty);
+
+    if (mode == GameMode::Arena) match->world.SetJobSystem(jobs.get());
+
+    StartRecording();
+    tickAccumulator = 0.0f;
 }
\ No newline at end of file
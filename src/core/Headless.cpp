@@ -0,0 +1,339 @@
+#include "core/Headless.hpp"
+#include "core/config.h"
+#include "core/batchKernels.hpp"
+#include "core/JobSystem.hpp"
+#include "core/Observation.hpp"
+#include "core/Policy.hpp"
+#include "core/Random.hpp"
+#include "core/Replay.hpp"
+#include "core/Rollback.hpp"
+#include "core/Spectator.hpp"
+#include "core/VecEnv.hpp"
+#include "controllers/AIController.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static Texture2D LoadTextureInfo(const char* filepath) {
+    // LoadImage only decodes on the CPU, so this works without InitWindow.
+    Image img = LoadImage(filepath);
+    Texture2D tex = {0, img.width, img.height, 1, img.format};
+    UnloadImage(img);
+    return tex;
+}
+
+ShipAssets LoadHeadlessShipAssets(Side side) {
+    Texture2D ship = LoadTextureInfo(side == Side::LEFT ? "assets/images/spaceship_yellow.png" : "assets/images/spaceship_red.png");
+    Texture2D energy = LoadTextureInfo(side == Side::LEFT ? "assets/images/energyLeftFacing.png" : "assets/images/energyRightFacing.png");
+    return {ship, {(float)ship.width * SHIP_SCALE, (float)ship.height * SHIP_SCALE}, energy};
+}
+
+std::shared_ptr<const Policy> LoadHeadlessPolicy(const std::string& path) {
+    auto policy = std::make_shared<Policy>();
+    if (!policy->Load(path)) {
+        std::fprintf(stderr, "could not read policy %s\n", path.c_str());
+        return nullptr;
+    }
+    if (policy->Inputs() != observation::size || policy->Outputs() != PolicyBatch::outputs) {
+        std::fprintf(stderr, "policy %s takes %d inputs and gives %d outputs, a ship needs %d and %d\n",
+            path.c_str(), policy->Inputs(), policy->Outputs(), observation::size, PolicyBatch::outputs);
+        return nullptr;
+    }
+    return policy;
+}
+
+std::shared_ptr<const UtilityDefinition> LoadHeadlessBehaviours(const std::string& path) {
+    auto behaviours = std::make_shared<UtilityDefinition>();
+    std::string error;
+    if (!behaviours->Load(path, error)) {
+        std::fprintf(stderr, "could not load AI behaviours: %s\n", error.c_str());
+        return nullptr;
+    }
+    return behaviours;
+}
+
+void ThinkReport::Merge(const ThinkReport& other) {
+    times.Merge(other.times);
+    thought += other.thought;
+    skipped += other.skipped;
+}
+
+static const char* ControllerName(const IController& controller) {
+    if (dynamic_cast<const LookaheadController*>(&controller)) return "hard AI";
+    if (dynamic_cast<const PolicyController*>(&controller)) return "policy";
+    if (dynamic_cast<const AIController*>(&controller)) return "AI";
+    return "other";
+}
+
+MatchResult RunHeadlessMatch(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const HeadlessOptions& options, uint64_t seed, const std::string& replayPath) {
+    NullAudioSink audio;
+    Match match(options.mode, yellowAssets, redAssets, audio, seed, options.shipsPerSide);
+    match.SetAIParams(Side::RIGHT, options.redParams);
+    match.SetAIParams(Side::LEFT, options.yellowParams);
+    match.SetAIDifficulty(Side::RIGHT, options.redDifficulty);
+    match.SetAIDifficulty(Side::LEFT, options.yellowDifficulty);
+    match.SetAIPolicy(Side::RIGHT, options.redPolicy);
+    match.SetAIPolicy(Side::LEFT, options.yellowPolicy);
+    match.world.SetAIThinkBudget(options.aiThinkBudget);
+    match.world.SetThinkTiming(options.thinkTimes);
+
+    std::unique_ptr<JobSystem> jobs;
+    if (options.jobThreads != 1) {
+        jobs = std::make_unique<JobSystem>(options.jobThreads);
+        match.world.SetJobSystem(jobs.get());
+    }
+
+    std::unique_ptr<ReplayRecorder> recorder;
+    if (!replayPath.empty()) recorder = std::make_unique<ReplayRecorder>(match);
+
+    while (!match.IsOver() && match.GetClock().time < options.maxMatchTime) {
+        match.Step(options.dt);
+        if (recorder) recorder->Record(match);
+    }
+
+    if (recorder && !recorder->Save(replayPath)) {
+        std::fprintf(stderr, "could not write replay %s\n", replayPath.c_str());
+    }
+
+    TeamStats red = match.world.GetTeamStats(Side::RIGHT);
+    TeamStats yellow = match.world.GetTeamStats(Side::LEFT);
+
+    std::map<std::string, ThinkReport> thinks;
+    const AIScheduler& scheduler = match.world.GetAIScheduler();
+    for (auto& ship : match.world.ships) {
+        std::string name = std::string(ship->shipSide == Side::RIGHT ? "red " : "yellow ") + ControllerName(*ship->controller);
+        ThinkReport& report = thinks[name];
+        report.times.Merge(match.world.GetThinkTimes(ship->id));
+        report.thought += scheduler.ThoughtCount(ship->id);
+        report.skipped += scheduler.SkippedCount(ship->id);
+    }
+
+    LookaheadStats lookahead;
+    for (auto& ship : match.world.ships) {
+        auto hard = dynamic_cast<const LookaheadController*>(ship->controller.get());
+        if (!hard) continue;
+
+        lookahead.plans += hard->GetStats().plans;
+        lookahead.rollouts += hard->GetStats().rollouts;
+        lookahead.seconds += hard->GetStats().seconds;
+        lookahead.modelledSeconds += hard->GetStats().modelledSeconds;
+        lookahead.worstSeconds = std::max(lookahead.worstSeconds, hard->GetStats().worstSeconds);
+        lookahead.overBudget += hard->GetStats().overBudget;
+    }
+
+    return {
+        match.GetWinner(),
+        match.GetTick(),
+        match.GetClock().time,
+        red.health,
+        yellow.health,
+        red.alive,
+        yellow.alive,
+        red.damageDealt,
+        yellow.damageDealt,
+        match.world.Checksum(),
+        lookahead,
+        thinks,
+        match.world.GetThinkStageTimes()
+    };
+}
+
+const char* WinnerName(Winner winner) {
+    switch (winner) {
+        case Winner::Red: return "red";
+        case Winner::Yellow: return "yellow";
+        case Winner::None: return "draw";
+    }
+    return "draw";
+}
+
+// Benches and tests with flags of their own, each run by the module it
+// exercises. The first of these flags on the command line picks one
+struct HeadlessCommand {
+    const char* flag;
+    int (*run)(int argc, char** argv);
+};
+
+static const HeadlessCommand commands[] = {
+    {"--replay", RunReplayCommand},
+    {"--replay-test", RunReplayTestCommand},
+    {"--kernel-bench", RunKernelBenchCommand},
+    {"--policy-bench", RunPolicyBenchCommand},
+    {"--netplay-test", RunNetplayTestCommand},
+    {"--rollback-bench", RunRollbackBenchCommand},
+    {"--serve", RunSpectatorServerCommand},
+    {"--spectate-bench", RunSpectateBenchCommand},
+    {"--env-bench", RunEnvBenchCommand},
+};
+
+static void PrintUsage() {
+    std::printf("usage: main --headless [--matches N] [--dt SECONDS] [--max-time SECONDS] [--verbose] [--arena SHIPS_PER_SIDE]\n");
+    std::printf("                       [--jobs THREADS] [--seed N] [--check-determinism] [--record FILE] [--hard red|yellow|both]\n");
+    std::printf("                       [--think-times] [--ai-budget MICROSECONDS] [--red-params FILE] [--yellow-params FILE]\n");
+    std::printf("                       [--red-behaviours FILE] [--yellow-behaviours FILE] [--red-policy FILE] [--yellow-policy FILE]\n");
+    for (const HeadlessCommand& command : commands) {
+        std::printf("       main --headless %s ...\n", command.flag);
+    }
+}
+
+// Match i of a recorded run. The first keeps the path as given
+static std::string ReplayPathFor(const std::string& path, int match) {
+    if (path.empty() || match == 0) return path;
+    return path + "-" + std::to_string(match);
+}
+
+int RunHeadless(int argc, char** argv) {
+    for (int i = 2; i < argc; i++) {
+        for (const HeadlessCommand& command : commands) {
+            if (std::string(argv[i]) == command.flag) return command.run(argc, argv);
+        }
+    }
+
+    HeadlessOptions options;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--matches" && hasValue) options.matches = std::atoi(argv[++i]);
+        else if (arg == "--dt" && hasValue) options.dt = (float)std::atof(argv[++i]);
+        else if (arg == "--max-time" && hasValue) options.maxMatchTime = std::atof(argv[++i]);
+        else if (arg == "--verbose") options.verbose = true;
+        else if (arg == "--arena" && hasValue) {
+            options.mode = GameMode::Arena;
+            options.shipsPerSide = std::atoi(argv[++i]);
+        }
+        else if (arg == "--jobs" && hasValue) options.jobThreads = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--check-determinism") options.checkDeterminism = true;
+        else if (arg == "--record" && hasValue) options.recordPath = argv[++i];
+        else if (arg == "--think-times") options.thinkTimes = true;
+        else if (arg == "--ai-budget" && hasValue) options.aiThinkBudget = (float)std::atof(argv[++i]);
+        else if (arg == "--hard" && hasValue) {
+            std::string sides = argv[++i];
+            if (sides == "red" || sides == "both") options.redDifficulty = AIDifficulty::Hard;
+            if (sides == "yellow" || sides == "both") options.yellowDifficulty = AIDifficulty::Hard;
+        }
+        else if ((arg == "--red-params" || arg == "--yellow-params") && hasValue) {
+            AIParams& params = arg == "--red-params" ? options.redParams : options.yellowParams;
+            if (!params.Load(argv[++i])) {
+                std::fprintf(stderr, "could not read AI params %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if ((arg == "--red-behaviours" || arg == "--yellow-behaviours") && hasValue) {
+            AIParams& params = arg == "--red-behaviours" ? options.redParams : options.yellowParams;
+            params.behaviours = LoadHeadlessBehaviours(argv[++i]);
+            if (!params.behaviours) return 1;
+        }
+        else if ((arg == "--red-policy" || arg == "--yellow-policy") && hasValue) {
+            auto& policy = arg == "--red-policy" ? options.redPolicy : options.yellowPolicy;
+            policy = LoadHeadlessPolicy(argv[++i]);
+            if (!policy) return 1;
+        }
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (options.matches <= 0 || options.dt <= 0.0f || options.shipsPerSide <= 0 || options.jobThreads < 0) {
+        PrintUsage();
+        return 1;
+    }
+
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+
+    int redWins = 0, yellowWins = 0, draws = 0, diverged = 0;
+    double totalSimTime = 0.0;
+    long totalTicks = 0;
+    LookaheadStats lookahead;
+    std::map<std::string, ThinkReport> thinks;
+    TimingHistogram thinkStage;
+
+    // The replay runs single threaded, so --jobs also checks the parallel tick against the serial one
+    HeadlessOptions replayOptions = options;
+    replayOptions.jobThreads = 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < options.matches; i++) {
+        uint64_t seed = Random::MixSeed(options.seed, (uint64_t)i);
+        MatchResult result = RunHeadlessMatch(yellowAssets, redAssets, options, seed, ReplayPathFor(options.recordPath, i));
+
+        if (options.checkDeterminism) {
+            MatchResult replay = RunHeadlessMatch(yellowAssets, redAssets, replayOptions, seed);
+            if (replay.checksum != result.checksum || replay.ticks != result.ticks) {
+                diverged++;
+                std::printf("match %d (seed %llu) diverged: %ld ticks %016llx, replay %ld ticks %016llx\n",
+                    i, (unsigned long long)seed, result.ticks, (unsigned long long)result.checksum,
+                    replay.ticks, (unsigned long long)replay.checksum);
+            }
+        }
+
+        if (result.winner == Winner::Red) redWins++;
+        else if (result.winner == Winner::Yellow) yellowWins++;
+        else draws++;
+
+        totalSimTime += result.simTime;
+        totalTicks += result.ticks;
+        lookahead.plans += result.lookahead.plans;
+        lookahead.rollouts += result.lookahead.rollouts;
+        lookahead.seconds += result.lookahead.seconds;
+        lookahead.modelledSeconds += result.lookahead.modelledSeconds;
+        lookahead.worstSeconds = std::max(lookahead.worstSeconds, result.lookahead.worstSeconds);
+        lookahead.overBudget += result.lookahead.overBudget;
+        for (auto& [name, report] : result.thinks) {
+            thinks[name].Merge(report);
+        }
+        thinkStage.Merge(result.thinkStage);
+
+        if (options.verbose) {
+            std::printf("match %d: %s in %ld ticks (%.1fs), alive red %d yellow %d, health red %.1f yellow %.1f\n",
+                i, WinnerName(result.winner), result.ticks, result.simTime,
+                result.redAlive, result.yellowAlive, result.redHealth, result.yellowHealth);
+        }
+    }
+
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("matches: %d  red: %d  yellow: %d  draw: %d\n", options.matches, redWins, yellowWins, draws);
+    std::printf("simulated %.1fs in %ld ticks, wall %.3fs (%.0fx real time)\n",
+        totalSimTime, totalTicks, wallTime, wallTime > 0.0 ? totalSimTime / wallTime : 0.0);
+
+    if (lookahead.plans > 0) {
+        std::printf("lookahead: %ld searches, %.1f rollouts each, %.1f us avg, %.1f us worst, %.2f%% over the %d us budget\n",
+            lookahead.plans, (double)lookahead.rollouts / lookahead.plans, lookahead.seconds * 1e6 / lookahead.plans,
+            lookahead.worstSeconds * 1e6, lookahead.overBudget * 100.0 / lookahead.plans, LOOKAHEAD_BUDGET_US);
+        std::printf("lookahead cost model: %.1f us avg modelled, measured %.2fx that\n",
+            lookahead.modelledSeconds * 1e6 / lookahead.plans,
+            lookahead.modelledSeconds > 0.0 ? lookahead.seconds / lookahead.modelledSeconds : 0.0);
+    }
+
+    for (auto& [name, report] : thinks) {
+        long ticks = report.thought + report.skipped;
+        if (ticks == 0 || (!options.thinkTimes && report.skipped == 0)) continue;
+
+        std::printf("think %s: %ld ticks, %.1f%% skipped", name.c_str(), ticks, report.skipped * 100.0 / ticks);
+        if (report.times.Count() > 0) {
+            std::printf(", p50 %.2f us, p99 %.2f us, max %.2f us, mean %.2f us",
+                report.times.Percentile(0.5) / 1000.0, report.times.Percentile(0.99) / 1000.0,
+                report.times.Max() / 1000.0, report.times.Mean() / 1000.0);
+        }
+        std::printf("\n");
+    }
+    if (thinkStage.Count() > 0) {
+        std::printf("think stage per tick: p50 %.2f us, p99 %.2f us, max %.2f us, mean %.2f us\n",
+            thinkStage.Percentile(0.5) / 1000.0, thinkStage.Percentile(0.99) / 1000.0,
+            thinkStage.Max() / 1000.0, thinkStage.Mean() / 1000.0);
+    }
+
+    if (options.checkDeterminism) {
+        std::printf("determinism: %d of %d matches diverged on replay\n", diverged, options.matches);
+        return diverged == 0 ? 0 : 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include "core/JobSystem.hpp"
+#include <algorithm>
+
+// The pool the current thread works for and its queue in it. Threads outside
+// the pool, including workers of another pool, use queue 0.
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local int currentQueue = 0;
+
+TaskGraph::TaskID TaskGraph::Add(std::function<void()> fn, std::initializer_list<TaskID> dependencies) {
+    TaskID id = (TaskID)tasks.size();
+    tasks.emplace_back();
+    tasks.back().fn = std::move(fn);
+
+    for (TaskID dependency : dependencies) {
+        tasks[dependency].successors.push_back(id);
+        tasks.back().dependencyCount++;
+    }
+    return id;
+}
+
+void TaskGraph::Clear() {
+    tasks.clear();
+}
+
+void TaskGraph::RunSerial() {
+    for (Task& task : tasks) {
+        task.fn();
+    }
+}
+
+int TaskGraph::Size() const {
+    return (int)tasks.size();
+}
+
+JobSystem::JobSystem(int threads) {
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    threads = std::max(1, threads);
+
+    for (int i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int JobSystem::ThreadCount() const {
+    return (int)queues.size();
+}
+
+int JobSystem::QueueIndex() const {
+    return currentSystem == this ? currentQueue : 0;
+}
+
+void JobSystem::Push(Job job) {
+    Queue& queue = *queues[QueueIndex()];
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    // Taking sleepLock orders this with a worker deciding to sleep, so the wakeup can't be missed
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queued++;
+    }
+    wake.notify_one();
+}
+
+// Runs the newest job from this thread's queue, else steals the oldest from another
+bool JobSystem::TryRunOne() {
+    Job job;
+    bool found = false;
+    int index = QueueIndex();
+
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+
+    int count = (int)queues.size();
+    for (int k = 1; k < count && !found; k++) {
+        Queue& victim = *queues[(index + k) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) return false;
+
+    queued--;
+    job.fn();
+    job.pending->fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void JobSystem::WaitFor(std::atomic<int>& pending) {
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!TryRunOne()) std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(int index) {
+    currentSystem = this;
+    currentQueue = index;
+
+    while (true) {
+        if (TryRunOne()) continue;
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this]() { return stopping || queued > 0; });
+        if (stopping) return;
+    }
+}
+
+void JobSystem::ParallelFor(int count, int grain, const std::function<void(int, int)>& fn) {
+    if (count <= 0) return;
+    grain = std::max(1, grain);
+
+    // Not worth a job when it fits in one chunk or there's nobody to share with
+    if (count <= grain || queues.size() == 1) {
+        fn(0, count);
+        return;
+    }
+
+    int chunks = (count + grain - 1) / grain;
+    std::atomic<int> pending{chunks - 1};
+
+    for (int c = 1; c < chunks; c++) {
+        int begin = c * grain;
+        int end = std::min(count, begin + grain);
+        Push({[&fn, begin, end]() { fn(begin, end); }, &pending});
+    }
+
+    fn(0, std::min(count, grain));
+    WaitFor(pending);
+}
+
+void JobSystem::StartTask(TaskGraph& graph, TaskGraph::TaskID id, std::atomic<int>& pending) {
+    Push({[this, &graph, id, &pending]() {
+        TaskGraph::Task& task = graph.tasks[id];
+        task.fn();
+
+        for (TaskGraph::TaskID next : task.successors) {
+            if (graph.tasks[next].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                StartTask(graph, next, pending);
+            }
+        }
+    }, &pending});
+}
+
+void JobSystem::Run(TaskGraph& graph) {
+    if (graph.tasks.empty()) return;
+
+    if (queues.size() == 1) {
+        graph.RunSerial();
+        return;
+    }
+
+    for (TaskGraph::Task& task : graph.tasks) {
+        task.remaining.store(task.dependencyCount, std::memory_order_relaxed);
+    }
+
+    std::atomic<int> pending{graph.Size()};
+    for (TaskGraph::TaskID id = 0; id < graph.Size(); id++) {
+        if (graph.tasks[id].dependencyCount == 0) StartTask(graph, id, pending);
+    }
+
+    WaitFor(pending);
+}
+
+void JobSystem::Spawn(std::function<void()> fn, std::atomic<int>& pending) {
+    if (workers.empty()) {
+        fn();
+        return;
+    }
+
+    pending.fetch_add(1, std::memory_order_acq_rel);
+    Push({std::move(fn), &pending});
+}
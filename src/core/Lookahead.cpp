@@ -0,0 +1,194 @@
+#include "core/Lookahead.hpp"
+#include "core/weapons.hpp"
+#include "core/batchKernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Seconds between the bullets a ship fires while lined up
+const float lookaheadFireInterval = 0.25f;
+
+LookaheadSim::LookaheadSim(int enemies, int maxBullets, int maxEnergy)
+    : bullets(maxBullets, enemies + 2), energy(maxEnergy, enemies + 2),
+      maxEnemies(enemies), outsider((uint16_t)(enemies + 1)) {
+    ships.reserve(enemies + 1);
+    centers.resize(enemies + 1);
+    mask.resize(std::max(maxBullets, maxEnergy));
+}
+
+static LookaheadShip CopyShip(const Spaceship& ship) {
+    LookaheadShip copy;
+    copy.rect = ship.shipRect;
+    copy.velocity = ship.velocity;
+    copy.side = ship.shipSide;
+    copy.speed = ship.shipVel;
+    copy.accel = ship.accel;
+    copy.decel = ship.decel;
+    copy.health = ship.health;
+    copy.bulletVel = ship.bulletVel;
+    copy.bulletDamage = ship.bulletDamage;
+    copy.bulletLim = ship.bulletLim;
+
+    // Keep going the way it is going. Velocity is part of a snapshot where
+    // the last controls are not, so this also holds after a rollback
+    copy.control.moveX = ship.shipVel > 0.0f ? std::clamp(ship.velocity.x / ship.shipVel, -1.0f, 1.0f) : 0.0f;
+    copy.control.moveY = ship.shipVel > 0.0f ? std::clamp(ship.velocity.y / ship.shipVel, -1.0f, 1.0f) : 0.0f;
+    return copy;
+}
+
+static Vector2 CenterOf(const Rectangle& rect) {
+    return {rect.x + rect.width / 2, rect.y + rect.height / 2};
+}
+
+// Whether a projectile at (x, y) moving at (vx, vy) can get within reach of
+// ship within horizon seconds, ship moving at full speed the whole time
+static bool CanReach(const LookaheadShip& ship, float x, float y, float vx, float vy, float horizon) {
+    Vector2 center = CenterOf(ship.rect);
+    float reach = ship.speed * horizon + std::max(ship.rect.width, ship.rect.height);
+    float dx = center.x - x;
+    float dy = center.y - y;
+    float closing = std::sqrt(vx * vx + vy * vy) * horizon;
+    return dx * dx + dy * dy <= (reach + closing) * (reach + closing);
+}
+
+void LookaheadSim::Capture(const std::vector<std::unique_ptr<Spaceship>>& worldShips, const Spaceship& self, double now, float horizon) {
+    time = now;
+    ships.clear();
+    bullets.Clear();
+    energy.Clear();
+    shipOf.assign(worldShips.size(), -1);
+
+    ships.push_back(CopyShip(self));
+    shipOf[self.id] = 0;
+
+    // Its target first, then the nearest other enemies
+    Vector2 center = self.GetCenter();
+    nearest.clear();
+    for (auto& ship : worldShips) {
+        if (ship->shipSide == self.shipSide || ship->IsDead()) continue;
+
+        Vector2 other = ship->GetCenter();
+        float dist2 = (other.x - center.x) * (other.x - center.x) + (other.y - center.y) * (other.y - center.y);
+        nearest.push_back({ship.get() == self.target ? -1.0f : dist2, ship->id});
+    }
+    int kept = std::min((int)nearest.size(), maxEnemies);
+    std::partial_sort(nearest.begin(), nearest.begin() + kept, nearest.end());
+    for (int k = 0; k < kept; k++) {
+        shipOf[nearest[k].second] = (int)ships.size();
+        ships.push_back(CopyShip(*worldShips[nearest[k].second]));
+    }
+
+    // Projectiles of the ships kept always come along, so the bullet limit
+    // holds. Others only when they can reach a kept ship on the other team
+    auto threatens = [&](uint8_t team, float x, float y, float vx, float vy) {
+        for (const LookaheadShip& ship : ships) {
+            if ((uint8_t)ship.side != team && CanReach(ship, x, y, vx, vy, horizon)) return true;
+        }
+        return false;
+    };
+
+    const ProjectilePool& worldBullets = self.projectiles.bullets;
+    for (int i = 0; i < worldBullets.Count(); i++) {
+        int owner = shipOf[worldBullets.owner[i]];
+        float cx = worldBullets.x[i] + bulletSize.x / 2;
+        float cy = worldBullets.y[i] + bulletSize.y / 2;
+        if (owner < 0 && !threatens(worldBullets.team[i], cx, cy, worldBullets.vx[i], worldBullets.vy[i])) continue;
+
+        bullets.Spawn({worldBullets.x[i], worldBullets.y[i]}, {worldBullets.vx[i], worldBullets.vy[i]}, worldBullets.damage[i],
+                      owner >= 0 ? (uint16_t)owner : outsider, worldBullets.team[i]);
+    }
+
+    // Homing energy weapons only when they home in on a kept ship, as
+    // nothing else is there to steer them
+    const ProjectilePool& worldEnergy = self.projectiles.energy;
+    for (int i = 0; i < worldEnergy.Count(); i++) {
+        int target = worldEnergy.homing[i] ? shipOf[worldEnergy.target[i]] : 0;
+        if (target < 0) continue;
+        if (!worldEnergy.homing[i] && !threatens(worldEnergy.team[i], worldEnergy.x[i], worldEnergy.y[i], worldEnergy.vx[i], worldEnergy.vy[i])) continue;
+
+        int owner = shipOf[worldEnergy.owner[i]];
+        ProjectileHandle handle = energy.Spawn({worldEnergy.x[i], worldEnergy.y[i]}, {worldEnergy.vx[i], worldEnergy.vy[i]}, worldEnergy.damage[i],
+                                               owner >= 0 ? (uint16_t)owner : outsider, worldEnergy.team[i], worldEnergy.spawnTime[i], (uint16_t)target);
+        if (!handle.IsNull()) energy.homing[energy.IndexOf(handle)] = worldEnergy.homing[i];
+    }
+}
+
+void LookaheadSim::Step(const ControlState& selfControl, float dt) {
+    time += dt;
+
+    for (int s = 0; s < (int)ships.size(); s++) {
+        LookaheadShip& ship = ships[s];
+        centers[s] = CenterOf(ship.rect);
+        if (ship.health <= 0) continue;
+
+        Spaceship::Move(ship.rect, ship.velocity, ship.side, ship.speed, ship.accel, ship.decel, s == 0 ? selfControl : ship.control, dt);
+        centers[s] = CenterOf(ship.rect);
+
+        ship.fireCooldown -= dt;
+        if (ship.fireCooldown <= 0.0f) Fire(s);
+    }
+
+    weapons::UpdateBullets(bullets, dt);
+    SimClock clock;
+    clock.dt = dt;
+    clock.time = time;
+    weapons::UpdateEnergyWeapons(energy, clock, centers.data());
+
+    ApplyHits(bullets, false);
+    ApplyHits(energy, true);
+    bullets.RemoveMarked();
+    energy.RemoveMarked();
+}
+
+void LookaheadSim::Fire(int s) {
+    LookaheadShip& ship = ships[s];
+    if (bullets.CountOwnedBy((uint16_t)s) >= ship.bulletLim) return;
+
+    float y = CenterOf(ship.rect).y;
+    for (const LookaheadShip& other : ships) {
+        if (other.side == ship.side || other.health <= 0) continue;
+        if (std::fabs(CenterOf(other.rect).y - y) >= other.rect.height / 2) continue;
+
+        Vector2 vel = {(ship.side == Side::LEFT ? 1 : -1) * ship.bulletVel, 0};
+        bullets.Spawn(Spaceship::BulletOrigin(ship.rect, ship.side), vel, ship.bulletDamage, (uint16_t)s, (uint8_t)ship.side);
+        ship.fireCooldown = lookaheadFireInterval;
+        return;
+    }
+}
+
+// As Spaceship::FindHits and ApplyHits: bullets hit the hitbox, energy
+// weapons the whole ship, and each projectile only its first ship
+void LookaheadSim::ApplyHits(ProjectilePool& pool, bool circles) {
+    for (LookaheadShip& ship : ships) {
+        if (ship.health <= 0) continue;
+
+        int hits = circles
+            ? kernels::OverlapCircles(pool.x.data(), pool.y.data(), pool.Count(), energyRadius, ship.rect, mask.data())
+            : kernels::OverlapBoxes(pool.x.data(), pool.y.data(), pool.Count(), bulletSize.x, bulletSize.y, Spaceship::HitBox(ship.rect), mask.data());
+
+        for (int i = 0; i < pool.Count() && hits > 0; i++) {
+            if (!mask[i]) continue;
+            hits--;
+            if (pool.team[i] == (uint8_t)ship.side || pool.IsMarked(i)) continue;
+
+            ship.health -= pool.damage[i];
+            ship.damageTaken += pool.damage[i];
+            if (pool.owner[i] != outsider) ships[pool.owner[i]].damageDealt += pool.damage[i];
+            pool.MarkForRemoval(i);
+        }
+    }
+}
+
+int LookaheadSim::Size() const {
+    return (int)ships.size() + bullets.Count() + energy.Count();
+}
+
+bool LookaheadSim::Threatened() const {
+    uint8_t team = (uint8_t)ships[0].side;
+    for (int i = 0; i < bullets.Count(); i++) {
+        if (bullets.team[i] != team) return true;
+    }
+    for (int i = 0; i < energy.Count(); i++) {
+        if (energy.team[i] != team) return true;
+    }
+    return false;
+}
@@ -0,0 +1,275 @@
+#include "core/Match.hpp"
+#include "controllers/PlayerController.hpp"
+#include "controllers/AIController.hpp"
+#include "controllers/LookaheadController.hpp"
+#include "core/config.h"
+#include "core/Random.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static int MaxShips(GameMode mode, int shipsPerSide) {
+    return mode == GameMode::Arena ? shipsPerSide * 2 : 2;
+}
+
+Match::Match(GameMode gameMode, const ShipAssets& yellowAssets, const ShipAssets& redAssets, IAudioSink& audio, uint64_t matchSeed, int arenaShipsPerSide)
+    : world(audio, MaxShips(gameMode, arenaShipsPerSide)), mode(gameMode), seed(matchSeed),
+      shipsPerSide(gameMode == GameMode::Arena ? arenaShipsPerSide : 1) {
+
+    if (mode == GameMode::Arena) {
+        SpawnArena(yellowAssets, redAssets);
+        return;
+    }
+
+    // Red is added first so it keeps acting first each tick
+    redShip = &world.AddShip(redAssets, Side::RIGHT, nullptr);
+    yellowShip = &world.AddShip(yellowAssets, Side::LEFT, nullptr);
+    redShip->target = yellowShip;
+    yellowShip->target = redShip;
+
+    switch (mode) {
+        case GameMode::TwoPlayer: {
+            std::unique_ptr yellowController = std::make_unique<PlayerController>(
+                std::vector<int>{KEY_W, KEY_S, KEY_A, KEY_D}, KEY_C, KEY_V
+            );
+
+            std::unique_ptr redController = std::make_unique<PlayerController>(
+            std::vector<int>{KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT}, KEY_M, KEY_K
+            );
+
+            yellowShip->controller = std::move(yellowController);
+            redShip->controller = std::move(redController);
+            break;
+        }
+
+        case GameMode::SinglePlayer: {
+            std::unique_ptr yellowController = std::make_unique<PlayerController>(
+                std::vector<int>{KEY_W, KEY_S, KEY_A, KEY_D}, KEY_C, KEY_V
+            );
+
+            yellowShip->controller = std::move(yellowController);
+            redShip->controller = MakeAI(*redShip);
+
+            #if AITest
+            yellowShip->health = 100;
+            redShip->health = 100;
+            #endif
+
+            break;
+        }
+
+        case GameMode::NoPlayer: {
+            yellowShip->controller = MakeAI(*yellowShip);
+            redShip->controller = MakeAI(*redShip);
+
+            #if AITest
+            yellowShip->health = 100;
+            redShip->health = 100;
+            #endif
+            
+            break;
+        }
+
+        case GameMode::Arena:
+            break;
+    }
+}
+
+// Lays each team out on a grid filling its half of the arena
+void Match::SpawnArena(const ShipAssets& yellowAssets, const ShipAssets& redAssets) {
+    for (Side side : {Side::RIGHT, Side::LEFT}) {
+        const ShipAssets& assets = side == Side::LEFT ? yellowAssets : redAssets;
+
+        for (int i = 0; i < shipsPerSide; i++) {
+            Spaceship& ship = world.AddShip(assets, side, nullptr);
+            ship.controller = MakeAI(ship);
+        }
+    }
+
+    redShip = world.ships[0].get();
+    yellowShip = world.ships[shipsPerSide].get();
+
+    float halfWidth = WIDTH / 2 - MIDDLERECTWIDTH;
+    int cols = std::max(1, (int)std::ceil(std::sqrt(shipsPerSide * halfWidth / HEIGHT)));
+    int rows = (shipsPerSide + cols - 1) / cols;
+
+    for (auto& ship : world.ships) {
+        int slot = ship->id % shipsPerSide;
+        float cellW = (halfWidth - ship->shipRect.width) / std::max(1, cols - 1);
+        float cellH = (HEIGHT - ship->shipRect.height) / std::max(1, rows - 1);
+        float x = (slot % cols) * cellW;
+        float y = (slot / cols) * cellH;
+
+        if (ship->shipSide == Side::RIGHT) x = WIDTH - ship->shipRect.width - x;
+        ship->SetSpawnPosition({x, y});
+    }
+}
+
+void Match::SetAIDifficulty(Side side, AIDifficulty aiDifficulty) {
+    difficulty[(int)side] = aiDifficulty;
+    RebuildAI(side);
+}
+
+void Match::SetAIParams(Side side, const AIParams& params) {
+    aiParams[(int)side] = params;
+    RebuildAI(side);
+}
+
+void Match::SetAIPolicy(Side side, std::shared_ptr<const Policy> policy) {
+    policyBatches[(int)side] = policy ? std::make_shared<PolicyBatch>(std::move(policy)) : nullptr;
+    RebuildAI(side);
+}
+
+void Match::RebuildAI(Side side) {
+    for (auto& ship : world.ships) {
+        if (ship->shipSide == side && IsAIShip(*ship)) ship->controller = MakeAI(*ship);
+    }
+}
+
+bool Match::IsAIShip(const Spaceship& ship) const {
+    switch (mode) {
+        case GameMode::SinglePlayer: return &ship == redShip;
+        case GameMode::TwoPlayer: return false;
+        case GameMode::NoPlayer:
+        case GameMode::Arena: return true;
+    }
+    return false;
+}
+
+// In the one on one modes each AI knows its opponent, in the arena it
+// fights whichever enemy the world targets
+std::unique_ptr<IController> Match::MakeAI(Spaceship& ship) {
+    Spaceship* enemy = nullptr;
+    if (mode != GameMode::Arena) enemy = &ship == redShip ? yellowShip : redShip;
+
+    int side = (int)ship.shipSide;
+    if (policyBatches[side]) {
+        return std::make_unique<PolicyController>(&ship, enemy, policyBatches[side]);
+    }
+    if (difficulty[side] == AIDifficulty::Hard) {
+        return std::make_unique<LookaheadController>(&ship, enemy, world.ships, ControllerSeed(ship), aiParams[side]);
+    }
+    return std::make_unique<AIController>(&ship, enemy, ControllerSeed(ship), aiParams[side]);
+}
+
+void Match::PollInput() {
+    for (auto& ship : world.ships) {
+        ship->controller->PollInput();
+    }
+}
+
+void Match::Step(float dt) {
+    if (over) return;
+
+    clock.Advance(dt);
+    tick++;
+
+    world.Step(clock, tick);
+
+    // A team loses once it has no ships left. If both go on the same tick red wins
+    bool yellowAlive = world.GetTeamStats(Side::LEFT).alive > 0;
+    bool redAlive = world.GetTeamStats(Side::RIGHT).alive > 0;
+
+    if (!redAlive) {
+        winner = Winner::Yellow;
+        over = true;
+    }
+
+    if (!yellowAlive) {
+        winner = Winner::Red;
+        over = true;
+    }
+}
+
+void Match::Draw(IRenderSink& renderer, float alpha) {
+    world.Draw(renderer, alpha);
+}
+
+void Match::Reset() {
+    world.Reset();
+    for (auto& ship : world.ships) {
+        if (ship->controller) ship->controller->Reset();
+    }
+
+    if (mode != GameMode::Arena) {
+        redShip->target = yellowShip;
+        yellowShip->target = redShip;
+    }
+
+    clock = SimClock{};
+    tick = 0;
+    winner = Winner::None;
+    over = false;
+}
+
+void Match::SaveState(ByteWriter& out) const {
+    out.F64(clock.time);
+    out.F32(clock.dt);
+    out.Varint((uint64_t)tick);
+    out.U8((uint8_t)winner);
+    out.U8(over ? 1 : 0);
+    world.SaveState(out);
+
+    // Each controller's state goes in a sized block, so a match driven by
+    // different controllers, like a replay, can still load the world
+    for (auto& ship : world.ships) {
+        size_t sizeAt = out.Size();
+        out.U32(0);
+        if (ship->controller) ship->controller->SaveState(out);
+        out.PatchU32(sizeAt, (uint32_t)(out.Size() - sizeAt - 4));
+    }
+}
+
+bool Match::LoadState(ByteReader& in) {
+    clock.time = in.F64();
+    clock.dt = in.F32();
+    tick = (long)in.Varint();
+    uint8_t outcome = in.U8();
+    if (outcome > (uint8_t)Winner::Yellow) in.ok = false;
+    if (!in.ok) return false;
+    winner = (Winner)outcome;
+    over = in.U8() != 0;
+    if (!world.LoadState(in)) return false;
+
+    for (auto& ship : world.ships) {
+        uint32_t size = in.U32();
+        const uint8_t* state = in.Skip(size);
+        if (!state) return false;
+
+        ByteReader controllerState(state, size);
+        if (ship->controller) ship->controller->LoadState(controllerState);
+    }
+    return in.ok;
+}
+
+bool Match::IsOver() const {
+    return over;
+}
+
+Winner Match::GetWinner() const {
+    return winner;
+}
+
+GameMode Match::GetMode() const {
+    return mode;
+}
+
+uint64_t Match::GetSeed() const {
+    return seed;
+}
+
+int Match::GetShipsPerSide() const {
+    return shipsPerSide;
+}
+
+uint64_t Match::ControllerSeed(const Spaceship& ship) const {
+    return Random::MixSeed(seed, ship.id);
+}
+
+const SimClock& Match::GetClock() const {
+    return clock;
+}
+
+long Match::GetTick() const {
+    return tick;
+}
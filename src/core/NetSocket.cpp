@@ -0,0 +1,107 @@
+#include "core/NetSocket.hpp"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+
+bool NetAddress::Parse(const std::string& text, uint16_t defaultPort, NetAddress& out) {
+    std::string host = text;
+    uint16_t port = defaultPort;
+
+    size_t colon = text.rfind(':');
+    if (colon != std::string::npos) {
+        host = text.substr(0, colon);
+        int parsed = std::atoi(text.c_str() + colon + 1);
+        if (parsed <= 0 || parsed > 65535) return false;
+        port = (uint16_t)parsed;
+    }
+    if (host.empty()) host = "127.0.0.1";
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) return false;
+
+    const sockaddr_in* addr = (const sockaddr_in*)result->ai_addr;
+    out.ip = ntohl(addr->sin_addr.s_addr);
+    out.port = port;
+    freeaddrinfo(result);
+    return true;
+}
+
+std::string NetAddress::ToString() const {
+    return std::to_string((ip >> 24) & 0xFF) + "." + std::to_string((ip >> 16) & 0xFF) + "." +
+           std::to_string((ip >> 8) & 0xFF) + "." + std::to_string(ip & 0xFF) + ":" + std::to_string(port);
+}
+
+UdpSocket::~UdpSocket() {
+    Close();
+}
+
+bool UdpSocket::Open(uint16_t port) {
+    Close();
+
+    handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle < 0) return false;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(handle, (const sockaddr*)&addr, sizeof(addr)) < 0 ||
+        fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) < 0) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void UdpSocket::Close() {
+    if (handle >= 0) close(handle);
+    handle = -1;
+}
+
+bool UdpSocket::IsOpen() const {
+    return handle >= 0;
+}
+
+uint16_t UdpSocket::LocalPort() const {
+    sockaddr_in addr = {};
+    socklen_t length = sizeof(addr);
+    if (handle < 0 || getsockname(handle, (sockaddr*)&addr, &length) < 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+void UdpSocket::SetReceiveBufferSize(int bytes) {
+    if (handle >= 0) setsockopt(handle, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+}
+
+bool UdpSocket::Send(const NetAddress& to, const void* data, size_t size) {
+    if (handle < 0) return false;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(to.ip);
+    addr.sin_port = htons(to.port);
+
+    return sendto(handle, data, size, 0, (const sockaddr*)&addr, sizeof(addr)) == (ssize_t)size;
+}
+
+int UdpSocket::Receive(NetAddress& from, void* buffer, size_t capacity) {
+    if (handle < 0) return -1;
+
+    sockaddr_in addr = {};
+    socklen_t length = sizeof(addr);
+    ssize_t received = recvfrom(handle, buffer, capacity, 0, (sockaddr*)&addr, &length);
+    if (received < 0) return -1;
+
+    from.ip = ntohl(addr.sin_addr.s_addr);
+    from.port = ntohs(addr.sin_port);
+    return (int)received;
+}
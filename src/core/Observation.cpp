@@ -0,0 +1,77 @@
+#include "core/Observation.hpp"
+#include "core/weapons.hpp"
+#include <algorithm>
+
+namespace observation {
+    // Velocities are divided by this, which puts them in about [-1, 1]
+    const float velocityScale = 1000.0f;
+
+    const int maxNearest = std::max(nearestBullets, nearestEnergy);
+
+    // The slots nearest projectiles, closest first and ties by index, kept
+    // by insertion into a short sorted list rather than sorting the pool
+    static int FindNearest(const ProjectilePool& pool, Vector2 offset, Vector2 center, int slots, int* nearest) {
+        float dist2[maxNearest];
+        int kept = 0;
+
+        for (int i = 0; i < pool.Count(); i++) {
+            float dx = pool.x[i] + offset.x - center.x;
+            float dy = pool.y[i] + offset.y - center.y;
+            float d2 = dx * dx + dy * dy;
+            if (kept == slots && d2 >= dist2[kept - 1]) continue;
+
+            int k = kept < slots ? kept++ : kept - 1;
+            for (; k > 0 && dist2[k - 1] > d2; k--) {
+                dist2[k] = dist2[k - 1];
+                nearest[k] = nearest[k - 1];
+            }
+            dist2[k] = d2;
+            nearest[k] = i;
+        }
+        return kept;
+    }
+
+    void Write(const Spaceship& self, const Spaceship& enemy, float fullHealth, float* out) {
+        bool mirrored = self.shipSide == Side::RIGHT;
+        float flip = mirrored ? -1.0f : 1.0f;
+        Vector2 center = self.GetCenter();
+
+        auto writeShip = [&](const Spaceship& ship) {
+            Vector2 shipCenter = ship.GetCenter();
+            out[0] = mirrored ? 1.0f - shipCenter.x / WIDTH : shipCenter.x / WIDTH;
+            out[1] = shipCenter.y / HEIGHT;
+            out[2] = flip * ship.velocity.x / velocityScale;
+            out[3] = ship.velocity.y / velocityScale;
+            out[4] = std::max(ship.health, 0.0f) / fullHealth;
+        };
+
+        writeShip(self);
+        out[5] = 1.0f - (float)self.projectiles.bullets.CountOwnedBy(self.id) / std::max(self.bulletLim, 1);
+        out[6] = 1.0f - (float)self.projectiles.energy.CountOwnedBy(self.id) / std::max(self.maxEnergyShots, 1);
+        out += shipFeatures;
+
+        writeShip(enemy);
+        out += enemyFeatures;
+
+        auto writeNearest = [&](const ProjectilePool& pool, Vector2 offset, int slots) {
+            int nearest[maxNearest];
+            int kept = FindNearest(pool, offset, center, slots, nearest);
+
+            for (int k = 0; k < slots; k++, out += projectileFeatures) {
+                if (k >= kept) {
+                    std::fill(out, out + projectileFeatures, 0.0f);
+                    continue;
+                }
+                int i = nearest[k];
+                out[0] = flip * (pool.x[i] + offset.x - center.x) / WIDTH;
+                out[1] = (pool.y[i] + offset.y - center.y) / HEIGHT;
+                out[2] = flip * pool.vx[i] / velocityScale;
+                out[3] = pool.vy[i] / velocityScale;
+                out[4] = pool.owner[i] == self.id ? -1.0f : 1.0f;
+            }
+        };
+
+        writeNearest(self.projectiles.bullets, {bulletSize.x / 2, bulletSize.y / 2}, nearestBullets);
+        writeNearest(self.projectiles.energy, {0.0f, 0.0f}, nearestEnergy);
+    }
+}
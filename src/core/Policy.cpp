@@ -0,0 +1,241 @@
+#include "core/Policy.hpp"
+#include "core/batchKernels.hpp"
+#include "core/ByteStream.hpp"
+#include "core/Headless.hpp"
+#include "core/Observation.hpp"
+#include "core/Random.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// "SBPL", then the version
+static const uint32_t policyMagic = 0x4C504253;
+static const uint8_t policyVersion = 1;
+
+// Far past anything that runs in a tick, so a corrupt size fails the load
+// rather than allocating gigabytes
+static const uint64_t maxLayers = 16;
+static const uint64_t maxWidth = 4096;
+
+void Policy::AddLayer(int layerInputs, int layerOutputs) {
+    Layer layer;
+    layer.inputs = layers.empty() ? layerInputs : layers.back().stride;
+    layer.outputs = layerOutputs;
+    layer.stride = (layerOutputs + kernels::denseAlign - 1) / kernels::denseAlign * kernels::denseAlign;
+    layer.weights.assign((size_t)layer.inputs * layer.stride, 0.0f);
+    layer.bias.assign(layer.stride, 0.0f);
+    layers.push_back(std::move(layer));
+}
+
+bool Policy::Load(const std::string& path) {
+    std::vector<uint8_t> bytes;
+    if (!ReadFileBytes(path, bytes)) return false;
+
+    ByteReader in(bytes);
+    if (in.U32() != policyMagic || in.U8() != policyVersion) return false;
+
+    Policy loaded;
+    uint64_t count = in.Varint();
+    if (count == 0 || count > maxLayers) return false;
+
+    for (uint64_t l = 0; l < count; l++) {
+        uint64_t layerInputs = in.Varint();
+        uint64_t layerOutputs = in.Varint();
+        if (!in.ok || layerInputs == 0 || layerOutputs == 0 || layerInputs > maxWidth || layerOutputs > maxWidth) return false;
+
+        if (l == 0) loaded.inputs = (int)layerInputs;
+        else if ((int)layerInputs != loaded.layers.back().outputs) return false;
+
+        loaded.AddLayer((int)layerInputs, (int)layerOutputs);
+        Layer& layer = loaded.layers.back();
+        for (int o = 0; o < layer.outputs; o++) {
+            for (int i = 0; i < (int)layerInputs; i++) {
+                layer.weights[(size_t)i * layer.stride + o] = in.F32();
+            }
+        }
+        for (int o = 0; o < layer.outputs; o++) {
+            layer.bias[o] = in.F32();
+        }
+        if (!in.ok) return false;
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
+
+bool Policy::Save(const std::string& path) const {
+    ByteWriter out;
+    out.U32(policyMagic);
+    out.U8(policyVersion);
+    out.Varint(layers.size());
+
+    int layerInputs = inputs;
+    for (const Layer& layer : layers) {
+        out.Varint((uint64_t)layerInputs);
+        out.Varint((uint64_t)layer.outputs);
+        for (int o = 0; o < layer.outputs; o++) {
+            for (int i = 0; i < layerInputs; i++) {
+                out.F32(layer.weights[(size_t)i * layer.stride + o]);
+            }
+        }
+        for (int o = 0; o < layer.outputs; o++) {
+            out.F32(layer.bias[o]);
+        }
+        layerInputs = layer.outputs;
+    }
+    return WriteFileBytes(path, out.bytes);
+}
+
+Policy Policy::Random(int policyInputs, const std::vector<int>& hidden, int outputs, uint64_t seed) {
+    ::Random random(seed);
+    Policy policy;
+    policy.inputs = policyInputs;
+
+    std::vector<int> widths = hidden;
+    widths.push_back(outputs);
+    int layerInputs = policyInputs;
+    for (int width : widths) {
+        policy.AddLayer(layerInputs, width);
+        Layer& layer = policy.layers.back();
+        float limit = std::sqrt(6.0f / layerInputs);
+        for (int i = 0; i < layerInputs; i++) {
+            for (int o = 0; o < width; o++) {
+                layer.weights[(size_t)i * layer.stride + o] = (random.Float() * 2.0f - 1.0f) * limit;
+            }
+        }
+        layerInputs = width;
+    }
+    return policy;
+}
+
+int Policy::Inputs() const {
+    return inputs;
+}
+
+int Policy::Outputs() const {
+    return layers.empty() ? 0 : layers.back().outputs;
+}
+
+int Policy::OutputStride() const {
+    return layers.empty() ? 0 : layers.back().stride;
+}
+
+long Policy::Parameters() const {
+    long count = 0;
+    int layerInputs = inputs;
+    for (const Layer& layer : layers) {
+        count += (long)(layerInputs + 1) * layer.outputs;
+        layerInputs = layer.outputs;
+    }
+    return count;
+}
+
+const float* Policy::Forward(const float* in, int rows, PolicyScratch& scratch) const {
+    if (layers.empty()) return in;
+
+    size_t widest = 0;
+    for (const Layer& layer : layers) {
+        widest = std::max(widest, (size_t)layer.stride);
+    }
+    if (scratch.a.size() < widest * rows) {
+        scratch.a.resize(widest * rows);
+        scratch.b.resize(widest * rows);
+    }
+
+    const float* x = in;
+    float* y = scratch.a.data();
+    for (size_t l = 0; l < layers.size(); l++) {
+        const Layer& layer = layers[l];
+        bool hidden = l + 1 < layers.size();
+        kernels::Dense(x, rows, layer.inputs, layer.weights.data(), layer.bias.data(), layer.stride, hidden, y);
+        x = y;
+        y = y == scratch.a.data() ? scratch.b.data() : scratch.a.data();
+    }
+    return x;
+}
+
+// Times policy inference one ship at a time and as one batch on every
+// backend this CPU supports, and checks every way gives the scalar outputs.
+// Without a policy file it times a random one of a typical size
+static int RunPolicyBench(int ships, const std::string& path) {
+    std::shared_ptr<const Policy> policy = path.empty()
+        ? std::make_shared<Policy>(Policy::Random(observation::size, {64, 64}, PolicyBatch::outputs, 1))
+        : LoadHeadlessPolicy(path);
+    if (!policy) return 1;
+
+    std::vector<float> observations((size_t)ships * policy->Inputs());
+    Random random(1);
+    for (float& value : observations) {
+        value = random.Float() * 2.0f - 1.0f;
+    }
+
+    int stride = policy->OutputStride();
+    std::vector<float> expected((size_t)ships * stride), outputs((size_t)ships * stride);
+    PolicyScratch scratch;
+    kernels::Backend original = kernels::ActiveBackend();
+
+    kernels::SetBackend(kernels::Backend::Scalar);
+    const float* result = policy->Forward(observations.data(), ships, scratch);
+    std::copy(result, result + expected.size(), expected.begin());
+
+    std::printf("%d ships, %d inputs, %d outputs, %ld parameters\n", ships, policy->Inputs(), policy->Outputs(), policy->Parameters());
+    const int reps = std::max(1, 200000 / ships);
+
+    for (kernels::Backend backend : {kernels::Backend::Scalar, kernels::Backend::SSE, kernels::Backend::AVX2}) {
+        kernels::SetBackend(backend);
+        if (kernels::ActiveBackend() != backend) continue;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            for (int s = 0; s < ships; s++) {
+                result = policy->Forward(observations.data() + (size_t)s * policy->Inputs(), 1, scratch);
+                std::copy(result, result + stride, outputs.begin() + (size_t)s * stride);
+            }
+        }
+        double single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bool matches = outputs == expected;
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            result = policy->Forward(observations.data(), ships, scratch);
+        }
+        double batched = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        matches = matches && std::equal(expected.begin(), expected.end(), result);
+
+        std::printf("%-6s %8.3f us/ship one at a time, %8.3f us/ship batched  (%s)\n", kernels::BackendName(backend),
+            single * 1e6 / ((double)reps * ships), batched * 1e6 / ((double)reps * ships), matches ? "matches scalar" : "MISMATCH");
+    }
+
+    kernels::SetBackend(original);
+    return 0;
+}
+
+static void PrintPolicyBenchUsage() {
+    std::printf("usage: main --headless --policy-bench SHIPS [--policy FILE]\n");
+}
+
+int RunPolicyBenchCommand(int argc, char** argv) {
+    int ships = 0;
+    std::string path;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--policy-bench" && hasValue) ships = std::atoi(argv[++i]);
+        else if (arg == "--policy" && hasValue) path = argv[++i];
+        else {
+            PrintPolicyBenchUsage();
+            return 1;
+        }
+    }
+
+    if (ships <= 0) {
+        PrintPolicyBenchUsage();
+        return 1;
+    }
+
+    return RunPolicyBench(ships, path);
+}
@@ -0,0 +1,267 @@
+#include "core/ProjectilePool.hpp"
+#include "core/weapons.hpp"
+#include <algorithm>
+
+ProjectilePool::ProjectilePool(int capacity, int maxOwners) {
+    Resize(capacity);
+    ownerCounts.assign(maxOwners, 0);
+}
+
+void ProjectilePool::Resize(int capacity) {
+    x.resize(capacity);
+    y.resize(capacity);
+    vx.resize(capacity);
+    vy.resize(capacity);
+    damage.resize(capacity);
+    owner.resize(capacity);
+    team.resize(capacity);
+    prevX.resize(capacity);
+    prevY.resize(capacity);
+    spawnTime.resize(capacity);
+    target.resize(capacity);
+    homing.resize(capacity);
+    marked.assign(capacity, 0);
+
+    denseToSlot.resize(capacity);
+    slotToDense.resize(capacity);
+    generations.assign(capacity, 0);
+
+    // Hand out low slots first
+    freeSlots.clear();
+    freeSlots.reserve(capacity);
+    for (int i = capacity - 1; i >= 0; i--) {
+        freeSlots.push_back((uint32_t)i);
+    }
+}
+
+ProjectileHandle ProjectilePool::Spawn(Vector2 pos, Vector2 vel, float dmg, uint16_t ownerID, uint8_t teamID, float spawnedAt, uint16_t targetID) {
+    if (freeSlots.empty() || ownerID >= ownerCounts.size()) return ProjectileHandle{};
+
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    int i = count++;
+    x[i] = pos.x;
+    y[i] = pos.y;
+    prevX[i] = pos.x;
+    prevY[i] = pos.y;
+    vx[i] = vel.x;
+    vy[i] = vel.y;
+    damage[i] = dmg;
+    owner[i] = ownerID;
+    team[i] = teamID;
+    spawnTime[i] = spawnedAt;
+    target[i] = targetID;
+    homing[i] = 1;
+    marked[i] = 0;
+
+    denseToSlot[i] = slot;
+    slotToDense[slot] = (uint32_t)i;
+    ownerCounts[ownerID]++;
+
+    return {slot, generations[slot]};
+}
+
+void ProjectilePool::Remove(int index) {
+    if (index < 0 || index >= count) return;
+
+    uint32_t slot = denseToSlot[index];
+    generations[slot]++; // Invalidates every handle to this projectile
+    freeSlots.push_back(slot);
+    ownerCounts[owner[index]]--;
+    if (marked[index]) markedCount--;
+
+    int last = --count;
+    if (index != last) {
+        x[index] = x[last];
+        y[index] = y[last];
+        vx[index] = vx[last];
+        vy[index] = vy[last];
+        damage[index] = damage[last];
+        owner[index] = owner[last];
+        team[index] = team[last];
+        prevX[index] = prevX[last];
+        prevY[index] = prevY[last];
+        spawnTime[index] = spawnTime[last];
+        target[index] = target[last];
+        homing[index] = homing[last];
+        marked[index] = marked[last];
+
+        denseToSlot[index] = denseToSlot[last];
+        slotToDense[denseToSlot[index]] = (uint32_t)index;
+    }
+}
+
+bool ProjectilePool::Remove(ProjectileHandle handle) {
+    int index = IndexOf(handle);
+    if (index < 0) return false;
+
+    Remove(index);
+    return true;
+}
+
+void ProjectilePool::Clear() {
+    while (count > 0) {
+        Remove(count - 1);
+    }
+}
+
+void ProjectilePool::MarkForRemoval(int index) {
+    if (!marked[index]) {
+        marked[index] = 1;
+        markedCount++;
+    }
+}
+
+bool ProjectilePool::IsMarked(int index) const {
+    return marked[index];
+}
+
+int ProjectilePool::RemoveMarked() {
+    int removed = 0;
+
+    // Backwards, so the element swapped into a hole has already been checked
+    for (int i = count - 1; i >= 0 && markedCount > 0; i--) {
+        if (marked[i]) {
+            Remove(i);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+void ProjectilePool::SavePrevious() {
+    for (int i = 0; i < count; i++) {
+        prevX[i] = x[i];
+        prevY[i] = y[i];
+    }
+}
+
+int ProjectilePool::IndexOf(ProjectileHandle handle) const {
+    if (handle.slot >= generations.size()) return -1;
+    if (generations[handle.slot] != handle.generation) return -1;
+
+    int index = (int)slotToDense[handle.slot];
+    if (index >= count || denseToSlot[index] != handle.slot) return -1;
+
+    return index;
+}
+
+ProjectileHandle ProjectilePool::HandleAt(int index) const {
+    uint32_t slot = denseToSlot[index];
+    return {slot, generations[slot]};
+}
+
+int ProjectilePool::Count() const {
+    return count;
+}
+
+int ProjectilePool::Capacity() const {
+    return (int)x.size();
+}
+
+int ProjectilePool::CountOwnedBy(uint16_t ownerID) const {
+    if (ownerID >= ownerCounts.size()) return 0;
+    return ownerCounts[ownerID];
+}
+
+void ProjectilePool::SaveState(ByteWriter& out) const {
+    out.Varint((uint64_t)count);
+    out.Array(x, count);
+    out.Array(y, count);
+    out.Array(vx, count);
+    out.Array(vy, count);
+    out.Array(damage, count);
+    out.Array(owner, count);
+    out.Array(team, count);
+    out.Array(spawnTime, count);
+    out.Array(target, count);
+    out.Array(homing, count);
+}
+
+bool ProjectilePool::LoadState(ByteReader& in) {
+    Clear();
+
+    uint64_t n = in.Varint();
+    if (n > (uint64_t)Capacity()) in.ok = false;
+    if (!in.ok) return false;
+
+    in.Array(x, n);
+    in.Array(y, n);
+    in.Array(vx, n);
+    in.Array(vy, n);
+    in.Array(damage, n);
+    in.Array(owner, n);
+    in.Array(team, n);
+    in.Array(spawnTime, n);
+    in.Array(target, n);
+    in.Array(homing, n);
+
+    // Homing projectiles look their target up among the world's ships
+    for (uint64_t i = 0; i < n && in.ok; i++) {
+        if (owner[i] >= ownerCounts.size()) in.ok = false;
+        if (homing[i] && target[i] >= ownerCounts.size()) in.ok = false;
+    }
+    if (!in.ok) return false;
+
+    for (int i = 0; i < (int)n; i++) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+
+        denseToSlot[i] = slot;
+        slotToDense[slot] = (uint32_t)i;
+        ownerCounts[owner[i]]++;
+        prevX[i] = x[i];
+        prevY[i] = y[i];
+        marked[i] = 0;
+    }
+    count = (int)n;
+    return true;
+}
+
+Projectiles::Projectiles(int maxShips)
+    : bullets(std::max(MAX_BULLETS, maxShips * BULLETS_PER_SHIP), maxShips),
+      energy(std::max(MAX_ENERGY_WEAPONS, maxShips * ENERGY_WEAPONS_PER_SHIP), maxShips),
+      bulletGrid(WIDTH, HEIGHT, GRID_CELL_SIZE, bullets.Capacity()),
+      energyGrid(WIDTH, HEIGHT, GRID_CELL_SIZE, energy.Capacity()) {}
+
+void Projectiles::Clear() {
+    bullets.Clear();
+    energy.Clear();
+    RebuildGrids();
+}
+
+void Projectiles::SavePrevious() {
+    bullets.SavePrevious();
+    energy.SavePrevious();
+}
+
+void Projectiles::SaveState(ByteWriter& out) const {
+    bullets.SaveState(out);
+    energy.SaveState(out);
+}
+
+bool Projectiles::LoadState(ByteReader& in) {
+    bool loaded = bullets.LoadState(in) && energy.LoadState(in);
+    RebuildGrids();
+    return loaded;
+}
+
+void Projectiles::RebuildGrids() {
+    RebuildBulletGrid();
+    RebuildEnergyGrid();
+}
+
+void Projectiles::RebuildBulletGrid() {
+    bulletGrid.Build(bullets.x.data(), bullets.y.data(), bullets.Count(),
+                     {bulletSize.x / 2, bulletSize.y / 2}, std::max(bulletSize.x, bulletSize.y) / 2);
+}
+
+void Projectiles::RebuildEnergyGrid() {
+    energyGrid.Build(energy.x.data(), energy.y.data(), energy.Count(), {0, 0}, energyRadius);
+}
+
+void Projectiles::RemoveMarked() {
+    int removed = bullets.RemoveMarked() + energy.RemoveMarked();
+    if (removed > 0) RebuildGrids();
+}
@@ -0,0 +1,70 @@
+#include "core/Random.hpp"
+
+static uint64_t SplitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t RotateLeft(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+Random::Random(uint64_t seed) {
+    Seed(seed);
+}
+
+// Expands the seed with splitmix64, which never gives xoshiro its all zero state
+void Random::Seed(uint64_t seed) {
+    for (uint64_t& word : state) {
+        word = SplitMix64(seed);
+    }
+}
+
+uint64_t Random::Next() {
+    uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = RotateLeft(state[3], 45);
+
+    return result;
+}
+
+int Random::Range(int min, int max) {
+    if (max < min) {
+        int tmp = min;
+        min = max;
+        max = tmp;
+    }
+
+    // Modulo bias is below 2^-32 for any span an int can hold
+    uint64_t span = (uint64_t)((int64_t)max - min) + 1;
+    return (int)((int64_t)min + (int64_t)(Next() % span));
+}
+
+float Random::Float() {
+    return (float)(Next() >> 40) * (1.0f / 16777216.0f);
+}
+
+void Random::SaveState(ByteWriter& out) const {
+    for (uint64_t word : state) {
+        out.U64(word);
+    }
+}
+
+void Random::LoadState(ByteReader& in) {
+    for (uint64_t& word : state) {
+        word = in.U64();
+    }
+}
+
+uint64_t Random::MixSeed(uint64_t a, uint64_t b) {
+    uint64_t mixed = a ^ (b * 0xD1B54A32D192ED03ull);
+    return SplitMix64(mixed);
+}
@@ -0,0 +1,27 @@
+#include "core/RaylibSinks.hpp"
+
+RaylibAudioSink::RaylibAudioSink(ResourceManager& resources) {
+    for (int i = 0; i < (int)SoundID::Count; i++) {
+        sounds[i] = resources.GetSound((SoundID)i);
+    }
+}
+
+void RaylibAudioSink::Play(SoundID id) {
+    PlaySound(sounds[(int)id]);
+}
+
+void RaylibRenderSink::DrawSprite(const Texture2D& texture, Rectangle src, Rectangle dest, Vector2 origin, float rotation, Color tint) {
+    DrawTexturePro(texture, src, dest, origin, rotation, tint);
+}
+
+void RaylibRenderSink::DrawRect(Rectangle rect, Color color) {
+    DrawRectangleRec(rect, color);
+}
+
+void RaylibRenderSink::DrawRectLines(Rectangle rect, float thickness, Color color) {
+    DrawRectangleLinesEx(rect, thickness, color);
+}
+
+void RaylibRenderSink::DrawCircle(Vector2 center, float radius, Color color) {
+    DrawCircleV(center, radius, color);
+}
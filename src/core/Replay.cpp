@@ -0,0 +1,510 @@
+#include "core/Replay.hpp"
+#include "core/Headless.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+static const uint32_t replayMagic = 0x50524253; // "SBRP"
+static const uint8_t replayVersion = 2;
+
+uint32_t PackControl(const ControlState& state) {
+    uint8_t x = (uint8_t)(int8_t)std::lround(QuantizeAxis(state.moveX) * 127.0f);
+    uint8_t y = (uint8_t)(int8_t)std::lround(QuantizeAxis(state.moveY) * 127.0f);
+    return (uint32_t)x | ((uint32_t)y << 8) | ((uint32_t)state.shootBullet << 16) | ((uint32_t)state.shootEnergy << 17);
+}
+
+ControlState UnpackControl(uint32_t packed) {
+    ControlState state;
+    state.moveX = (int8_t)(packed & 0xFF) / 127.0f;
+    state.moveY = (int8_t)((packed >> 8) & 0xFF) / 127.0f;
+    state.shootBullet = (packed >> 16) & 1;
+    state.shootEnergy = (packed >> 17) & 1;
+    return state;
+}
+
+// Axis codes in a run: full left, centre and full right cover most of what
+// the AI sends. Anything else is a small step from the previous value, as
+// when a player's input ramps up, or a whole byte.
+enum AxisCode : uint32_t {
+    AxisZero = 0,
+    AxisMax = 1,
+    AxisMin = 2,
+    AxisOther = 3
+};
+
+const int axisDeltaBits = 4;
+const int axisDeltaMin = -(1 << (axisDeltaBits - 1));
+const int axisDeltaMax = (1 << (axisDeltaBits - 1)) - 1;
+
+static void WriteAxis(BitWriter& out, uint8_t value, uint8_t previous) {
+    if (value == previous) {
+        out.Bit(false);
+        return;
+    }
+
+    out.Bit(true);
+    if (value == 0) out.Bits(AxisZero, 2);
+    else if (value == 127) out.Bits(AxisMax, 2);
+    else if (value == (uint8_t)-127) out.Bits(AxisMin, 2);
+    else {
+        out.Bits(AxisOther, 2);
+
+        int delta = (int8_t)value - (int8_t)previous;
+        bool small = delta >= axisDeltaMin && delta <= axisDeltaMax;
+        out.Bit(small);
+        if (small) out.Bits((uint32_t)(delta - axisDeltaMin), axisDeltaBits);
+        else out.Bits(value, 8);
+    }
+}
+
+static uint8_t ReadAxis(BitReader& in, uint8_t previous) {
+    if (!in.Bit()) return previous;
+
+    switch (in.Bits(2)) {
+        case AxisZero: return 0;
+        case AxisMax: return 127;
+        case AxisMin: return (uint8_t)-127;
+        default:
+            if (in.Bit()) return (uint8_t)((int8_t)previous + (int)in.Bits(axisDeltaBits) + axisDeltaMin);
+            return (uint8_t)in.Bits(8);
+    }
+}
+
+// One run: both fire buttons, each axis relative to the previous run, then
+// the length. Most runs are a tick or two long and change one thing, so
+// they fit in a byte.
+static void WriteRun(BitWriter& out, uint32_t control, uint32_t previous, int length) {
+    out.Bits(control >> 16, 2);
+    WriteAxis(out, (uint8_t)control, (uint8_t)previous);
+    WriteAxis(out, (uint8_t)(control >> 8), (uint8_t)(previous >> 8));
+    out.Gamma((uint32_t)length);
+}
+
+static uint32_t ReadRun(BitReader& in, uint32_t previous, uint32_t& length) {
+    uint32_t buttons = in.Bits(2);
+    uint32_t x = ReadAxis(in, (uint8_t)previous);
+    uint32_t y = ReadAxis(in, (uint8_t)(previous >> 8));
+    length = in.Gamma();
+    return x | (y << 8) | (buttons << 16);
+}
+
+ReplayRecorder::ReplayRecorder(const Match& match, int keyframeInterval) {
+    header.mode = match.GetMode();
+    header.shipsPerSide = match.GetShipsPerSide();
+    header.shipCount = (int)match.world.ships.size();
+    header.seed = match.GetSeed();
+    header.dt = match.GetClock().dt > 0.0f ? match.GetClock().dt : TICK_DT;
+    header.keyframeInterval = std::max(1, keyframeInterval);
+
+    runs.resize(header.shipCount);
+    StartBlock(match);
+}
+
+void ReplayRecorder::StartBlock(const Match& match) {
+    ByteWriter state;
+    match.SaveState(state);
+
+    blockKeyframe.tick = match.GetTick();
+    blockKeyframe.checksum = match.world.Checksum();
+    blockKeyframe.state = std::move(state.bytes);
+    blockTicks = 0;
+
+    for (auto& shipRuns : runs) {
+        shipRuns.clear();
+    }
+}
+
+void ReplayRecorder::Record(const Match& match) {
+    // Unknown until the match has stepped, if recording started before that
+    header.dt = match.GetClock().dt;
+
+    for (int i = 0; i < header.shipCount; i++) {
+        uint32_t control = PackControl(match.world.ships[i]->GetControlState());
+        std::vector<Run>& shipRuns = runs[i];
+
+        if (!shipRuns.empty() && shipRuns.back().control == control) shipRuns.back().length++;
+        else shipRuns.push_back({control, 1});
+    }
+    blockTicks++;
+
+    if (match.GetTick() % header.keyframeInterval == 0) {
+        EncodeBlock(finished);
+        StartBlock(match);
+    }
+}
+
+void ReplayRecorder::EncodeBlock(ByteWriter& out) const {
+    out.Varint((uint64_t)blockKeyframe.tick);
+    out.Varint((uint64_t)blockTicks);
+    out.U64(blockKeyframe.checksum);
+    out.Varint(blockKeyframe.state.size());
+    out.Bytes(blockKeyframe.state.data(), blockKeyframe.state.size());
+
+    BitWriter stream;
+    for (const std::vector<Run>& shipRuns : runs) {
+        stream.Clear();
+        uint32_t previous = 0;
+        for (const Run& run : shipRuns) {
+            WriteRun(stream, run.control, previous, run.length);
+            previous = run.control;
+        }
+
+        const std::vector<uint8_t>& bytes = stream.Flush();
+        out.Varint(bytes.size());
+        out.Bytes(bytes.data(), bytes.size());
+    }
+}
+
+std::vector<uint8_t> ReplayRecorder::Finish() const {
+    ByteWriter out;
+    out.U32(replayMagic);
+    out.U8(replayVersion);
+    out.U8((uint8_t)header.mode);
+    out.Varint((uint64_t)header.shipsPerSide);
+    out.Varint((uint64_t)header.shipCount);
+    out.U64(header.seed);
+    out.F32(header.dt);
+    out.Varint((uint64_t)header.keyframeInterval);
+
+    out.Bytes(finished.bytes.data(), finished.Size());
+    EncodeBlock(out);
+    return out.bytes;
+}
+
+bool ReplayRecorder::Save(const std::string& path) const {
+    return WriteFileBytes(path, Finish());
+}
+
+bool Replay::Load(const std::string& path) {
+    std::vector<uint8_t> bytes;
+    return ReadFileBytes(path, bytes) && Decode(bytes);
+}
+
+bool Replay::Decode(const std::vector<uint8_t>& bytes) {
+    ByteReader in(bytes);
+    keyframes.clear();
+    controls.clear();
+
+    if (in.U32() != replayMagic || in.U8() != replayVersion) return false;
+
+    uint8_t mode = in.U8();
+    if (mode > (uint8_t)GameMode::Arena) return false;
+    header.mode = (GameMode)mode;
+    header.shipsPerSide = (int)in.Varint();
+    header.shipCount = (int)in.Varint();
+    header.seed = in.U64();
+    header.dt = in.F32();
+    header.keyframeInterval = (int)in.Varint();
+
+    if (!in.ok || header.shipCount <= 0 || header.shipCount > 2 * 65535 || header.keyframeInterval <= 0 ||
+        header.keyframeInterval > REPLAY_MAX_KEYFRAME_INTERVAL || !(header.dt > 0.0f)) {
+        return false;
+    }
+    controls.resize(header.shipCount);
+
+    while (!in.AtEnd()) {
+        ReplayKeyframe keyframe;
+        keyframe.tick = (long)in.Varint();
+        uint64_t ticks = in.Varint();
+        keyframe.checksum = in.U64();
+
+        // Blocks follow on from each other without gaps, and the recorder
+        // cuts them at every keyframe
+        if (!keyframes.empty() && keyframe.tick != LastTick()) return false;
+        if (ticks > (uint64_t)header.keyframeInterval) return false;
+
+        uint64_t stateSize = in.Varint();
+        if (stateSize > in.Remaining()) return false;
+        const uint8_t* state = in.Skip(stateSize);
+        if (!state) return false;
+        keyframe.state.assign(state, state + stateSize);
+        keyframes.push_back(std::move(keyframe));
+
+        for (std::vector<uint32_t>& shipControls : controls) {
+            uint64_t streamSize = in.Varint();
+            if (streamSize > in.Remaining()) return false;
+            const uint8_t* streamData = in.Skip(streamSize);
+            if (!streamData) return false;
+
+            BitReader stream(streamData, streamSize);
+            uint64_t decoded = 0;
+            uint32_t previous = 0;
+            while (decoded < ticks) {
+                uint32_t length = 0;
+                uint32_t control = ReadRun(stream, previous, length);
+                if (!stream.ok || decoded + length > ticks) return false;
+
+                shipControls.insert(shipControls.end(), length, control);
+                decoded += length;
+                previous = control;
+            }
+        }
+    }
+
+    return in.ok && !keyframes.empty();
+}
+
+ControlState Replay::GetControl(int ship, long tick) const {
+    long index = tick - FirstTick() - 1;
+    if (ship < 0 || ship >= (int)controls.size() || index < 0 || index >= (long)controls[ship].size()) {
+        return ControlState{};
+    }
+    return UnpackControl(controls[ship][index]);
+}
+
+long Replay::FirstTick() const {
+    return keyframes.empty() ? 0 : keyframes.front().tick;
+}
+
+long Replay::LastTick() const {
+    return FirstTick() + (controls.empty() ? 0 : (long)controls[0].size());
+}
+
+ReplayController::ReplayController(const Replay& source, const Match& playback, int ship)
+    : replay(source), match(playback), shipId(ship) {}
+
+// Match::Step has already counted the tick being played when ships think
+ControlState ReplayController::GetState(const SimClock& clock) {
+    (void)clock;
+    return replay.GetControl(shipId, match.GetTick());
+}
+
+ReplayPlayer::ReplayPlayer(const Replay& source, const ShipAssets& yellowAssets, const ShipAssets& redAssets, IAudioSink& audio)
+    : replay(source) {
+    const ReplayHeader& header = replay.header;
+    match = std::make_unique<Match>(header.mode, yellowAssets, redAssets, audio, header.seed, header.shipsPerSide);
+    UseReplayControllers();
+
+    ByteReader in(replay.keyframes.front().state);
+    if (!match->LoadState(in)) mismatches++;
+}
+
+void ReplayPlayer::UseReplayControllers() {
+    for (auto& ship : match->world.ships) {
+        ship->controller = std::make_unique<ReplayController>(replay, *match, ship->id);
+    }
+}
+
+void ReplayPlayer::Step() {
+    if (IsFinished()) return;
+
+    match->Step(replay.header.dt);
+
+    long tick = match->GetTick();
+    if (tick % replay.header.keyframeInterval != 0) return;
+
+    auto keyframe = std::lower_bound(replay.keyframes.begin(), replay.keyframes.end(), tick,
+        [](const ReplayKeyframe& candidate, long value) { return candidate.tick < value; });
+    if (keyframe != replay.keyframes.end() && keyframe->tick == tick && keyframe->checksum != match->world.Checksum()) {
+        mismatches++;
+    }
+}
+
+bool ReplayPlayer::Seek(long tick) {
+    if (tick < replay.FirstTick() || tick > replay.LastTick()) return false;
+
+    // Last keyframe at or before tick. Playing on from the current tick is
+    // cheaper when it already lies between the two
+    auto keyframe = std::upper_bound(replay.keyframes.begin(), replay.keyframes.end(), tick,
+        [](long value, const ReplayKeyframe& candidate) { return value < candidate.tick; }) - 1;
+
+    if (match->GetTick() > tick || match->GetTick() < keyframe->tick) {
+        ByteReader in(keyframe->state);
+        if (!match->LoadState(in)) return false;
+    }
+
+    while (match->GetTick() < tick && !match->IsOver()) {
+        match->Step(replay.header.dt);
+    }
+    return match->GetTick() == tick;
+}
+
+bool ReplayPlayer::IsFinished() const {
+    return match->IsOver() || match->GetTick() >= replay.LastTick();
+}
+
+Match& ReplayPlayer::GetMatch() {
+    return *match;
+}
+
+int ReplayPlayer::Mismatches() const {
+    return mismatches;
+}
+
+// Plays a replay back, checking it against its keyframes, and reports how
+// big it is and how long seeking takes
+static int RunReplay(const std::string& path, long seekTick) {
+    std::vector<uint8_t> bytes;
+    Replay replay;
+    if (!ReadFileBytes(path, bytes) || !replay.Decode(bytes)) {
+        std::printf("could not read replay %s\n", path.c_str());
+        return 1;
+    }
+
+    const ReplayHeader& header = replay.header;
+    double minutes = (replay.LastTick() - replay.FirstTick()) * header.dt / 60.0;
+    std::printf("replay %s: %d ships, seed %llu, ticks %ld-%ld, %zu keyframes\n",
+        path.c_str(), header.shipCount, (unsigned long long)header.seed, replay.FirstTick(), replay.LastTick(), replay.keyframes.size());
+    std::printf("%zu bytes, %.1f KB per minute\n", bytes.size(), minutes > 0.0 ? bytes.size() / 1024.0 / minutes : 0.0);
+
+    NullAudioSink audio;
+    ReplayPlayer player(replay, LoadHeadlessShipAssets(Side::LEFT), LoadHeadlessShipAssets(Side::RIGHT), audio);
+
+    if (seekTick >= 0) {
+        auto start = std::chrono::steady_clock::now();
+        bool found = player.Seek(seekTick);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (!found) {
+            std::printf("tick %ld is not in the replay\n", seekTick);
+            return 1;
+        }
+        std::printf("seek to tick %ld in %.2f ms, checksum %016llx\n",
+            seekTick, ms, (unsigned long long)player.GetMatch().world.Checksum());
+    }
+
+    while (!player.IsFinished()) {
+        player.Step();
+    }
+
+    Match& match = player.GetMatch();
+    std::printf("played to tick %ld: %s, %d keyframe mismatches\n",
+        match.GetTick(), WinnerName(match.GetWinner()), player.Mismatches());
+    return player.Mismatches() == 0 ? 0 : 1;
+}
+
+static void PrintReplayUsage() {
+    std::printf("usage: main --headless --replay FILE [--seek TICK]\n");
+}
+
+int RunReplayCommand(int argc, char** argv) {
+    std::string path;
+    long seekTick = -1;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--replay" && hasValue) path = argv[++i];
+        else if (arg == "--seek" && hasValue) seekTick = std::atol(argv[++i]);
+        else {
+            PrintReplayUsage();
+            return 1;
+        }
+    }
+
+    if (path.empty()) {
+        PrintReplayUsage();
+        return 1;
+    }
+
+    return RunReplay(path, seekTick);
+}
+
+// One block of a single tick laid out as ReplayRecorder writes it, but
+// with the tick count given and the keyframe and control stream claiming
+// extra bytes the file does not have
+static std::vector<uint8_t> CraftReplay(int keyframeInterval, uint64_t ticks, uint64_t extraState, uint64_t extraStream) {
+    ByteWriter out;
+    out.U32(replayMagic);
+    out.U8(replayVersion);
+    out.U8((uint8_t)GameMode::NoPlayer);
+    out.Varint(1);
+    out.Varint(2);
+    out.U64(1);
+    out.F32(TICK_DT);
+    out.Varint((uint64_t)keyframeInterval);
+
+    std::vector<uint8_t> state(16);
+    out.Varint(0);
+    out.Varint(ticks);
+    out.U64(0);
+    out.Varint(state.size() + extraState);
+    out.Bytes(state.data(), state.size());
+
+    BitWriter stream;
+    WriteRun(stream, 0, 0, 1);
+    const std::vector<uint8_t>& bytes = stream.Flush();
+    for (int ship = 0; ship < 2; ship++) {
+        out.Varint(bytes.size() + extraStream);
+        out.Bytes(bytes.data(), bytes.size());
+    }
+    return out.bytes;
+}
+
+// Feeds Decode and ReplayPlayer files broken the ways their bounds checks
+// cover, and checks each is refused without reading or allocating past
+// what the file holds
+static int RunReplayTest() {
+    int failures = 0;
+    auto Check = [&failures](const char* name, bool passed) {
+        std::printf("%-44s %s\n", name, passed ? "ok" : "FAILED");
+        if (!passed) failures++;
+    };
+
+    // Each differs from the first in one field
+    Replay replay;
+    Check("crafted block", replay.Decode(CraftReplay(REPLAY_KEYFRAME_INTERVAL, 1, 0, 0)));
+    Check("block longer than the keyframe interval", !replay.Decode(CraftReplay(REPLAY_KEYFRAME_INTERVAL, 1ull << 40, 0, 0)));
+    Check("keyframe interval over the maximum", !replay.Decode(CraftReplay(REPLAY_MAX_KEYFRAME_INTERVAL + 1, 1, 0, 0)));
+    Check("keyframe larger than the file", !replay.Decode(CraftReplay(REPLAY_KEYFRAME_INTERVAL, 1, 1ull << 40, 0)));
+    Check("control stream larger than the file", !replay.Decode(CraftReplay(REPLAY_KEYFRAME_INTERVAL, 1, 0, 1ull << 40)));
+
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+    NullAudioSink audio;
+
+    // A real recording, to show the checks let one through
+    Match match(GameMode::NoPlayer, yellowAssets, redAssets, audio, 1);
+    ReplayRecorder recorder(match);
+    for (int i = 0; i < TICK_RATE; i++) {
+        match.Step(TICK_DT);
+        recorder.Record(match);
+    }
+    bool decoded = replay.Decode(recorder.Finish());
+    bool played = false;
+    if (decoded) {
+        ReplayPlayer player(replay, yellowAssets, redAssets, audio);
+        while (!player.IsFinished()) player.Step();
+        played = player.Mismatches() == 0 && player.GetMatch().GetTick() == TICK_RATE;
+    }
+    Check("recorded match", decoded && played);
+
+    // A keyframe with energy homing in on a ship past the end of the world
+    Match homing(GameMode::NoPlayer, yellowAssets, redAssets, audio, 1);
+    homing.world.projectiles.energy.Spawn({100.0f, 100.0f}, {100.0f, 0.0f}, 1.0f, 0, 0, 0.0f, (uint16_t)homing.world.ships.size());
+    decoded = replay.Decode(ReplayRecorder(homing).Finish());
+    bool refused = false;
+    if (decoded) {
+        ReplayPlayer player(replay, yellowAssets, redAssets, audio);
+        refused = player.Mismatches() == 1 && player.GetMatch().world.projectiles.energy.Count() == 0;
+    }
+    Check("keyframe with an energy target out of range", decoded && refused);
+
+    // A keyframe whose winner is none of Winner's values. At tick 0 the
+    // tick is one varint byte, after the clock's time and dt
+    Match fresh(GameMode::NoPlayer, yellowAssets, redAssets, audio, 1);
+    decoded = replay.Decode(ReplayRecorder(fresh).Finish());
+    refused = false;
+    if (decoded) {
+        replay.keyframes.front().state[sizeof(double) + sizeof(float) + 1] = (uint8_t)Winner::Yellow + 1;
+        ReplayPlayer player(replay, yellowAssets, redAssets, audio);
+        refused = player.Mismatches() == 1 && player.GetMatch().GetWinner() == Winner::None;
+    }
+    Check("keyframe with an unknown winner", decoded && refused);
+
+    return failures == 0 ? 0 : 1;
+}
+
+int RunReplayTestCommand(int argc, char** argv) {
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) != "--replay-test") {
+            std::printf("usage: main --headless --replay-test\n");
+            return 1;
+        }
+    }
+
+    return RunReplayTest();
+}
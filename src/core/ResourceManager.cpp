@@ -1,46 +1,228 @@
 #include "core/ResourceManager.hpp"
 #include "core/config.h"
+#include <algorithm>
+#include <cmath>
 
-void ResourceManager::loadTexture(const std::string& name, const std::string& filepath) {
-    if (textures.count(name) == 0) {
-        textures[name] = LoadTexture(filepath.c_str());
+ResourceManager::ResourceManager() {
+    // In enum order, so each ID is its own handle
+    for (const char* name : {"background", "redShip", "yellowShip", "energyLeftFacing", "energyRightFacing"}) {
+        GetTextureHandle(name);
     }
+    for (const char* name : {"shoot", "hit", "energyShoot"}) {
+        GetSoundHandle(name);
+    }
+}
+
+TextureHandle ResourceManager::GetTextureHandle(const std::string& name) {
+    auto it = textureNames.find(name);
+    if (it != textureNames.end()) return TextureHandle(it->second);
+
+    uint16_t index = (uint16_t)textureSlots.size();
+    textureSlots.emplace_back();
+    textureNames[name] = index;
+    return TextureHandle(index);
+}
+
+SoundHandle ResourceManager::GetSoundHandle(const std::string& name) {
+    auto it = soundNames.find(name);
+    if (it != soundNames.end()) return SoundHandle(it->second);
+
+    uint16_t index = (uint16_t)soundSlots.size();
+    soundSlots.emplace_back();
+    soundNames[name] = index;
+    return SoundHandle(index);
 }
 
-Texture2D& ResourceManager::GetTexture(const std::string& name) {
-    if (textures.count(name) == 0) {
-        throw std::runtime_error("Texture not loaded: " + name);
+bool ResourceManager::OpenArchive(const std::string& filepath) {
+    return archive.Open(filepath);
+}
+
+void ResourceManager::CloseArchive() {
+    archive.Close();
+}
+
+const AssetArchive& ResourceManager::GetArchive() const {
+    return archive;
+}
+
+ResourceManager::DecodedTexture ResourceManager::DecodeTexture(const std::string& filepath, float drawScale) const {
+    DecodedTexture decoded;
+    decoded.key = filepath;
+    Image packed;
+    bool inArchive = archive.FindImage(filepath, packed);
+
+    if (drawScale <= 0.0f) {
+        decoded.image = inArchive ? packed : LoadImage(filepath.c_str());
+        decoded.owned = !inArchive;
+        decoded.imageSize = {(float)decoded.image.width, (float)decoded.image.height};
+        return decoded;
     }
 
-    return textures[name];
+    // Copied out of the archive, as resizing frees what it is given
+    decoded.image = inArchive ? ImageCopy(packed) : LoadImage(filepath.c_str());
+    decoded.owned = true;
+    if (!decoded.image.data) return decoded;
+
+    // Never smaller than the sprite covers, so it is sampled at most one
+    // texel per pixel
+    Image& image = decoded.image;
+    decoded.imageSize = {(float)image.width, (float)image.height};
+    int width = std::max(1, (int)std::ceil(decoded.imageSize.x * drawScale));
+    int height = std::max(1, (int)std::ceil(decoded.imageSize.y * drawScale));
+    decoded.key = filepath + "@" + std::to_string(width) + "x" + std::to_string(height);
+
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    if (width < image.width || height < image.height) ImageResize(&image, width, height);
+    ImageMipmaps(&image);
+    return decoded;
+}
+
+ResourceManager::DecodedSound ResourceManager::DecodeSound(const std::string& filepath) const {
+    DecodedSound decoded;
+    decoded.key = filepath;
+    decoded.owned = !archive.FindWave(filepath, decoded.wave);
+    if (decoded.owned) decoded.wave = LoadWave(filepath.c_str());
+    return decoded;
 }
 
-void ResourceManager::loadSound(const std::string& name, const std::string& filepath) {
-    if (sounds.count(name) == 0) {
-        sounds[name] = LoadSound(filepath.c_str());
+int ResourceManager::FindEntry(const std::unordered_map<std::string, int>& keys, const std::string& key) {
+    auto it = keys.find(key);
+    return it == keys.end() ? -1 : it->second;
+}
+
+void ResourceManager::AddTexture(TextureHandle handle, DecodedTexture& decoded) {
+    TextureSlot& slot = textureSlots.at(handle.index);
+
+    if (slot.entry < 0) {
+        int entry = FindEntry(textureKeys, decoded.key);
+        if (entry < 0) {
+            // Reusing an entry freed by a release, if there is one
+            auto unused = std::find_if(textureCache.begin(), textureCache.end(),
+                [](const CacheEntry<Texture2D>& cached) { return cached.refs == 0; });
+            entry = (int)(unused - textureCache.begin());
+            if (unused == textureCache.end()) textureCache.emplace_back();
+
+            // A file that failed to load is cached too, as an empty texture
+            CacheEntry<Texture2D>& cached = textureCache[entry];
+            cached.key = decoded.key;
+            cached.resource = {};
+            if (decoded.image.data) {
+                cached.resource = LoadTextureFromImage(decoded.image);
+                if (decoded.image.mipmaps > 1) SetTextureFilter(cached.resource, TEXTURE_FILTER_TRILINEAR);
+            }
+            textureKeys[cached.key] = entry;
+        }
+
+        textureCache[entry].refs++;
+        slot.entry = entry;
+        slot.texture = textureCache[entry].resource;
+        slot.imageSize = decoded.imageSize;
     }
+
+    if (decoded.owned && decoded.image.data) UnloadImage(decoded.image);
+    decoded.image = {};
 }
 
-Sound& ResourceManager::GetSound(const std::string& name) {
-    if (sounds.count(name) == 0) {
-        throw std::runtime_error("Sound not loaded: " + name);
+void ResourceManager::AddSound(SoundHandle handle, DecodedSound& decoded) {
+    SoundSlot& slot = soundSlots.at(handle.index);
+
+    if (slot.entry < 0) {
+        int entry = FindEntry(soundKeys, decoded.key);
+        if (entry < 0) {
+            auto unused = std::find_if(soundCache.begin(), soundCache.end(),
+                [](const CacheEntry<Sound>& cached) { return cached.refs == 0; });
+            entry = (int)(unused - soundCache.begin());
+            if (unused == soundCache.end()) soundCache.emplace_back();
+
+            CacheEntry<Sound>& cached = soundCache[entry];
+            cached.key = decoded.key;
+            cached.resource = decoded.wave.data ? LoadSoundFromWave(decoded.wave) : Sound{};
+            soundKeys[cached.key] = entry;
+        }
+
+        soundCache[entry].refs++;
+        slot.entry = entry;
+        slot.sound = soundCache[entry].resource;
     }
 
-    return sounds[name];
+    if (decoded.owned && decoded.wave.data) UnloadWave(decoded.wave);
+    decoded.wave = {};
 }
 
-void ResourceManager::UnloadAll() {
-    for (auto& [name, text] : textures) {
-        UnloadTexture(text);
+void ResourceManager::loadTexture(TextureHandle handle, const std::string& filepath) {
+    loadTexture(handle, filepath, 0.0f);
+}
+
+void ResourceManager::loadTexture(TextureHandle handle, const std::string& filepath, float drawScale) {
+    if (IsLoaded(handle)) return;
+
+    DecodedTexture decoded = DecodeTexture(filepath, drawScale);
+    AddTexture(handle, decoded);
+}
+
+bool ResourceManager::IsLoaded(TextureHandle handle) const {
+    return handle.index < textureSlots.size() && textureSlots[handle.index].entry >= 0;
+}
+
+const Texture2D& ResourceManager::GetTexture(TextureHandle handle) const {
+    static const Texture2D none = {};
+    return handle.index < textureSlots.size() ? textureSlots[handle.index].texture : none;
+}
+
+Vector2 ResourceManager::GetImageSize(TextureHandle handle) const {
+    return handle.index < textureSlots.size() ? textureSlots[handle.index].imageSize : Vector2{0.0f, 0.0f};
+}
+
+void ResourceManager::ReleaseTexture(TextureHandle handle) {
+    if (!IsLoaded(handle)) return;
+
+    TextureSlot& slot = textureSlots[handle.index];
+    CacheEntry<Texture2D>& cached = textureCache[slot.entry];
+    if (--cached.refs == 0) {
+        if (cached.resource.id != 0) UnloadTexture(cached.resource);
+        textureKeys.erase(cached.key);
+        cached = {};
     }
+    slot = {};
+}
+
+void ResourceManager::loadSound(SoundHandle handle, const std::string& filepath) {
+    if (IsLoaded(handle)) return;
+
+    DecodedSound decoded = DecodeSound(filepath);
+    AddSound(handle, decoded);
+}
 
-    textures.clear();
+bool ResourceManager::IsLoaded(SoundHandle handle) const {
+    return handle.index < soundSlots.size() && soundSlots[handle.index].entry >= 0;
+}
+
+const Sound& ResourceManager::GetSound(SoundHandle handle) const {
+    static const Sound none = {};
+    return handle.index < soundSlots.size() ? soundSlots[handle.index].sound : none;
+}
 
-    for (auto& [name, snd] : sounds) {
-        UnloadSound(snd);
+void ResourceManager::ReleaseSound(SoundHandle handle) {
+    if (!IsLoaded(handle)) return;
+
+    SoundSlot& slot = soundSlots[handle.index];
+    CacheEntry<Sound>& cached = soundCache[slot.entry];
+    if (--cached.refs == 0) {
+        if (cached.resource.frameCount != 0) UnloadSound(cached.resource);
+        soundKeys.erase(cached.key);
+        cached = {};
+    }
+    slot = {};
+}
+
+void ResourceManager::UnloadAll() {
+    for (size_t i = 0; i < textureSlots.size(); i++) {
+        ReleaseTexture(TextureHandle((uint16_t)i));
     }
 
-    sounds.clear();
+    for (size_t i = 0; i < soundSlots.size(); i++) {
+        ReleaseSound(SoundHandle((uint16_t)i));
+    }
 }
 
 ResourceManager::~ResourceManager() {
@@ -0,0 +1,558 @@
+#include "core/Rollback.hpp"
+#include "core/Headless.hpp"
+#include "core/Replay.hpp"
+#include "core/config.h"
+#include "controllers/AIController.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+// Every packet starts with the magic and a type
+static const uint16_t NET_MAGIC = 0x5342;
+static const size_t MAX_PACKET_SIZE = 1400;
+static const int MAX_INPUTS_PER_PACKET = 64;
+static const int HELLO_INTERVAL = 10;     // Polls between a joiner's hellos
+static const int WAIT_INTERVAL = 10;      // Ticks between time sync waits
+
+enum class NetPacket : uint8_t {
+    Hello = 1,    // Joiner to host, until welcomed
+    Welcome,      // Host to joiner: match seed
+    Inputs        // Both ways, every tick
+};
+
+static void BeginPacket(ByteWriter& out, NetPacket type) {
+    out.Clear();
+    out.U16(NET_MAGIC);
+    out.U8((uint8_t)type);
+}
+
+static bool ReadHeader(ByteReader& in, NetPacket& type) {
+    uint16_t magic = in.U16();
+    type = (NetPacket)in.U8();
+    return in.ok && magic == NET_MAGIC;
+}
+
+bool NetLobby::Host(uint16_t port, uint64_t matchSeed) {
+    host = true;
+    connected = false;
+    seed = matchSeed;
+    return socket.Open(port);
+}
+
+bool NetLobby::Join(const NetAddress& hostAddress) {
+    host = false;
+    connected = false;
+    peer = hostAddress;
+    pollsSinceHello = HELLO_INTERVAL;
+    return socket.Open(0);
+}
+
+bool NetLobby::Poll() {
+    if (connected) return true;
+
+    uint8_t buffer[MAX_PACKET_SIZE];
+    ByteWriter out;
+    NetAddress from;
+    int size;
+
+    while ((size = socket.Receive(from, buffer, sizeof(buffer))) >= 0) {
+        ByteReader in(buffer, (size_t)size);
+        NetPacket type;
+        if (!ReadHeader(in, type)) continue;
+
+        if (host && type == NetPacket::Hello) {
+            peer = from;
+            connected = true;
+            BeginPacket(out, NetPacket::Welcome);
+            out.U64(seed);
+            socket.Send(peer, out.bytes.data(), out.Size());
+        }
+        else if (!host && type == NetPacket::Welcome && from == peer) {
+            seed = in.U64();
+            connected = in.ok;
+        }
+    }
+
+    if (!host && !connected && ++pollsSinceHello >= HELLO_INTERVAL) {
+        pollsSinceHello = 0;
+        BeginPacket(out, NetPacket::Hello);
+        socket.Send(peer, out.bytes.data(), out.Size());
+    }
+
+    return connected;
+}
+
+bool NetLobby::IsConnected() const {
+    return connected;
+}
+
+bool NetLobby::IsHost() const {
+    return host;
+}
+
+uint64_t NetLobby::GetSeed() const {
+    return seed;
+}
+
+int NetLobby::LocalShip() const {
+    return host ? 1 : 0;
+}
+
+const NetAddress& NetLobby::GetPeer() const {
+    return peer;
+}
+
+UdpSocket& NetLobby::GetSocket() {
+    return socket;
+}
+
+RollbackSession::RollbackSession(Match& netMatch, NetLobby& netLobby, IController& input, GatedAudioSink* audioGate)
+    : match(netMatch), lobby(netLobby), localInput(input), audio(audioGate),
+      localShip(netLobby.LocalShip()), remoteShip(1 - netLobby.LocalShip()) {
+
+    for (auto& ship : match.world.ships) {
+        ship->controller = std::make_unique<NetInputController>(*this, match, ship->id);
+    }
+
+    // Tick 0 has no input, it is the state before the first tick
+    inputs[0].push_back(0);
+    inputs[1].push_back(0);
+
+    snapshots[0].tick = 0;
+    match.SaveState(snapshots[0].state);
+    snapshots[0].checksum = match.world.Checksum();
+
+    receiveBuffer.resize(MAX_PACKET_SIZE);
+}
+
+bool RollbackSession::Advance() {
+    Receive();
+    Rollback();
+
+    if (tick - remoteConfirmed >= MAX_ROLLBACK_TICKS) {
+        stats.stalls++;
+        SendInputs();
+        return false;
+    }
+
+    SimClock sampleClock;
+    sampleClock.Advance(TICK_DT);
+    sampleClock.time = (tick + 1) * (double)TICK_DT;
+    inputs[localShip].push_back(PackControl(localInput.GetState(sampleClock)));
+    if ((long)inputs[remoteShip].size() <= tick + 1) inputs[remoteShip].push_back(Prediction());
+
+    tick++;
+    SimulateTick();
+    SendInputs();
+    CheckDesync();
+    return true;
+}
+
+void RollbackSession::Poll() {
+    Receive();
+    Rollback();
+    SendInputs();
+    CheckDesync();
+}
+
+bool RollbackSession::ShouldWait() {
+    int localAdvantage = (int)(tick - remoteTick);
+    if ((localAdvantage - remoteAdvantage) / 2 < 1 || tick - lastWaitTick < WAIT_INTERVAL) return false;
+
+    lastWaitTick = tick;
+    return true;
+}
+
+// Remote ships are assumed to keep moving the way they last did. Fire
+// buttons are assumed released: a shot that shows up a few ticks late looks
+// better than one that appears and then vanishes on rollback
+uint32_t RollbackSession::Prediction() const {
+    return inputs[remoteShip][remoteConfirmed] & 0xFFFF;
+}
+
+ControlState RollbackSession::GetInput(int ship, long inputTick) const {
+    const std::vector<uint32_t>& shipInputs = inputs[ship];
+    if (inputTick < 0 || inputTick >= (long)shipInputs.size()) return UnpackControl(0);
+    return UnpackControl(shipInputs[inputTick]);
+}
+
+void RollbackSession::Receive() {
+    polls++;
+
+    // Release held packets that are due, or drop them
+    while (!delayed.empty() && delayed.front().due <= polls) {
+        lobby.GetSocket().Send(lobby.GetPeer(), delayed.front().bytes.data(), delayed.front().bytes.size());
+        delayed.pop_front();
+    }
+
+    NetAddress from;
+    int size;
+    while ((size = lobby.GetSocket().Receive(from, receiveBuffer.data(), receiveBuffer.size())) >= 0) {
+        if (from != lobby.GetPeer()) continue;
+
+        ByteReader in(receiveBuffer.data(), (size_t)size);
+        NetPacket type;
+        if (!ReadHeader(in, type)) continue;
+        stats.packetsReceived++;
+
+        // The welcome got lost and the joiner is still asking
+        if (type == NetPacket::Hello && lobby.IsHost()) {
+            BeginPacket(packet, NetPacket::Welcome);
+            packet.U64(lobby.GetSeed());
+            SendPacket(packet);
+        }
+        else if (type == NetPacket::Inputs) {
+            ReadInputs(in);
+        }
+    }
+}
+
+// Inputs packet: sender tick, sender's lead over us, the last of our inputs
+// it has, a run of its inputs starting just past what we acked, and the
+// checksum of its latest confirmed tick
+void RollbackSession::ReadInputs(ByteReader& in) {
+    long senderTick = (long)in.Varint();
+    int advantage = (int)in.SignedVarint();
+    long ack = (long)in.Varint();
+    long first = (long)in.Varint();
+    long count = (long)in.Varint();
+    if (!in.ok || count > MAX_INPUTS_PER_PACKET) return;
+
+    // Packets can arrive out of order, so only ever move forward
+    if (senderTick > remoteTick) {
+        remoteTick = senderTick;
+        remoteAdvantage = advantage;
+    }
+    remoteAck = std::max(remoteAck, ack);
+
+    std::vector<uint32_t>& remote = inputs[remoteShip];
+    for (long t = first; t < first + count; t++) {
+        uint32_t control = (uint32_t)in.Varint();
+        if (!in.ok) return;
+        if (t <= remoteConfirmed) continue;
+        if (t > remoteConfirmed + 1) break;
+
+        if (t < (long)remote.size()) {
+            if (remote[t] != control && t <= tick && (firstMispredicted == 0 || t < firstMispredicted)) {
+                firstMispredicted = t;
+            }
+            remote[t] = control;
+        }
+        else {
+            remote.push_back(control);
+        }
+        remoteConfirmed = t;
+    }
+
+    // Predictions past the new confirmed input now start from it
+    uint32_t prediction = Prediction();
+    for (long t = remoteConfirmed + 1; t < (long)remote.size(); t++) {
+        if (remote[t] != prediction && (firstMispredicted == 0 || t < firstMispredicted)) {
+            firstMispredicted = t;
+        }
+        remote[t] = prediction;
+    }
+
+    long checksumTick = (long)in.Varint();
+    uint64_t checksum = in.U64();
+    if (in.ok && checksumTick > remoteChecksumTick) {
+        remoteChecksumTick = checksumTick;
+        remoteChecksum = checksum;
+    }
+}
+
+// Goes back to the end of the last correctly predicted tick and plays
+// forward again with the inputs as they are now
+void RollbackSession::Rollback() {
+    if (firstMispredicted == 0) return;
+
+    long from = firstMispredicted - 1;
+    firstMispredicted = 0;
+
+    Snapshot& snapshot = snapshots[from % snapshots.size()];
+    if (snapshot.tick != from) return; // Can't happen while Advance stalls in time
+
+    ByteReader in(snapshot.state.bytes);
+    match.LoadState(in);
+
+    long target = tick;
+    tick = from;
+
+    if (audio) audio->muted = true;
+    while (tick < target) {
+        tick++;
+        SimulateTick();
+    }
+    if (audio) audio->muted = false;
+
+    stats.rollbacks++;
+    stats.resimulatedTicks += target - from;
+    stats.longestRollback = std::max(stats.longestRollback, (int)(target - from));
+}
+
+// Plays tick, which the controllers read from match.GetTick(), and keeps a
+// snapshot of where it ends
+void RollbackSession::SimulateTick() {
+    match.Step(TICK_DT);
+
+    Snapshot& snapshot = snapshots[tick % snapshots.size()];
+    snapshot.tick = tick;
+    snapshot.state.Clear();
+    match.SaveState(snapshot.state);
+    snapshot.checksum = match.world.Checksum();
+}
+
+void RollbackSession::SendInputs() {
+    long first = remoteAck + 1;
+    long count = std::min<long>(tick - remoteAck, MAX_INPUTS_PER_PACKET);
+
+    BeginPacket(packet, NetPacket::Inputs);
+    packet.Varint((uint64_t)tick);
+    packet.SignedVarint(tick - remoteTick);
+    packet.Varint((uint64_t)remoteConfirmed);
+    packet.Varint((uint64_t)first);
+    packet.Varint((uint64_t)std::max<long>(count, 0));
+    for (long t = first; t < first + count; t++) {
+        packet.Varint(inputs[localShip][t]);
+    }
+
+    long confirmed = GetConfirmedTick();
+    const Snapshot& snapshot = snapshots[confirmed % snapshots.size()];
+    bool known = snapshot.tick == confirmed;
+    packet.Varint(known ? (uint64_t)confirmed : 0);
+    packet.U64(known ? snapshot.checksum : 0);
+
+    SendPacket(packet);
+}
+
+void RollbackSession::SendPacket(const ByteWriter& out) {
+    stats.packetsSent++;
+
+    if (conditions.loss > 0.0f && lossRandom.Float() < conditions.loss) return;
+
+    if (conditions.delayPolls > 0) {
+        delayed.push_back({polls + conditions.delayPolls, out.bytes});
+        return;
+    }
+    lobby.GetSocket().Send(lobby.GetPeer(), out.bytes.data(), out.Size());
+}
+
+// Both sides must agree on any tick whose inputs they both have
+void RollbackSession::CheckDesync() {
+    if (remoteChecksumTick == 0 || remoteChecksumTick > GetConfirmedTick()) return;
+
+    const Snapshot& snapshot = snapshots[remoteChecksumTick % snapshots.size()];
+    if (snapshot.tick == remoteChecksumTick && snapshot.checksum != remoteChecksum) desynced = true;
+    remoteChecksumTick = 0;
+}
+
+long RollbackSession::GetTick() const {
+    return tick;
+}
+
+long RollbackSession::GetConfirmedTick() const {
+    return std::min(tick, remoteConfirmed);
+}
+
+bool RollbackSession::IsConfirmedOver() const {
+    return match.IsOver() && match.GetTick() <= GetConfirmedTick();
+}
+
+bool RollbackSession::IsDesynced() const {
+    return desynced;
+}
+
+const RollbackStats& RollbackSession::GetStats() const {
+    return stats;
+}
+
+void RollbackSession::SetConditions(const NetConditions& netConditions, uint64_t seed) {
+    conditions = netConditions;
+    lossRandom.Seed(seed);
+}
+
+NetInputController::NetInputController(const RollbackSession& netSession, const Match& netMatch, int id)
+    : session(netSession), match(netMatch), shipId(id) {}
+
+ControlState NetInputController::GetState(const SimClock& clock) {
+    (void)clock;
+    return session.GetInput(shipId, match.GetTick());
+}
+
+// Plays a rollback match between two sessions in this process, talking over
+// localhost UDP, each with an AI on its own ship. Passes if both end on the
+// same world once every input has arrived
+static int RunNetplayTest(long ticks, const NetConditions& conditions, uint64_t seed) {
+    NetLobby host, joiner;
+    NetAddress hostAddress;
+    if (!host.Host(0, seed) || !NetAddress::Parse("127.0.0.1", host.GetSocket().LocalPort(), hostAddress) || !joiner.Join(hostAddress)) {
+        std::printf("could not open a localhost socket\n");
+        return 1;
+    }
+
+    for (int i = 0; i < 1000 && !(host.IsConnected() && joiner.IsConnected()); i++) {
+        host.Poll();
+        joiner.Poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!host.IsConnected() || !joiner.IsConnected()) {
+        std::printf("peers did not connect\n");
+        return 1;
+    }
+
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+    NullAudioSink audio;
+    Match hostMatch(GameMode::TwoPlayer, yellowAssets, redAssets, audio, host.GetSeed());
+    Match joinerMatch(GameMode::TwoPlayer, yellowAssets, redAssets, audio, joiner.GetSeed());
+
+    AIController hostAI(hostMatch.yellowShip, hostMatch.redShip, Random::MixSeed(seed, 1));
+    AIController joinerAI(joinerMatch.redShip, joinerMatch.yellowShip, Random::MixSeed(seed, 2));
+
+    RollbackSession hostSession(hostMatch, host, hostAI);
+    RollbackSession joinerSession(joinerMatch, joiner, joinerAI);
+    hostSession.SetConditions(conditions, Random::MixSeed(seed, 3));
+    joinerSession.SetConditions(conditions, Random::MixSeed(seed, 4));
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (hostSession.GetTick() < ticks || joinerSession.GetTick() < ticks) {
+        if (hostSession.GetTick() < ticks) hostSession.Advance();
+        else hostSession.Poll();
+
+        if (joinerSession.GetTick() < ticks) joinerSession.Advance();
+        else joinerSession.Poll();
+    }
+
+    // Keep talking until the last inputs get through the loss
+    for (int i = 0; i < 100000 && (hostSession.GetConfirmedTick() < ticks || joinerSession.GetConfirmedTick() < ticks); i++) {
+        hostSession.Poll();
+        joinerSession.Poll();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t hostChecksum = hostMatch.world.Checksum();
+    uint64_t joinerChecksum = joinerMatch.world.Checksum();
+    bool passed = hostChecksum == joinerChecksum && !hostSession.IsDesynced() && !joinerSession.IsDesynced() &&
+                  hostSession.GetConfirmedTick() == ticks && joinerSession.GetConfirmedTick() == ticks;
+
+    std::printf("%ld ticks, delay %d polls, loss %.0f%%, %.3fs wall, match %s at tick %ld\n",
+        ticks, conditions.delayPolls, conditions.loss * 100.0f, seconds,
+        hostMatch.IsOver() ? WinnerName(hostMatch.GetWinner()) : "running", hostMatch.GetTick());
+
+    for (const RollbackSession* session : {&hostSession, &joinerSession}) {
+        const RollbackStats& stats = session->GetStats();
+        std::printf("%-6s rollbacks %ld (%.1f ticks avg, %d longest), stalls %ld, packets sent %ld received %ld\n",
+            session == &hostSession ? "host" : "joiner", stats.rollbacks,
+            stats.rollbacks > 0 ? (double)stats.resimulatedTicks / stats.rollbacks : 0.0, stats.longestRollback,
+            stats.stalls, stats.packetsSent, stats.packetsReceived);
+    }
+
+    std::printf("checksums %016llx %016llx: %s\n", (unsigned long long)hostChecksum, (unsigned long long)joinerChecksum,
+        passed ? "in sync" : "DESYNC");
+    return passed ? 0 : 1;
+}
+
+static void PrintNetplayTestUsage() {
+    std::printf("usage: main --headless --netplay-test TICKS [--delay POLLS] [--loss FRACTION] [--seed N]\n");
+}
+
+int RunNetplayTestCommand(int argc, char** argv) {
+    long ticks = 0;
+    NetConditions conditions;
+    uint64_t seed = 1;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--netplay-test" && hasValue) ticks = std::atol(argv[++i]);
+        else if (arg == "--delay" && hasValue) conditions.delayPolls = std::atoi(argv[++i]);
+        else if (arg == "--loss" && hasValue) conditions.loss = (float)std::atof(argv[++i]);
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            PrintNetplayTestUsage();
+            return 1;
+        }
+    }
+
+    if (ticks <= 0) {
+        PrintNetplayTestUsage();
+        return 1;
+    }
+
+    return RunNetplayTest(ticks, conditions, seed);
+}
+
+// Times the worst case rollback: load a snapshot and play MAX_ROLLBACK_TICKS
+// ticks, saving a snapshot after each as the session does
+static int RunRollbackBench(int reps, const HeadlessOptions& options) {
+    NullAudioSink audio;
+    Match match(options.mode, LoadHeadlessShipAssets(Side::LEFT), LoadHeadlessShipAssets(Side::RIGHT), audio, options.seed, options.shipsPerSide);
+
+    // A few seconds in, so there are projectiles in flight
+    for (int i = 0; i < TICK_RATE * 3 && !match.IsOver(); i++) {
+        match.Step(TICK_DT);
+    }
+
+    ByteWriter start;
+    match.SaveState(start);
+    std::vector<ByteWriter> snapshots(MAX_ROLLBACK_TICKS);
+
+    double total = 0.0, worst = 0.0;
+    for (int r = 0; r < reps; r++) {
+        auto begin = std::chrono::steady_clock::now();
+
+        ByteReader in(start.bytes);
+        match.LoadState(in);
+        for (ByteWriter& snapshot : snapshots) {
+            match.Step(TICK_DT);
+            snapshot.Clear();
+            match.SaveState(snapshot);
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        total += ms;
+        worst = std::max(worst, ms);
+    }
+
+    std::printf("%zu ships, %zu byte snapshots\n", match.world.ships.size(), start.Size());
+    std::printf("load + %d ticks with snapshots: %.3f ms avg, %.3f ms worst, budget %.2f ms at %d Hz\n",
+        MAX_ROLLBACK_TICKS, total / std::max(1, reps), worst, 1000.0 / FPS, FPS);
+    return 0;
+}
+
+static void PrintRollbackBenchUsage() {
+    std::printf("usage: main --headless --rollback-bench REPS [--arena SHIPS_PER_SIDE] [--seed N]\n");
+}
+
+int RunRollbackBenchCommand(int argc, char** argv) {
+    int reps = 0;
+    HeadlessOptions options;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--rollback-bench" && hasValue) reps = std::atoi(argv[++i]);
+        else if (arg == "--arena" && hasValue) {
+            options.mode = GameMode::Arena;
+            options.shipsPerSide = std::atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            PrintRollbackBenchUsage();
+            return 1;
+        }
+    }
+
+    if (reps <= 0 || options.shipsPerSide <= 0) {
+        PrintRollbackBenchUsage();
+        return 1;
+    }
+
+    return RunRollbackBench(reps, options);
+}
@@ -0,0 +1,99 @@
+#include "core/SpatialGrid.hpp"
+#include <algorithm>
+#include <cmath>
+
+void QueryScratch::Reserve(int capacity) {
+    indices.reserve(capacity);
+    x.reserve(capacity);
+    y.reserve(capacity);
+    mask.reserve(capacity);
+}
+
+SpatialGrid::SpatialGrid(float width, float height, float size, int capacity)
+    : cellSize(size) {
+    cols = std::max(1, (int)std::ceil(width / cellSize));
+    rows = std::max(1, (int)std::ceil(height / cellSize));
+
+    cellStart.assign(cols * rows + 1, 0);
+    entries.resize(capacity);
+    itemCell.resize(capacity);
+}
+
+// Projectiles outside the arena are filed under the nearest edge cell
+int SpatialGrid::CellX(float x) const {
+    int cx = (int)std::floor(x / cellSize);
+    return std::clamp(cx, 0, cols - 1);
+}
+
+int SpatialGrid::CellY(float y) const {
+    int cy = (int)std::floor(y / cellSize);
+    return std::clamp(cy, 0, rows - 1);
+}
+
+// Counting sort by cell: count, prefix sum, scatter. No allocation once
+// entries has grown to the pool capacity.
+void SpatialGrid::Build(const float* x, const float* y, int n, Vector2 centerOffset, float reach) {
+    extent = reach;
+
+    if ((int)entries.size() < n) {
+        entries.resize(n);
+        itemCell.resize(n);
+    }
+
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+
+    for (int i = 0; i < n; i++) {
+        int cell = CellY(y[i] + centerOffset.y) * cols + CellX(x[i] + centerOffset.x);
+        itemCell[i] = cell;
+        cellStart[cell + 1]++;
+    }
+
+    for (int c = 0; c < cols * rows; c++) {
+        cellStart[c + 1] += cellStart[c];
+    }
+
+    // cellStart[c] is used as the write cursor for cell c, then shifted back
+    for (int i = 0; i < n; i++) {
+        entries[cellStart[itemCell[i]]++] = i;
+    }
+
+    for (int c = cols * rows; c > 0; c--) {
+        cellStart[c] = cellStart[c - 1];
+    }
+    cellStart[0] = 0;
+}
+
+void SpatialGrid::QueryCells(int minX, int minY, int maxX, int maxY, std::vector<int>& out) const {
+    out.clear();
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        // Cells in a row are contiguous in entries, so a row is one range
+        int begin = cellStart[cy * cols + minX];
+        int end = cellStart[cy * cols + maxX + 1];
+        out.insert(out.end(), entries.begin() + begin, entries.begin() + end);
+    }
+}
+
+void SpatialGrid::QueryRect(Rectangle area, std::vector<int>& out) const {
+    QueryCells(CellX(area.x - extent), CellY(area.y - extent),
+               CellX(area.x + area.width + extent), CellY(area.y + area.height + extent), out);
+}
+
+void SpatialGrid::QueryRadius(Vector2 center, float radius, std::vector<int>& out) const {
+    float reach = radius + extent;
+    QueryCells(CellX(center.x - reach), CellY(center.y - reach),
+               CellX(center.x + reach), CellY(center.y + reach), out);
+}
+
+int SpatialGrid::Gather(const float* x, const float* y, QueryScratch& scratch) {
+    int n = (int)scratch.indices.size();
+    scratch.x.resize(n);
+    scratch.y.resize(n);
+    scratch.mask.resize(n);
+
+    for (int k = 0; k < n; k++) {
+        scratch.x[k] = x[scratch.indices[k]];
+        scratch.y[k] = y[scratch.indices[k]];
+    }
+    return n;
+}
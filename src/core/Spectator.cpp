@@ -0,0 +1,733 @@
+#include "core/Spectator.hpp"
+#include "core/Headless.hpp"
+#include "core/JobSystem.hpp"
+#include "core/Random.hpp"
+#include "core/config.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+static const uint16_t SPECTATOR_MAGIC = 0x5353;
+static const size_t MAX_DATAGRAM_SIZE = 65507;
+static const size_t SPECTATOR_HISTORY = 32;      // Frames a baseline can be found in, on both sides
+static const size_t MAX_SPECTATORS = 1024;
+static const int SERVER_RECEIVE_BUFFER = 4 << 20;
+static const uint32_t SPECTATOR_TIMEOUT = 5 * TICK_RATE / SPECTATOR_SEND_INTERVAL; // Frames without word before a client is dropped
+static const uint32_t MAX_PROJECTILES_PER_FRAME = 1 << 16;
+static const int POSITION_SCALE = 8;
+static const int HEALTH_SCALE = 16;
+
+enum class SpectatorPacket : uint8_t {
+    Hello = 1,  // Client to server, on connecting and then every second
+    Frame,      // Server to client
+    Ack,        // Client to server, for every frame it decoded
+    Bye         // Client to server, on leaving
+};
+
+// Ship fields present in a delta
+enum ShipField : uint8_t {
+    ShipX = 1,
+    ShipY = 2,
+    ShipHealth = 4,
+    ShipScore = 8
+};
+
+static int32_t QuantizePosition(float value) {
+    return (int32_t)std::lround(value * POSITION_SCALE);
+}
+
+static float Position(int32_t value) {
+    return (float)value / POSITION_SCALE;
+}
+
+// Where a projectile at position with velocity is elapsed ticks later, in
+// integers so the server and client agree exactly
+static int32_t Predict(int32_t position, int32_t velocity, long elapsed) {
+    return position + (int32_t)((int64_t)velocity * POSITION_SCALE * elapsed / TICK_RATE);
+}
+
+static void CapturePool(const ProjectilePool& pool, std::vector<SpectatorProjectile>& out) {
+    out.resize(pool.Count());
+    for (int i = 0; i < pool.Count(); i++) {
+        ProjectileHandle handle = pool.HandleAt(i);
+        out[i] = {handle.slot, handle.generation, QuantizePosition(pool.x[i]), QuantizePosition(pool.y[i]),
+                  (int32_t)std::lround(pool.vx[i]), (int32_t)std::lround(pool.vy[i]), pool.owner[i]};
+    }
+
+    std::sort(out.begin(), out.end(), [](const SpectatorProjectile& a, const SpectatorProjectile& b) {
+        return a.slot < b.slot;
+    });
+}
+
+void SpectatorFrame::Capture(const Match& match, uint32_t frameNumber) {
+    number = frameNumber;
+    tick = match.GetTick();
+    winner = match.GetWinner();
+    over = match.IsOver();
+
+    const World& world = match.world;
+    ships.resize(world.ships.size());
+    for (size_t i = 0; i < ships.size(); i++) {
+        const Spaceship& ship = *world.ships[i];
+        ships[i] = {QuantizePosition(ship.shipRect.x), QuantizePosition(ship.shipRect.y),
+                    (int32_t)std::lround(ship.health * HEALTH_SCALE), (uint32_t)std::max(ship.score, 0)};
+    }
+
+    CapturePool(world.projectiles.bullets, bullets);
+    CapturePool(world.projectiles.energy, energy);
+}
+
+// Each projectile starts with a varint of its slot's distance past the
+// previous one, shifted up two bits for "added" and "velocity changed"
+static void EncodePool(const std::vector<SpectatorProjectile>& current, const std::vector<SpectatorProjectile>& baseline, long elapsed, ByteWriter& out) {
+    out.Varint(current.size());
+
+    size_t j = 0;
+    uint32_t nextSlot = 0;
+    for (const SpectatorProjectile& p : current) {
+        while (j < baseline.size() && baseline[j].slot < p.slot) j++;
+        const SpectatorProjectile* old = nullptr;
+        if (j < baseline.size() && baseline[j].slot == p.slot && baseline[j].generation == p.generation) old = &baseline[j];
+
+        bool velocityChanged = old && (old->vx != p.vx || old->vy != p.vy);
+        out.Varint(((uint64_t)(p.slot - nextSlot) << 2) | ((uint64_t)velocityChanged << 1) | (old ? 0 : 1));
+        nextSlot = p.slot + 1;
+
+        if (!old) {
+            out.Varint(p.generation);
+            out.SignedVarint(p.x);
+            out.SignedVarint(p.y);
+            out.SignedVarint(p.vx);
+            out.SignedVarint(p.vy);
+            out.Varint(p.owner);
+            continue;
+        }
+
+        out.SignedVarint(p.x - Predict(old->x, old->vx, elapsed));
+        out.SignedVarint(p.y - Predict(old->y, old->vy, elapsed));
+        if (velocityChanged) {
+            out.SignedVarint(p.vx - old->vx);
+            out.SignedVarint(p.vy - old->vy);
+        }
+    }
+}
+
+static bool DecodePool(ByteReader& in, const std::vector<SpectatorProjectile>& baseline, long elapsed, size_t shipCount, std::vector<SpectatorProjectile>& out) {
+    uint64_t count = in.Varint();
+    if (!in.ok || count > MAX_PROJECTILES_PER_FRAME) return false;
+    out.resize(count);
+
+    size_t j = 0;
+    uint32_t nextSlot = 0;
+    for (SpectatorProjectile& p : out) {
+        uint64_t code = in.Varint();
+        p.slot = nextSlot + (uint32_t)(code >> 2);
+        nextSlot = p.slot + 1;
+
+        if (code & 1) {
+            p.generation = (uint32_t)in.Varint();
+            p.x = (int32_t)in.SignedVarint();
+            p.y = (int32_t)in.SignedVarint();
+            p.vx = (int32_t)in.SignedVarint();
+            p.vy = (int32_t)in.SignedVarint();
+            p.owner = (uint16_t)in.Varint();
+            if (p.owner >= shipCount) return false;
+            continue;
+        }
+
+        while (j < baseline.size() && baseline[j].slot < p.slot) j++;
+        if (j >= baseline.size() || baseline[j].slot != p.slot) return false;
+
+        const SpectatorProjectile& old = baseline[j];
+        p = old;
+        p.x = Predict(old.x, old.vx, elapsed) + (int32_t)in.SignedVarint();
+        p.y = Predict(old.y, old.vy, elapsed) + (int32_t)in.SignedVarint();
+        if (code & 2) {
+            p.vx += (int32_t)in.SignedVarint();
+            p.vy += (int32_t)in.SignedVarint();
+        }
+    }
+    return in.ok;
+}
+
+void SpectatorFrame::Encode(const SpectatorFrame* baseline, ByteWriter& out) const {
+    static const SpectatorFrame empty;
+    const SpectatorFrame& base = baseline ? *baseline : empty;
+    long elapsed = tick - base.tick;
+
+    out.Varint((uint64_t)elapsed);
+    out.U8((uint8_t)winner | (uint8_t)(over << 2));
+
+    out.Varint(ships.size());
+    for (size_t i = 0; i < ships.size(); i++) {
+        const SpectatorShip& ship = ships[i];
+        SpectatorShip old = i < base.ships.size() ? base.ships[i] : SpectatorShip{};
+
+        uint8_t fields = (ship.x != old.x ? ShipX : 0) | (ship.y != old.y ? ShipY : 0) |
+                         (ship.health != old.health ? ShipHealth : 0) | (ship.score != old.score ? ShipScore : 0);
+        out.U8(fields);
+        if (fields & ShipX) out.SignedVarint(ship.x - old.x);
+        if (fields & ShipY) out.SignedVarint(ship.y - old.y);
+        if (fields & ShipHealth) out.SignedVarint(ship.health - old.health);
+        if (fields & ShipScore) out.Varint(ship.score - old.score);
+    }
+
+    EncodePool(bullets, base.bullets, elapsed, out);
+    EncodePool(energy, base.energy, elapsed, out);
+}
+
+bool SpectatorFrame::Decode(ByteReader& in, const SpectatorFrame* baseline) {
+    static const SpectatorFrame empty;
+    const SpectatorFrame& base = baseline ? *baseline : empty;
+
+    long elapsed = (long)in.Varint();
+    tick = base.tick + elapsed;
+    uint8_t outcome = in.U8();
+    winner = (Winner)(outcome & 3);
+    over = (outcome >> 2) & 1;
+
+    uint64_t shipCount = in.Varint();
+    if (!in.ok || shipCount > in.Remaining()) return false;
+
+    ships.resize(shipCount);
+    for (size_t i = 0; i < ships.size(); i++) {
+        SpectatorShip& ship = ships[i];
+        ship = i < base.ships.size() ? base.ships[i] : SpectatorShip{};
+
+        uint8_t fields = in.U8();
+        if (fields & ShipX) ship.x += (int32_t)in.SignedVarint();
+        if (fields & ShipY) ship.y += (int32_t)in.SignedVarint();
+        if (fields & ShipHealth) ship.health += (int32_t)in.SignedVarint();
+        if (fields & ShipScore) ship.score += (uint32_t)in.Varint();
+    }
+
+    return DecodePool(in, base.bullets, elapsed, ships.size(), bullets) &&
+           DecodePool(in, base.energy, elapsed, ships.size(), energy);
+}
+
+static void BeginPacket(ByteWriter& out, SpectatorPacket type) {
+    out.Clear();
+    out.U16(SPECTATOR_MAGIC);
+    out.U8((uint8_t)type);
+}
+
+static bool ReadHeader(ByteReader& in, SpectatorPacket& type) {
+    uint16_t magic = in.U16();
+    type = (SpectatorPacket)in.U8();
+    return in.ok && magic == SPECTATOR_MAGIC;
+}
+
+static uint64_t AddressKey(const NetAddress& address) {
+    return ((uint64_t)address.ip << 16) | address.port;
+}
+
+bool SpectatorServer::Open(uint16_t port) {
+    receiveBuffer.resize(MAX_DATAGRAM_SIZE);
+    if (!socket.Open(port)) return false;
+
+    // Every spectator acks every frame, all at about the same time
+    socket.SetReceiveBufferSize(SERVER_RECEIVE_BUFFER);
+    return true;
+}
+
+uint16_t SpectatorServer::LocalPort() const {
+    return socket.LocalPort();
+}
+
+void SpectatorServer::Update(const Match& match) {
+    Receive();
+
+    if (match.GetSeed() != matchId || history.empty()) {
+        matchId = match.GetSeed();
+        mode = match.GetMode();
+        shipsPerSide = match.GetShipsPerSide();
+        history.clear();
+        ticksSinceFrame = SPECTATOR_SEND_INTERVAL;
+    }
+
+    if (++ticksSinceFrame < SPECTATOR_SEND_INTERVAL) return;
+    ticksSinceFrame = 0;
+
+    // Reuse the oldest frame's vectors for the newest
+    if (history.size() < SPECTATOR_HISTORY) {
+        history.emplace_back();
+    }
+    else {
+        history.push_back(std::move(history.front()));
+        history.pop_front();
+    }
+    history.back().Capture(match, nextFrame++);
+
+    encodedCount = 0;
+    for (auto it = clients.begin(); it != clients.end();) {
+        Client& client = it->second;
+        if (nextFrame - client.lastHeard > SPECTATOR_TIMEOUT) {
+            it = clients.erase(it);
+            continue;
+        }
+
+        const ByteWriter& packet = PacketFor(client.acked);
+        if (socket.Send(client.address, packet.bytes.data(), packet.Size())) {
+            stats.framesSent++;
+            stats.bytesSent += (long)packet.Size();
+            if (!FindFrame(client.acked)) stats.fullFrames++;
+        }
+        ++it;
+    }
+}
+
+void SpectatorServer::Receive() {
+    NetAddress from;
+    int size;
+    while ((size = socket.Receive(from, receiveBuffer.data(), receiveBuffer.size())) >= 0) {
+        ByteReader in(receiveBuffer.data(), (size_t)size);
+        SpectatorPacket type;
+        if (!ReadHeader(in, type)) continue;
+
+        uint64_t key = AddressKey(from);
+        auto it = clients.find(key);
+
+        if (type == SpectatorPacket::Hello) {
+            if (it == clients.end() && clients.size() < MAX_SPECTATORS) {
+                it = clients.emplace(key, Client{from, 0, nextFrame}).first;
+            }
+            if (it != clients.end()) it->second.lastHeard = nextFrame;
+        }
+        else if (type == SpectatorPacket::Ack && it != clients.end()) {
+            uint64_t ackedMatch = in.U64();
+            uint32_t frame = (uint32_t)in.Varint();
+            if (in.ok && ackedMatch == matchId) it->second.acked = std::max(it->second.acked, frame);
+            it->second.lastHeard = nextFrame;
+        }
+        else if (type == SpectatorPacket::Bye && it != clients.end()) {
+            clients.erase(it);
+        }
+    }
+}
+
+const SpectatorFrame* SpectatorServer::FindFrame(uint32_t number) const {
+    if (history.empty() || number < history.front().number || number >= history.back().number) return nullptr;
+    return &history[number - history.front().number];
+}
+
+// Spectators that acked the same frame get the same bytes, so each delta is
+// built once per send however many clients there are
+const ByteWriter& SpectatorServer::PacketFor(uint32_t baseline) {
+    const SpectatorFrame* base = FindFrame(baseline);
+    uint32_t baseNumber = base ? baseline : 0;
+
+    for (size_t i = 0; i < encodedCount; i++) {
+        if (encoded[i].baseline == baseNumber) return encoded[i].packet;
+    }
+
+    if (encodedCount == encoded.size()) encoded.emplace_back();
+    Encoded& entry = encoded[encodedCount++];
+    entry.baseline = baseNumber;
+
+    const SpectatorFrame& frame = history.back();
+    ByteWriter& out = entry.packet;
+    BeginPacket(out, SpectatorPacket::Frame);
+    out.U64(matchId);
+    out.U8((uint8_t)mode);
+    out.Varint((uint64_t)shipsPerSide);
+    out.Varint(frame.number);
+    out.Varint(baseNumber);
+    frame.Encode(base, out);
+
+    stats.encodes++;
+    return out;
+}
+
+int SpectatorServer::ClientCount() const {
+    return (int)clients.size();
+}
+
+const SpectatorServerStats& SpectatorServer::GetStats() const {
+    return stats;
+}
+
+SpectatorClient::SpectatorClient(const ShipAssets& yellow, const ShipAssets& red, IAudioSink& audioSink)
+    : yellowAssets(yellow), redAssets(red), audio(audioSink) {
+    receiveBuffer.resize(MAX_DATAGRAM_SIZE);
+}
+
+bool SpectatorClient::Connect(const NetAddress& serverAddress) {
+    server = serverAddress;
+    if (!socket.Open(0)) return false;
+
+    Send(SpectatorPacket::Hello);
+    return true;
+}
+
+void SpectatorClient::Disconnect() {
+    if (!socket.IsOpen()) return;
+
+    Send(SpectatorPacket::Bye);
+    socket.Close();
+}
+
+void SpectatorClient::Poll(float dt) {
+    Receive();
+
+    // Also keeps the server from dropping us while no frames get through
+    sinceHello += dt;
+    if (sinceHello >= 1.0f) {
+        sinceHello = 0.0f;
+        Send(SpectatorPacket::Hello);
+    }
+
+    AdvancePlayback(dt);
+    ApplyFrames();
+}
+
+void SpectatorClient::Send(SpectatorPacket type, uint32_t frame) {
+    BeginPacket(packet, type);
+    if (type == SpectatorPacket::Ack) {
+        packet.U64(matchId);
+        packet.Varint(frame);
+    }
+    socket.Send(server, packet.bytes.data(), packet.Size());
+}
+
+void SpectatorClient::Receive() {
+    NetAddress from;
+    int size;
+    while ((size = socket.Receive(from, receiveBuffer.data(), receiveBuffer.size())) >= 0) {
+        if (from != server) continue;
+
+        ByteReader in(receiveBuffer.data(), (size_t)size);
+        SpectatorPacket type;
+        if (!ReadHeader(in, type) || type != SpectatorPacket::Frame) continue;
+
+        stats.bytesReceived += size;
+        ReadFrame(in);
+    }
+}
+
+void SpectatorClient::ReadFrame(ByteReader& in) {
+    uint64_t id = in.U64();
+    uint8_t modeValue = in.U8();
+    int shipsPerSide = (int)in.Varint();
+    uint32_t number = (uint32_t)in.Varint();
+    uint32_t baseline = (uint32_t)in.Varint();
+    if (!in.ok || modeValue > (uint8_t)GameMode::Arena || shipsPerSide <= 0 || shipsPerSide > SPECTATOR_MAX_SHIPS_PER_SIDE) return;
+
+    GameMode mode = (GameMode)modeValue;
+    if (mode != GameMode::Arena && shipsPerSide != 1) return;
+
+    // A new match starts from a full frame, and only replaces the one being
+    // watched once that frame has decoded
+    bool newMatch = !match || id != matchId;
+    if (!newMatch && !frames.empty() && number <= frames.back().number) return; // Late or repeated
+
+    const SpectatorFrame* base = nullptr;
+    if (baseline != 0) {
+        if (!newMatch) {
+            for (const SpectatorFrame& frame : frames) {
+                if (frame.number == baseline) base = &frame;
+            }
+        }
+        if (!base) {
+            stats.framesDropped++;
+            return;
+        }
+    }
+
+    SpectatorFrame frame;
+    frame.number = number;
+    size_t shipCount = mode == GameMode::Arena ? (size_t)shipsPerSide * 2 : 2;
+    if (!frame.Decode(in, base) || frame.ships.size() != shipCount) {
+        stats.framesDropped++;
+        return;
+    }
+
+    // Build a match like it to draw into
+    if (newMatch) {
+        match = std::make_unique<Match>(mode, yellowAssets, redAssets, audio, id, shipsPerSide);
+        matchId = id;
+        frames.clear();
+        playing = false;
+    }
+
+    if (frames.size() == SPECTATOR_HISTORY) frames.pop_front();
+    frames.push_back(std::move(frame));
+    stats.framesReceived++;
+    Send(SpectatorPacket::Ack, number);
+}
+
+// Plays SPECTATOR_DELAY behind the newest frame, speeding up or slowing down
+// a little to stay there as frames arrive early or late
+void SpectatorClient::AdvancePlayback(float dt) {
+    if (frames.empty()) return;
+
+    double delay = SPECTATOR_DELAY * TICK_RATE;
+    double target = frames.back().tick - delay;
+
+    if (!playing || std::fabs(playTick - target) > delay * 2) {
+        playTick = target;
+        playing = true;
+    }
+    else {
+        double rate = 1.0 + std::clamp((target - playTick) / delay, -0.1, 0.1);
+        playTick += dt * TICK_RATE * rate;
+    }
+
+    playTick = std::clamp(playTick, (double)frames.front().tick, (double)frames.back().tick);
+}
+
+static void ApplyPool(ProjectilePool& pool, const World& world, const std::vector<SpectatorProjectile>& from, const std::vector<SpectatorProjectile>& to) {
+    pool.Clear();
+
+    size_t j = 0;
+    for (const SpectatorProjectile& p : to) {
+        int i = pool.Count();
+        uint8_t team = (uint8_t)world.ships[p.owner]->shipSide;
+        if (pool.Spawn({Position(p.x), Position(p.y)}, {(float)p.vx, (float)p.vy}, 0.0f, p.owner, team).IsNull()) break;
+
+        while (j < from.size() && from[j].slot < p.slot) j++;
+        if (j < from.size() && from[j].slot == p.slot && from[j].generation == p.generation) {
+            pool.prevX[i] = Position(from[j].x);
+            pool.prevY[i] = Position(from[j].y);
+        }
+    }
+}
+
+// Copies the frames either side of playback into the match: the earlier
+// as the previous state and the later as the current, so drawing with
+// alpha lands in between
+void SpectatorClient::ApplyFrames() {
+    if (frames.empty()) return;
+
+    shown = 0;
+    while (shown + 1 < frames.size() && frames[shown].tick <= playTick) shown++;
+    const SpectatorFrame& to = frames[shown];
+    const SpectatorFrame& from = frames[shown > 0 ? shown - 1 : 0];
+
+    long span = to.tick - from.tick;
+    alpha = span > 0 ? (float)std::clamp((playTick - from.tick) / span, 0.0, 1.0) : 1.0f;
+
+    World& world = match->world;
+    for (size_t i = 0; i < world.ships.size(); i++) {
+        Spaceship& ship = *world.ships[i];
+        ship.prevPos = {Position(from.ships[i].x), Position(from.ships[i].y)};
+        ship.shipRect.x = Position(to.ships[i].x);
+        ship.shipRect.y = Position(to.ships[i].y);
+        ship.health = (float)to.ships[i].health / HEALTH_SCALE;
+        ship.score = (int)to.ships[i].score;
+    }
+
+    ApplyPool(world.projectiles.bullets, world, from.bullets, to.bullets);
+    ApplyPool(world.projectiles.energy, world, from.energy, to.energy);
+}
+
+void SpectatorClient::Draw(IRenderSink& renderer) {
+    if (match && !frames.empty()) match->Draw(renderer, alpha);
+}
+
+Match* SpectatorClient::GetMatch() {
+    return frames.empty() ? nullptr : match.get();
+}
+
+const SpectatorFrame* SpectatorClient::ShownFrame() const {
+    return frames.empty() ? nullptr : &frames[shown];
+}
+
+const SpectatorFrame* SpectatorClient::NewestFrame() const {
+    return frames.empty() ? nullptr : &frames.back();
+}
+
+const SpectatorClientStats& SpectatorClient::GetStats() const {
+    return stats;
+}
+
+// Plays AI matches one after another in real time, streaming each to every
+// spectator that connects. Runs until killed
+static int RunSpectatorServer(uint16_t port, const HeadlessOptions& options) {
+    SpectatorServer server;
+    if (!server.Open(port)) {
+        std::printf("could not listen on port %d\n", (int)port);
+        return 1;
+    }
+    std::printf("serving spectators on port %d\n", (int)server.LocalPort());
+    std::fflush(stdout);
+
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+    NullAudioSink audio;
+    std::unique_ptr<JobSystem> jobs;
+    if (options.jobThreads != 1) jobs = std::make_unique<JobSystem>(options.jobThreads);
+
+    const auto tickLength = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(TICK_DT));
+
+    for (int i = 0;; i++) {
+        uint64_t seed = Random::MixSeed(options.seed, (uint64_t)i);
+        Match match(options.mode, yellowAssets, redAssets, audio, seed, options.shipsPerSide);
+        if (jobs) match.world.SetJobSystem(jobs.get());
+
+        // Keep showing the result for a few seconds before the next match
+        long endTicks = 0;
+        auto next = std::chrono::steady_clock::now();
+        while (endTicks < TICK_RATE * 3) {
+            match.Step(TICK_DT);
+            server.Update(match);
+            if (match.IsOver() || match.GetClock().time >= options.maxMatchTime) endTicks++;
+
+            next += tickLength;
+            std::this_thread::sleep_until(next);
+        }
+
+        const SpectatorServerStats& stats = server.GetStats();
+        std::printf("match %d: %s in %.1fs, %d spectators, %ld frames sent, %.1f MB total\n",
+            i, WinnerName(match.GetWinner()), match.GetClock().time, server.ClientCount(), stats.framesSent, stats.bytesSent / 1e6);
+        std::fflush(stdout);
+    }
+}
+
+// Streams one match, as fast as it runs, to clients spectators in this
+// process over localhost. Reports the server's time and bandwidth per
+// spectator and checks every client ends on the server's last frame
+static int RunSpectateBench(int clientCount, const HeadlessOptions& options) {
+    SpectatorServer server;
+    NetAddress serverAddress;
+    if (!server.Open(0) || !NetAddress::Parse("127.0.0.1", server.LocalPort(), serverAddress)) {
+        std::printf("could not open a localhost socket\n");
+        return 1;
+    }
+
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+    NullAudioSink audio;
+
+    std::vector<std::unique_ptr<SpectatorClient>> clients;
+    for (int i = 0; i < clientCount; i++) {
+        clients.push_back(std::make_unique<SpectatorClient>(yellowAssets, redAssets, audio));
+        if (!clients.back()->Connect(serverAddress)) {
+            std::printf("could not open client socket %d\n", i);
+            return 1;
+        }
+    }
+
+    Match match(options.mode, yellowAssets, redAssets, audio, options.seed, options.shipsPerSide);
+    SpectatorFrame last;
+    double serverSeconds = 0.0, clientSeconds = 0.0;
+    long frames = 0;
+
+    while (!match.IsOver() && match.GetClock().time < options.maxMatchTime) {
+        match.Step(TICK_DT);
+
+        auto start = std::chrono::steady_clock::now();
+        long sent = server.GetStats().framesSent;
+        server.Update(match);
+        serverSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (server.GetStats().framesSent != sent) frames++;
+
+        start = std::chrono::steady_clock::now();
+        for (auto& client : clients) {
+            client->Poll(TICK_DT);
+        }
+        clientSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    last.Capture(match, 0);
+
+    // Frames only go every few ticks, so send a couple more to get the final one out
+    for (int i = 0; i < SPECTATOR_SEND_INTERVAL * 2; i++) {
+        server.Update(match);
+        for (auto& client : clients) {
+            client->Poll(TICK_DT);
+        }
+    }
+
+    int matching = 0;
+    long received = 0, dropped = 0;
+    for (auto& client : clients) {
+        const SpectatorFrame* frame = client->NewestFrame();
+        if (frame && frame->tick == match.GetTick() && frame->ships.size() == last.ships.size() &&
+            frame->bullets.size() == last.bullets.size() && frame->energy.size() == last.energy.size() &&
+            std::equal(frame->ships.begin(), frame->ships.end(), last.ships.begin(), [](const SpectatorShip& a, const SpectatorShip& b) {
+                return a.x == b.x && a.y == b.y && a.health == b.health && a.score == b.score;
+            })) {
+            matching++;
+        }
+        received += client->GetStats().framesReceived;
+        dropped += client->GetStats().framesDropped;
+    }
+
+    const SpectatorServerStats& stats = server.GetStats();
+    double seconds = match.GetClock().time;
+    double perSpectatorFrame = stats.framesSent > 0 ? serverSeconds / stats.framesSent : 0.0;
+
+    std::printf("%d spectators, %zu ships, %.1fs match, %ld frames\n", clientCount, match.world.ships.size(), seconds, frames);
+    std::printf("server: %.2f us per spectator frame, %ld deltas encoded for %ld sent (%ld full), %.2f%% of a core for %d spectators\n",
+        perSpectatorFrame * 1e6, stats.encodes, stats.framesSent, stats.fullFrames,
+        seconds > 0.0 ? serverSeconds / seconds * 100.0 : 0.0, clientCount);
+    std::printf("bandwidth: %.0f bytes per frame, %.2f KB/s per spectator\n",
+        stats.framesSent > 0 ? (double)stats.bytesSent / stats.framesSent : 0.0,
+        seconds > 0.0 ? stats.bytesSent / 1024.0 / seconds / std::max(1, clientCount) : 0.0);
+    std::printf("clients: %ld frames decoded, %ld dropped, %.2f us each; %d of %d on the final frame\n",
+        received, dropped, received > 0 ? clientSeconds / received * 1e6 : 0.0, matching, clientCount);
+    return matching == clientCount ? 0 : 1;
+}
+
+static void PrintSpectatorUsage() {
+    std::printf("usage: main --headless --serve PORT [--arena SHIPS_PER_SIDE] [--jobs THREADS] [--seed N] [--max-time SECONDS]\n");
+    std::printf("       main --headless --spectate-bench CLIENTS [--arena SHIPS_PER_SIDE] [--seed N] [--max-time SECONDS]\n");
+}
+
+// The two commands take the same flags but for the one naming them
+static bool ParseSpectatorCommand(int argc, char** argv, const std::string& flag, int& value, HeadlessOptions& options) {
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == flag && hasValue) value = std::atoi(argv[++i]);
+        else if (arg == "--arena" && hasValue) {
+            options.mode = GameMode::Arena;
+            options.shipsPerSide = std::atoi(argv[++i]);
+        }
+        else if (arg == "--jobs" && hasValue) options.jobThreads = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--max-time" && hasValue) options.maxMatchTime = std::atof(argv[++i]);
+        else {
+            PrintSpectatorUsage();
+            return false;
+        }
+    }
+
+    if (options.shipsPerSide <= 0 || options.jobThreads < 0) {
+        PrintSpectatorUsage();
+        return false;
+    }
+    if (options.shipsPerSide > SPECTATOR_MAX_SHIPS_PER_SIDE) {
+        std::printf("spectators can watch arenas of up to %d ships a side\n", SPECTATOR_MAX_SHIPS_PER_SIDE);
+        return false;
+    }
+    return true;
+}
+
+int RunSpectatorServerCommand(int argc, char** argv) {
+    int port = -1;
+    HeadlessOptions options;
+    if (!ParseSpectatorCommand(argc, argv, "--serve", port, options)) return 1;
+
+    if (port < 0) {
+        PrintSpectatorUsage();
+        return 1;
+    }
+    return RunSpectatorServer((uint16_t)port, options);
+}
+
+int RunSpectateBenchCommand(int argc, char** argv) {
+    int clients = 0;
+    HeadlessOptions options;
+    if (!ParseSpectatorCommand(argc, argv, "--spectate-bench", clients, options)) return 1;
+
+    if (clients <= 0) {
+        PrintSpectatorUsage();
+        return 1;
+    }
+    return RunSpectateBench(clients, options);
+}
@@ -0,0 +1,234 @@
+#include "core/TextureAtlas.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// Each image's edge pixels are repeated this far around it, so sampling at
+// a sprite's border never picks up its neighbour
+static const int atlasPadding = 2;
+
+// Side of the white block, inside its padding
+static const int whiteSize = 4;
+
+static int NextPowerOfTwo(int n) {
+    int power = 1;
+    while (power < n) power *= 2;
+    return power;
+}
+
+static std::string NormalPath(const std::string& path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+struct PackItem {
+    int width;  // Padding included
+    int height;
+    int x = 0;
+    int y = 0;
+};
+
+// Shelf packing, tallest first, into rows of width. Returns the height used,
+// or -1 if an item is wider than a row
+static int ShelfPack(std::vector<PackItem>& items, int width) {
+    std::vector<int> order(items.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = (int)i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return items[a].height > items[b].height; });
+
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (int i : order) {
+        PackItem& item = items[i];
+        if (item.width > width) return -1;
+        if (x + item.width > width) {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        item.x = x;
+        item.y = y;
+        x += item.width;
+        shelfHeight = std::max(shelfHeight, item.height);
+    }
+    return y + shelfHeight;
+}
+
+// Copies image in with its edges stretched over the padding. x and y are
+// where the image itself starts
+static void Blit(unsigned char* atlas, int atlasWidth, const Image& image, int x, int y) {
+    const unsigned char* pixels = (const unsigned char*)image.data;
+    for (int row = -atlasPadding; row < image.height + atlasPadding; row++) {
+        int sourceRow = std::clamp(row, 0, image.height - 1);
+        for (int column = -atlasPadding; column < image.width + atlasPadding; column++) {
+            int sourceColumn = std::clamp(column, 0, image.width - 1);
+            std::memcpy(atlas + ((size_t)(y + row) * atlasWidth + x + column) * 4,
+                        pixels + ((size_t)sourceRow * image.width + sourceColumn) * 4, 4);
+        }
+    }
+}
+
+bool TextureAtlas::Build(const std::string& directory, int maxSize, const AssetArchive* archive) {
+    return Pack(directory, maxSize, archive) && Upload();
+}
+
+// Everything here is on the CPU, into the pending members, so it can run on
+// another thread while the atlas is still drawn from
+bool TextureAtlas::Pack(const std::string& directory, int maxSize, const AssetArchive* archive) {
+    if (pending.data) UnloadImage(pending);
+    pending = {};
+    pendingEntries.clear();
+    pendingAliasEntries.assign(aliases.size(), -1);
+    if (archive && !archive->IsOpen()) archive = nullptr;
+
+    std::vector<std::string> paths;
+    if (archive) {
+        std::string prefix = NormalPath(directory) + "/";
+        for (const std::string& path : archive->Paths()) {
+            if (path.rfind(prefix, 0) == 0 && std::filesystem::path(path).extension() == ".png") paths.push_back(path);
+        }
+    }
+    else {
+        std::error_code error;
+        for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+            if (file.path().extension() == ".png") paths.push_back(NormalPath(file.path().string()));
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Image> images;
+    std::vector<PackItem> items;
+    for (const std::string& path : paths) {
+        Image packed;
+        Image image = archive && archive->FindImage(path, packed) ? ImageCopy(packed) : LoadImage(path.c_str());
+        if (!image.data) continue;
+
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+        // At the largest size a texture aliased to it is, which the sprites
+        // drawn from it were already sized to
+        int width = 0;
+        int height = 0;
+        for (size_t i = 0; i < aliases.size(); i++) {
+            if (aliases[i].path != path) continue;
+
+            pendingAliasEntries[i] = (int)pendingEntries.size();
+            width = std::max(width, aliases[i].texture.width);
+            height = std::max(height, aliases[i].texture.height);
+        }
+        if (width > 0 && height > 0 && (width != image.width || height != image.height)) ImageResize(&image, width, height);
+
+        images.push_back(image);
+        pendingEntries.push_back({path, {0.0f, 0.0f, (float)image.width, (float)image.height}});
+        items.push_back({image.width + atlasPadding * 2, image.height + atlasPadding * 2});
+    }
+    items.push_back({whiteSize + atlasPadding * 2, whiteSize + atlasPadding * 2});
+
+    // The narrowest power of two wide that packs no taller than it is wide
+    int width = 0;
+    int height = 0;
+    if (!images.empty()) {
+        for (int tryWidth = 64; tryWidth <= maxSize; tryWidth *= 2) {
+            int used = ShelfPack(items, tryWidth);
+            if (used >= 0 && NextPowerOfTwo(used) <= tryWidth) {
+                width = tryWidth;
+                height = NextPowerOfTwo(used);
+                break;
+            }
+        }
+    }
+
+    if (width == 0) {
+        for (Image& image : images) {
+            UnloadImage(image);
+        }
+        pendingEntries.clear();
+        return false;
+    }
+
+    pending = GenImageColor(width, height, BLANK);
+    unsigned char* pixels = (unsigned char*)pending.data;
+    for (size_t i = 0; i < images.size(); i++) {
+        int x = items[i].x + atlasPadding;
+        int y = items[i].y + atlasPadding;
+        Blit(pixels, width, images[i], x, y);
+        pendingEntries[i].region.x = (float)x;
+        pendingEntries[i].region.y = (float)y;
+        UnloadImage(images[i]);
+    }
+
+    const PackItem& block = items.back();
+    for (int row = 0; row < block.height; row++) {
+        std::memset(pixels + ((size_t)(block.y + row) * width + block.x) * 4, 255, (size_t)block.width * 4);
+    }
+    pendingWhite = {(block.x + block.width * 0.5f) / width, (block.y + block.height * 0.5f) / height};
+    return true;
+}
+
+bool TextureAtlas::Upload() {
+    if (!pending.data) return false;
+
+    Release();
+    texture = LoadTextureFromImage(pending);
+    UnloadImage(pending);
+    pending = {};
+
+    entries.swap(pendingEntries);
+    pendingEntries.clear();
+    for (size_t i = 0; i < aliases.size() && i < pendingAliasEntries.size(); i++) {
+        aliases[i].entry = pendingAliasEntries[i];
+    }
+    white = pendingWhite;
+    return texture.id != 0;
+}
+
+// Frees the texture, keeping the aliases to build it again
+void TextureAtlas::Release() {
+    if (texture.id != 0) UnloadTexture(texture);
+    texture = {};
+    entries.clear();
+    for (TextureAlias& alias : aliases) {
+        alias.entry = -1;
+    }
+}
+
+void TextureAtlas::Unload() {
+    Release();
+    if (pending.data) UnloadImage(pending);
+    pending = {};
+    pendingEntries.clear();
+    aliases.clear();
+}
+
+TextureAtlas::~TextureAtlas() {
+    Unload();
+}
+
+void TextureAtlas::Alias(const Texture2D& aliased, const std::string& path) {
+    if (aliased.id != 0) aliases.push_back({aliased, NormalPath(path), -1});
+}
+
+bool TextureAtlas::Find(const Texture2D& aliased, Rectangle& region) const {
+    if (texture.id == 0) return false;
+
+    for (const TextureAlias& alias : aliases) {
+        if (alias.texture.id != aliased.id || alias.entry < 0) continue;
+
+        region = entries[alias.entry].region;
+        return true;
+    }
+    return false;
+}
+
+bool TextureAtlas::IsReady() const {
+    return texture.id != 0;
+}
+
+const Texture2D& TextureAtlas::GetTexture() const {
+    return texture;
+}
+
+Vector2 TextureAtlas::WhiteTexel() const {
+    return white;
+}
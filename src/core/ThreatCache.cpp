@@ -0,0 +1,177 @@
+#include "core/ThreatCache.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const float noImpact = 1e9f;
+
+// First radius the energy search tries, doubling until it finds enough
+static const float energySearchRadius = 128.0f;
+
+static int BandOf(float y) {
+    return std::clamp((int)std::floor(y / threatBandHeight), 0, threatBands - 1);
+}
+
+// Sorted by list and then x in one go, keeping just the lists that have bullets
+void TeamThreats::Build(uint8_t team, const Projectiles& projectiles) {
+    const ProjectilePool& bullets = projectiles.bullets;
+    entries.clear();
+    runs.clear();
+
+    for (int i = 0; i < bullets.Count(); i++) {
+        if (bullets.team[i] == team || bullets.vx[i] == 0.0f) continue;
+
+        float y = bullets.y[i] + bulletSize.y * 0.5f;
+        int list = BandOf(y) * 2 + (bullets.vx[i] > 0.0f ? 1 : 0);
+        entries.push_back({list, bullets.x[i] + bulletSize.x * 0.5f, y, bullets.vx[i]});
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.list != b.list) return a.list < b.list;
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+
+    for (int e = 0; e < (int)entries.size(); e++) {
+        if (runs.empty() || runs.back().list != entries[e].list) runs.push_back({entries[e].list, e, e, 0.0f});
+        runs.back().end = e + 1;
+        runs.back().maxSpeed = std::max(runs.back().maxSpeed, std::fabs(entries[e].vx));
+    }
+
+    enemyEnergy.clear();
+    for (int i = 0; i < projectiles.energy.Count(); i++) {
+        if (projectiles.energy.team[i] != team) enemyEnergy.push_back(i);
+    }
+}
+
+const std::vector<int>& TeamThreats::EnemyEnergy() const {
+    return enemyEnergy;
+}
+
+// Walks out from x against the flow, nearest bullet first. With every bullet
+// at the same speed the first one found is the answer
+static bool SoonestInRun(const TeamThreats::Entry* begin, const TeamThreats::Entry* end, bool rightward, float maxSpeed, float x, float window, IncomingBullet& soonest) {
+    bool found = false;
+    float best = window;
+
+    if (rightward) {
+        auto less = [](const TeamThreats::Entry& e, float value) { return e.x < value; };
+        for (const TeamThreats::Entry* e = std::lower_bound(begin, end, x, less); e != begin;) {
+            --e;
+            if ((x - e->x) / maxSpeed > best) break;
+
+            float time = (x - e->x) / e->vx;
+            if (time > 0.0f && time <= best && (!found || time < best)) {
+                found = true;
+                best = time;
+                soonest = {time, e->y};
+            }
+        }
+    }
+    else {
+        auto greater = [](float value, const TeamThreats::Entry& e) { return value < e.x; };
+        for (const TeamThreats::Entry* e = std::upper_bound(begin, end, x, greater); e != end; ++e) {
+            if ((e->x - x) / maxSpeed > best) break;
+
+            float time = (e->x - x) / -e->vx;
+            if (time > 0.0f && time <= best && (!found || time < best)) {
+                found = true;
+                best = time;
+                soonest = {time, e->y};
+            }
+        }
+    }
+    return found;
+}
+
+void TeamThreats::Soonest(int firstBand, int lastBand, float x, float window, IncomingBullet* perBand) const {
+    auto run = std::lower_bound(runs.begin(), runs.end(), firstBand * 2, [](const Run& r, int list) { return r.list < list; });
+    for (; run != runs.end() && run->list <= lastBand * 2 + 1; ++run) {
+        IncomingBullet bullet;
+        bool rightward = run->list % 2 == 1;
+        if (!SoonestInRun(entries.data() + run->begin, entries.data() + run->end, rightward, run->maxSpeed, x, window, bullet)) continue;
+
+        IncomingBullet& soonest = perBand[run->list / 2 - firstBand];
+        if (bullet.time < soonest.time) soonest = bullet;
+    }
+}
+
+ShipThreats::ShipThreats() {
+    bullets.reserve(32);
+    energy.reserve(maxEnergyThreats);
+    nearby.reserve(64);
+    ranked.reserve(64);
+}
+
+void ShipThreats::Analyze(Rectangle shipRect, uint8_t team, float reach, const TeamThreats& incoming, const Projectiles& projectiles) {
+    float sx = shipRect.x + shipRect.width * 0.5f;
+    float sy = shipRect.y + shipRect.height * 0.5f;
+
+    firstBand = BandOf(sy - reach);
+    int lastBand = BandOf(sy + reach);
+    bandSoonest.assign(lastBand - firstBand + 1, {noImpact, 0.0f});
+    bullets.clear();
+
+    incoming.Soonest(firstBand, lastBand, sx, bulletThreatWindow, bandSoonest.data());
+    for (const IncomingBullet& bullet : bandSoonest) {
+        if (bullet.time < noImpact) bullets.push_back(bullet);
+    }
+
+    std::sort(bullets.begin(), bullets.end(), [](const IncomingBullet& a, const IncomingBullet& b) {
+        return a.time < b.time || (a.time == b.time && a.y < b.y);
+    });
+
+    // With few enough enemy energy weapons every one is a candidate,
+    // otherwise widen the search until enough turn up or it covers
+    // everything that could still reach the ship
+    const ProjectilePool& pool = projectiles.energy;
+    auto rank = [&](const std::vector<int>& candidates, float radius) {
+        ranked.clear();
+        for (int i : candidates) {
+            if (pool.team[i] == team) continue;
+
+            float dx = pool.x[i] - sx;
+            float dy = pool.y[i] - sy;
+            float dist2 = dx * dx + dy * dy;
+            if (dist2 <= radius * radius) ranked.push_back({dist2, i});
+        }
+    };
+
+    if ((int)incoming.EnemyEnergy().size() <= maxEnergyThreats) {
+        rank(incoming.EnemyEnergy(), energyThreatRadius);
+    }
+    else {
+        for (float radius = energySearchRadius;; radius = std::min(radius * 2.0f, energyThreatRadius)) {
+            projectiles.energyGrid.QueryRadius({sx, sy}, radius, nearby);
+            rank(nearby, radius);
+            if ((int)ranked.size() >= maxEnergyThreats || radius >= energyThreatRadius) break;
+        }
+    }
+
+    int kept = std::min((int)ranked.size(), maxEnergyThreats);
+    std::partial_sort(ranked.begin(), ranked.begin() + kept, ranked.end());
+
+    energy.clear();
+    for (int k = 0; k < kept; k++) {
+        energy.push_back(ranked[k].second);
+    }
+}
+
+const IncomingBullet* ShipThreats::BulletAt(float y, float tolerance, float window) const {
+    const IncomingBullet* best = nullptr;
+
+    int from = std::max(BandOf(y - tolerance), firstBand);
+    int to = std::min(BandOf(y + tolerance), firstBand + (int)bandSoonest.size() - 1);
+    for (int band = from; band <= to; band++) {
+        const IncomingBullet& bullet = bandSoonest[band - firstBand];
+        if (bullet.time > window || std::fabs(bullet.y - y) > tolerance) continue;
+        if (!best || bullet.time < best->time) best = &bullet;
+    }
+    return best;
+}
+
+const std::vector<IncomingBullet>& ShipThreats::Bullets() const {
+    return bullets;
+}
+
+const std::vector<int>& ShipThreats::Energy() const {
+    return energy;
+}
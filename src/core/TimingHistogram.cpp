@@ -0,0 +1,72 @@
+#include "core/TimingHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Octave from the top bit, quarter from the two bits below it. Durations
+// under 4 ns get a bucket each
+int TimingHistogram::BucketOf(uint64_t nanoseconds) {
+    if (nanoseconds < subBuckets) return (int)nanoseconds;
+
+    int octave = 63 - __builtin_clzll(nanoseconds);
+    int quarter = (int)(nanoseconds >> (octave - 2)) & (subBuckets - 1);
+    return octave * subBuckets + quarter;
+}
+
+double TimingHistogram::BucketMiddle(int bucket) {
+    if (bucket < subBuckets) return bucket;
+
+    int octave = bucket / subBuckets;
+    int quarter = bucket % subBuckets;
+    double low = std::ldexp(1.0 + quarter / (double)subBuckets, octave);
+    double width = std::ldexp(1.0 / subBuckets, octave);
+    return low + width / 2;
+}
+
+void TimingHistogram::Record(uint64_t nanoseconds) {
+    buckets[BucketOf(nanoseconds)]++;
+    count++;
+    total += nanoseconds;
+    max = std::max(max, nanoseconds);
+}
+
+void TimingHistogram::Merge(const TimingHistogram& other) {
+    for (int i = 0; i < bucketCount; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    total += other.total;
+    max = std::max(max, other.max);
+}
+
+void TimingHistogram::Clear() {
+    buckets.fill(0);
+    count = 0;
+    total = 0;
+    max = 0;
+}
+
+uint64_t TimingHistogram::Count() const {
+    return count;
+}
+
+uint64_t TimingHistogram::Max() const {
+    return max;
+}
+
+double TimingHistogram::Mean() const {
+    return count > 0 ? (double)total / count : 0.0;
+}
+
+double TimingHistogram::Percentile(double q) const {
+    if (count == 0) return 0.0;
+
+    uint64_t rank = (uint64_t)std::ceil(std::clamp(q, 0.0, 1.0) * count);
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(BucketMiddle(i), (double)max);
+    }
+    return (double)max;
+}
@@ -0,0 +1,223 @@
+#include "core/Tuner.hpp"
+#include "core/BatchRunner.hpp"
+#include "core/CMAES.hpp"
+#include "core/Random.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// "SBTN", then the version, seed and CMAES state
+static const uint32_t checkpointMagic = 0x4E544253;
+static const uint8_t checkpointVersion = 1;
+
+static std::vector<double> ToUnit(const AIParams& params) {
+    AIParams copy = params;
+    std::vector<double> unit;
+    for (const AIParamInfo& info : AIParamTable()) {
+        unit.push_back(std::clamp((info.field(copy) - info.min) / (double)(info.max - info.min), 0.0, 1.0));
+    }
+    return unit;
+}
+
+static AIParams FromUnit(const std::vector<double>& unit) {
+    AIParams params;
+    const std::vector<AIParamInfo>& table = AIParamTable();
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i].field(params) = (float)(table[i].min + unit[i] * (table[i].max - table[i].min));
+    }
+    return params;
+}
+
+struct Tally {
+    long wins = 0;
+    long draws = 0;
+    long matches = 0;
+    double damageDealt = 0.0;
+    double damageTaken = 0.0;
+
+    double Score() const {
+        return matches > 0 ? (wins + 0.5 * draws) / matches : 0.0;
+    }
+};
+
+// Plays every candidate against the reference, matches times each, on
+// seeds drawn from seed. Match 2k and 2k + 1 share a seed with sides swapped
+static std::vector<Tally> Evaluate(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const TunerOptions& options,
+                                   const std::vector<AIParams>& candidates, int matches, uint64_t seed) {
+    BatchOptions batch;
+    batch.match = options.match;
+    batch.threads = options.threads;
+    batch.progress = options.progress;
+
+    // Two groups a candidate, for its matches as red and as yellow
+    BatchSetup setup = [&](int index, HeadlessOptions& match, uint64_t& matchSeed) {
+        int c = index / matches;
+        int i = index % matches;
+        bool candidateRed = i % 2 == 0;
+
+        match.redParams = candidateRed ? candidates[c] : options.reference;
+        match.yellowParams = candidateRed ? options.reference : candidates[c];
+        matchSeed = Random::MixSeed(seed, (uint64_t)(i / 2));
+        return c * 2 + (candidateRed ? 1 : 0);
+    };
+    std::vector<BatchStats> stats = RunBatchGroups(yellowAssets, redAssets, batch,
+        (int)candidates.size() * matches, (int)candidates.size() * 2, setup);
+
+    std::vector<Tally> tallies(candidates.size());
+    for (size_t c = 0; c < tallies.size(); c++) {
+        const BatchStats& asYellow = stats[c * 2];
+        const BatchStats& asRed = stats[c * 2 + 1];
+        tallies[c].wins = asRed.redWins + asYellow.yellowWins;
+        tallies[c].draws = asRed.draws + asYellow.draws;
+        tallies[c].matches = asRed.matches + asYellow.matches;
+        tallies[c].damageDealt = asRed.redDamage + asYellow.yellowDamage;
+        tallies[c].damageTaken = asRed.yellowDamage + asYellow.redDamage;
+    }
+    return tallies;
+}
+
+// Written next to the checkpoint and renamed over it, so an interrupted
+// write never leaves a broken checkpoint behind
+static bool SaveCheckpoint(const std::string& path, const CMAES& search, uint64_t seed) {
+    ByteWriter out;
+    out.U32(checkpointMagic);
+    out.U8(checkpointVersion);
+    out.U64(seed);
+    search.SaveState(out);
+
+    std::string temp = path + ".tmp";
+    return WriteFileBytes(temp, out.bytes) && std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+static bool LoadCheckpoint(const std::string& path, CMAES& search, uint64_t& seed) {
+    std::vector<uint8_t> bytes;
+    if (!ReadFileBytes(path, bytes)) return false;
+
+    ByteReader in(bytes);
+    if (in.U32() != checkpointMagic || in.U8() != checkpointVersion) return false;
+    seed = in.U64();
+    return search.LoadState(in);
+}
+
+int RunTuner(const ShipAssets& yellowAssets, const ShipAssets& redAssets, const TunerOptions& options) {
+    uint64_t seed = options.seed;
+    CMAES search(ToUnit(options.start), options.sigma, options.population, seed);
+
+    if (LoadCheckpoint(options.checkpointPath, search, seed)) {
+        std::printf("resuming %s at generation %d\n", options.checkpointPath.c_str(), search.Generation());
+    }
+    else {
+        // Start afresh, in case a half read checkpoint got part way into the state
+        search = CMAES(ToUnit(options.start), options.sigma, options.population, seed);
+    }
+
+    int threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+    std::printf("%zu parameters, %d candidates a generation, %d matches each, %d threads\n",
+        AIParamTable().size(), search.Population(), options.matchesPerCandidate, threads);
+
+    while (search.Generation() < options.generations) {
+        auto start = std::chrono::steady_clock::now();
+        int generation = search.Generation();
+
+        const std::vector<std::vector<double>>& population = search.Ask();
+        std::vector<AIParams> candidates;
+        for (const std::vector<double>& unit : population) {
+            candidates.push_back(FromUnit(unit));
+        }
+
+        uint64_t generationSeed = Random::MixSeed(seed, (uint64_t)generation);
+        std::vector<Tally> tallies = Evaluate(yellowAssets, redAssets, options, candidates, options.matchesPerCandidate, generationSeed);
+
+        std::vector<double> scores;
+        for (const Tally& tally : tallies) {
+            scores.push_back(tally.Score());
+        }
+        search.Tell(scores);
+
+        double best = *std::max_element(scores.begin(), scores.end());
+        double mean = 0.0;
+        for (double score : scores) mean += score / scores.size();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("generation %d: best %.2f%%, mean %.2f%%, sigma %.4f, %.1fs\n",
+            generation + 1, best * 100.0, mean * 100.0, search.Sigma(), seconds);
+        std::fflush(stdout);
+
+        if (!SaveCheckpoint(options.checkpointPath, search, seed)) {
+            std::fprintf(stderr, "could not write checkpoint %s\n", options.checkpointPath.c_str());
+            return 1;
+        }
+        if (!FromUnit(search.Mean()).Save(options.outPath)) {
+            std::fprintf(stderr, "could not write %s\n", options.outPath.c_str());
+            return 1;
+        }
+    }
+
+    // The best candidate of a generation is partly the luckiest, so the
+    // mean is the answer, checked on seeds no candidate has seen
+    if (options.validationMatches > 0) {
+        std::vector<AIParams> result = {FromUnit(search.Mean())};
+        uint64_t validationSeed = Random::MixSeed(seed, ~(uint64_t)0);
+        Tally tally = Evaluate(yellowAssets, redAssets, options, result, options.validationMatches, validationSeed)[0];
+
+        double p = tally.Score();
+        double margin = 1.96 * std::sqrt(p * (1.0 - p) / tally.matches);
+        std::printf("%s vs reference: %.2f%% +- %.2f%% over %ld matches, damage dealt %.1f taken %.1f a match\n",
+            options.outPath.c_str(), p * 100.0, margin * 100.0, tally.matches,
+            tally.damageDealt / tally.matches, tally.damageTaken / tally.matches);
+    }
+    return 0;
+}
+
+static void PrintUsage() {
+    std::printf("usage: main --tune [--generations N] [--population N] [--matches N] [--validate N] [--threads N]\n");
+    std::printf("                   [--sigma FRACTION] [--seed N] [--start FILE] [--reference FILE]\n");
+    std::printf("                   [--checkpoint FILE] [--out FILE] [--dt SECONDS] [--max-time SECONDS] [--quiet]\n");
+}
+
+int RunTuneCommand(int argc, char** argv) {
+    TunerOptions options;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--generations" && hasValue) options.generations = std::atoi(argv[++i]);
+        else if (arg == "--population" && hasValue) options.population = std::atoi(argv[++i]);
+        else if (arg == "--matches" && hasValue) options.matchesPerCandidate = std::atoi(argv[++i]);
+        else if (arg == "--validate" && hasValue) options.validationMatches = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = std::atoi(argv[++i]);
+        else if (arg == "--sigma" && hasValue) options.sigma = std::atof(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--checkpoint" && hasValue) options.checkpointPath = argv[++i];
+        else if (arg == "--out" && hasValue) options.outPath = argv[++i];
+        else if (arg == "--dt" && hasValue) options.match.dt = (float)std::atof(argv[++i]);
+        else if (arg == "--max-time" && hasValue) options.match.maxMatchTime = std::atof(argv[++i]);
+        else if ((arg == "--start" || arg == "--reference") && hasValue) {
+            AIParams& params = arg == "--start" ? options.start : options.reference;
+            if (!params.Load(argv[++i])) {
+                std::fprintf(stderr, "could not read AI params %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (arg == "--quiet") options.progress = false;
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (options.generations < 0 || options.population < 0 || options.population == 1 || options.matchesPerCandidate < 2 ||
+        options.validationMatches < 0 || options.threads < 0 || options.sigma <= 0.0 || options.match.dt <= 0.0f) {
+        PrintUsage();
+        return 1;
+    }
+
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+    return RunTuner(yellowAssets, redAssets, options);
+}
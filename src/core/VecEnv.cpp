@@ -0,0 +1,196 @@
+#include "core/VecEnv.hpp"
+#include "core/Headless.hpp"
+#include "core/Random.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+// Envs per job. Small enough that a batch spreads over every thread
+const int minEnvGrain = 4;
+
+ControlState ActionController::GetState(const SimClock& clock) {
+    (void)clock;
+    return action;
+}
+
+VecEnv::VecEnv(const VecEnvOptions& envOptions)
+    : options(envOptions), envs(std::max(1, envOptions.envs)) {
+    ShipAssets yellowAssets = LoadHeadlessShipAssets(Side::LEFT);
+    ShipAssets redAssets = LoadHeadlessShipAssets(Side::RIGHT);
+    Side opponentSide = options.learnerSide == Side::LEFT ? Side::RIGHT : Side::LEFT;
+
+    for (size_t i = 0; i < envs.size(); i++) {
+        Env& env = envs[i];
+        env.match = std::make_unique<Match>(GameMode::NoPlayer, yellowAssets, redAssets, audio, Random::MixSeed(options.seed, i));
+        env.match->SetAIParams(opponentSide, options.opponent);
+
+        env.learner = options.learnerSide == Side::LEFT ? env.match->yellowShip : env.match->redShip;
+        env.opponent = options.learnerSide == Side::LEFT ? env.match->redShip : env.match->yellowShip;
+        auto controller = std::make_unique<ActionController>();
+        env.controller = controller.get();
+        env.learner->controller = std::move(controller);
+
+        env.fullHealth = env.learner->health;
+    }
+
+    if (options.threads != 1) jobs = std::make_unique<JobSystem>(options.threads);
+
+    stepRange = [this](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            StepEnv(envs[i], stepActions[i], stepObservations + (size_t)i * observationSize, stepRewards[i], stepEnds[i]);
+        }
+    };
+}
+
+int VecEnv::Size() const {
+    return (int)envs.size();
+}
+
+long VecEnv::Steps() const {
+    return steps;
+}
+
+void VecEnv::Reset(float* observations) {
+    for (size_t i = 0; i < envs.size(); i++) {
+        ResetEnv(envs[i]);
+        observation::Write(*envs[i].learner, *envs[i].opponent, envs[i].fullHealth, observations + (size_t)i * observationSize);
+    }
+}
+
+void VecEnv::ResetEnv(Env& env) {
+    env.match->Reset();
+    env.controller->action = ControlState();
+    env.learnerHealth = env.learner->health;
+    env.opponentHealth = env.opponent->health;
+}
+
+void VecEnv::Step(const ControlState* actions, float* observations, float* rewards, EpisodeEnd* ends) {
+    stepActions = actions;
+    stepObservations = observations;
+    stepRewards = rewards;
+    stepEnds = ends;
+
+    int count = (int)envs.size();
+    if (jobs) jobs->ParallelFor(count, std::max(minEnvGrain, count / (jobs->ThreadCount() * 4)), stepRange);
+    else stepRange(0, count);
+
+    steps += count;
+}
+
+void VecEnv::StepEnv(Env& env, const ControlState& action, float* out, float& reward, EpisodeEnd& end) {
+    Match& match = *env.match;
+
+    env.controller->action = action;
+    if (options.learnerSide == Side::RIGHT) env.controller->action.moveX = -action.moveX;
+
+    for (int t = 0; t < options.ticksPerStep && !match.IsOver(); t++) {
+        match.Step(options.dt);
+    }
+
+    float learnerHealth = std::max(env.learner->health, 0.0f);
+    float opponentHealth = std::max(env.opponent->health, 0.0f);
+    reward = ((env.opponentHealth - opponentHealth) - (env.learnerHealth - learnerHealth)) / env.fullHealth;
+    env.learnerHealth = learnerHealth;
+    env.opponentHealth = opponentHealth;
+
+    end = EpisodeEnd::Running;
+    if (match.IsOver()) {
+        Winner learnerWins = options.learnerSide == Side::LEFT ? Winner::Yellow : Winner::Red;
+        reward += match.GetWinner() == learnerWins ? 1.0f : -1.0f;
+        end = EpisodeEnd::Terminated;
+    }
+    else if (match.GetClock().time >= options.maxEpisodeTime) {
+        end = EpisodeEnd::Truncated;
+    }
+
+    if (end != EpisodeEnd::Running) ResetEnv(env);
+    observation::Write(*env.learner, *env.opponent, env.fullHealth, out);
+}
+
+// Steps a VecEnv with random actions, as a training loop would, and reports
+// env steps a second and how the episodes went
+static int RunEnvBench(int envCount, long stepCount, const HeadlessOptions& options) {
+    VecEnvOptions envOptions;
+    envOptions.envs = envCount;
+    envOptions.threads = options.jobThreads;
+    envOptions.dt = options.dt;
+    envOptions.seed = options.seed;
+    VecEnv env(envOptions);
+
+    std::vector<ControlState> actions(envCount);
+    std::vector<float> observations((size_t)envCount * VecEnv::observationSize);
+    std::vector<float> rewards(envCount);
+    std::vector<EpisodeEnd> ends(envCount);
+    Random random(options.seed);
+
+    env.Reset(observations.data());
+
+    long wins = 0, terminated = 0, truncated = 0;
+    double rewardSum = 0.0, seconds = 0.0;
+    for (long step = 0; step < stepCount; step++) {
+        for (ControlState& action : actions) {
+            uint64_t bits = random.Next();
+            action.moveX = (float)((int)(bits % 3) - 1);
+            action.moveY = (float)((int)((bits >> 16) % 3) - 1);
+            action.shootBullet = ((bits >> 4) & 7) == 0;
+            action.shootEnergy = ((bits >> 7) & 63) == 0;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        env.Step(actions.data(), observations.data(), rewards.data(), ends.data());
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (int i = 0; i < envCount; i++) {
+            rewardSum += rewards[i];
+            if (ends[i] == EpisodeEnd::Terminated) {
+                terminated++;
+                if (rewards[i] > 0.0f) wins++;
+            }
+            else if (ends[i] == EpisodeEnd::Truncated) truncated++;
+        }
+    }
+
+    std::printf("%d envs, %d threads, %ld steps, %d floats per observation\n",
+        envCount, options.jobThreads > 0 ? options.jobThreads : (int)std::thread::hardware_concurrency(),
+        env.Steps(), VecEnv::observationSize);
+    std::printf("%.0f env steps/s, %.2f us per env step\n",
+        seconds > 0.0 ? env.Steps() / seconds : 0.0, env.Steps() > 0 ? seconds / env.Steps() * 1e6 : 0.0);
+    std::printf("%ld episodes terminated, %ld won by the random learner, %ld truncated, %.5f reward per env step\n",
+        terminated, wins, truncated, env.Steps() > 0 ? rewardSum / env.Steps() : 0.0);
+    return 0;
+}
+
+static void PrintEnvBenchUsage() {
+    std::printf("usage: main --headless --env-bench ENVS [--steps N] [--dt SECONDS] [--jobs THREADS] [--seed N]\n");
+}
+
+int RunEnvBenchCommand(int argc, char** argv) {
+    int envs = 0;
+    long steps = 1000;
+    HeadlessOptions options;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--env-bench" && hasValue) envs = std::atoi(argv[++i]);
+        else if (arg == "--steps" && hasValue) steps = std::atol(argv[++i]);
+        else if (arg == "--dt" && hasValue) options.dt = (float)std::atof(argv[++i]);
+        else if (arg == "--jobs" && hasValue) options.jobThreads = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            PrintEnvBenchUsage();
+            return 1;
+        }
+    }
+
+    if (envs <= 0 || options.dt <= 0.0f || options.jobThreads < 0) {
+        PrintEnvBenchUsage();
+        return 1;
+    }
+
+    return RunEnvBench(envs, std::max(1L, steps), options);
+}
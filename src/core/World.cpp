@@ -0,0 +1,372 @@
+#include "core/World.hpp"
+#include "core/weapons.hpp"
+#include "core/mathUtils.hpp"
+#include "core/config.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// Ships look for a closer enemy this often, staggered by id so they don't all do it on the same tick
+const int retargetInterval = 30;
+
+// Items per job when a stage is split over threads
+const int shipGrain = 16;
+const int projectileGrain = 256;
+
+World::World(IAudioSink& audioSink, int maxShips)
+    : projectiles(maxShips), audio(audioSink) {
+    ships.reserve(maxShips);
+    shipCenters.reserve(maxShips);
+    BuildStepGraph();
+}
+
+Spaceship& World::AddShip(const ShipAssets& assets, Side team, std::unique_ptr<IController> controller) {
+    uint16_t id = (uint16_t)ships.size();
+    ships.push_back(std::make_unique<Spaceship>(
+        assets.shipImage, assets.shipSize, team, id, projectiles, audio, assets.energyImage, std::move(controller)
+    ));
+    ships.back()->danger = &dangerFields[(int)team];
+    shipCenters.push_back(ships.back()->GetCenter());
+    aiScheduler.Resize((int)ships.size());
+    thinkTimes.resize(ships.size());
+    return *ships.back();
+}
+
+Spaceship* World::SelectTarget(const Spaceship& ship) const {
+    Vector2 center = ship.GetCenter();
+    Spaceship* best = nullptr;
+    float bestDist2 = 0.0f;
+
+    for (auto& other : ships) {
+        if (other->shipSide == ship.shipSide || other->IsDead()) continue;
+
+        Vector2 otherCenter = other->GetCenter();
+        float dx = otherCenter.x - center.x;
+        float dy = otherCenter.y - center.y;
+        float dist2 = dx * dx + dy * dy;
+
+        if (!best || dist2 < bestDist2) {
+            best = other.get();
+            bestDist2 = dist2;
+        }
+    }
+    return best;
+}
+
+void World::UpdateTargets(long tick) {
+    ParallelFor((int)ships.size(), shipGrain, [this, tick](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            Spaceship& ship = *ships[i];
+            if (ship.IsDead()) continue;
+
+            bool lostTarget = !ship.target || ship.target->IsDead();
+            if (lostTarget || (tick + ship.id) % retargetInterval == 0) {
+                Spaceship* target = SelectTarget(ship);
+                // Keep aiming at the last enemy rather than at nothing once a team is wiped out
+                if (target) ship.target = target;
+            }
+        }
+    });
+}
+
+void World::SetJobSystem(JobSystem* jobSystem) {
+    jobs = jobSystem;
+}
+
+void World::SetAIThinkBudget(float microseconds) {
+    aiScheduler.SetBudget(microseconds);
+}
+
+const AIScheduler& World::GetAIScheduler() const {
+    return aiScheduler;
+}
+
+void World::SetThinkTiming(bool enabled) {
+    timeThinks = enabled;
+}
+
+const TimingHistogram& World::GetThinkTimes(int ship) const {
+    return thinkTimes[ship];
+}
+
+const TimingHistogram& World::GetThinkStageTimes() const {
+    return thinkStageTimes;
+}
+
+void World::ParallelFor(int count, int grain, const std::function<void(int, int)>& fn) {
+    if (jobs) jobs->ParallelFor(count, grain, fn);
+    else fn(0, count);
+}
+
+// One tick as a graph of stages. Every ship thinks before any of them acts,
+// so no ship sees another's move from the same tick, whichever order they
+// run in. Stages that write shared state (acting, culling, applying hits)
+// stay single threaded and walk ships in id order, which keeps the result
+// the same with or without a job system. Threats are gathered alongside
+// targeting, first per side along with its danger field and then per ship,
+// and bullets and energy weapons are moved, culled and gridded side by side.
+void World::BuildStepGraph() {
+    auto save = stepGraph.Add([this]() {
+        for (auto& ship : ships) {
+            ship->SavePreviousState();
+        }
+        projectiles.SavePrevious();
+    });
+
+    auto targets = stepGraph.Add([this]() { UpdateTargets(stepTick); }, {save});
+
+    auto incoming = stepGraph.Add([this]() {
+        ParallelFor(2, 1, [this](int begin, int end) {
+            for (int side = begin + 1; side <= end; side++) {
+                teamThreats[side].Build((uint8_t)side, projectiles);
+                dangerFields[side].Build((uint8_t)side, projectiles);
+            }
+        });
+    }, {save});
+
+    auto threats = stepGraph.Add([this]() {
+        ParallelFor((int)ships.size(), shipGrain, [this](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                Spaceship& ship = *ships[i];
+                if (!ship.IsDead()) ship.AnalyzeThreats(teamThreats[(int)ship.shipSide], stepClock.dt);
+            }
+        });
+    }, {incoming});
+
+    // Ships the scheduler passes over keep their last movement, and the
+    // next think is told how long it has been. Batches shared by the
+    // thinking ships run first, each once, in the order of their first ship
+    auto think = stepGraph.Add([this]() {
+        auto stageStart = std::chrono::steady_clock::now();
+        aiScheduler.Schedule(ships, stepTick);
+
+        thinkBatches.clear();
+        for (auto& ship : ships) {
+            if (ship->IsDead() || !aiScheduler.Thinks(ship->id)) continue;
+            ThinkBatch* batch = ship->controller->GetThinkBatch();
+            if (batch && std::find(thinkBatches.begin(), thinkBatches.end(), batch) == thinkBatches.end()) {
+                thinkBatches.push_back(batch);
+            }
+        }
+        for (ThinkBatch* batch : thinkBatches) {
+            batch->Run(stepClock, jobs);
+        }
+
+        ParallelFor((int)ships.size(), shipGrain, [this](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                Spaceship& ship = *ships[i];
+                if (ship.IsDead()) continue;
+                if (!aiScheduler.Thinks(i)) {
+                    ship.Coast();
+                    continue;
+                }
+
+                SimClock clock = stepClock;
+                clock.dt = stepClock.dt * aiScheduler.TicksCovered(i);
+                if (!timeThinks) {
+                    ship.Think(clock);
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                ship.Think(clock);
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                thinkTimes[i].Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            }
+        });
+
+        if (timeThinks) {
+            auto elapsed = std::chrono::steady_clock::now() - stageStart;
+            thinkStageTimes.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }, {targets, threats});
+
+    auto act = stepGraph.Add([this]() {
+        for (auto& ship : ships) {
+            if (!ship->IsDead()) ship->Act(stepClock);
+            shipCenters[ship->id] = ship->GetCenter();
+        }
+    }, {think});
+
+    auto moveBullets = stepGraph.Add([this]() {
+        ProjectilePool& bullets = projectiles.bullets;
+        ParallelFor(bullets.Count(), projectileGrain, [this, &bullets](int begin, int end) {
+            weapons::MoveBullets(bullets, stepClock.dt, begin, end);
+        });
+    }, {act});
+
+    auto bulletGrid = stepGraph.Add([this]() {
+        weapons::CullBullets(projectiles.bullets);
+        projectiles.RebuildBulletGrid();
+    }, {moveBullets});
+
+    auto moveEnergy = stepGraph.Add([this]() {
+        ProjectilePool& energy = projectiles.energy;
+        ParallelFor(energy.Count(), projectileGrain, [this, &energy](int begin, int end) {
+            weapons::MoveEnergyWeapons(energy, stepClock, shipCenters.data(), begin, end);
+        });
+    }, {act});
+
+    auto energyGrid = stepGraph.Add([this]() {
+        weapons::CullEnergyWeapons(projectiles.energy);
+        projectiles.RebuildEnergyGrid();
+    }, {moveEnergy});
+
+    auto findHits = stepGraph.Add([this]() {
+        ParallelFor((int)ships.size(), shipGrain, [this](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                if (!ships[i]->IsDead()) ships[i]->FindHits();
+            }
+        });
+    }, {bulletGrid, energyGrid});
+
+    stepGraph.Add([this]() {
+        for (auto& ship : ships) {
+            if (!ship->IsDead()) ship->ApplyHits(ships);
+        }
+        projectiles.RemoveMarked();
+    }, {findHits});
+}
+
+void World::Step(const SimClock& clock, long tick) {
+    stepClock = clock;
+    stepTick = tick;
+
+    if (jobs) jobs->Run(stepGraph);
+    else stepGraph.RunSerial();
+}
+
+void World::Draw(IRenderSink& renderer, float alpha) {
+    #if DEBUG
+    renderer.SetLayer(RenderLayer::Ground);
+    for (int side = 1; side <= 2; side++) {
+        for (int row = 0; row < dangerRows; row++) {
+            for (int column = 0; column < dangerColumns; column++) {
+                float time = dangerFields[side].TimeAt(column, row);
+                if (time < dangerHorizon) renderer.DrawRect(dangerFields[side].CellRect(column, row), Fade(RED, 0.4f * (1.0f - time / dangerHorizon)));
+            }
+        }
+    }
+    #endif
+
+    renderer.SetLayer(RenderLayer::Ships);
+    for (auto& ship : ships) {
+        if (!ship->IsDead()) ship->Draw(renderer, alpha);
+    }
+
+    // One pass per pool, over the ships, colored and textured by the ship that fired
+    renderer.SetLayer(RenderLayer::Projectiles);
+    const ProjectilePool& bullets = projectiles.bullets;
+    for (int i = 0; i < bullets.Count(); i++) {
+        const Spaceship& owner = *ships[bullets.owner[i]];
+
+        Vector2 bulletPos = math::Lerp({bullets.prevX[i], bullets.prevY[i]}, {bullets.x[i], bullets.y[i]}, alpha);
+        renderer.DrawRect({bulletPos.x, bulletPos.y, bulletSize.x, bulletSize.y}, owner.bulletColor);
+    }
+
+    const ProjectilePool& energy = projectiles.energy;
+    for (int i = 0; i < energy.Count(); i++) {
+        const Spaceship& owner = *ships[energy.owner[i]];
+        const Texture2D& sprite = owner.energySprite;
+
+        Vector2 energyPos = math::Lerp({energy.prevX[i], energy.prevY[i]}, {energy.x[i], energy.y[i]}, alpha);
+        Rectangle src = {0, 0, (float)sprite.width, (float)sprite.height};
+        Rectangle dest = {energyPos.x, energyPos.y, (float)sprite.width, (float)sprite.height};
+        Vector2 origin = {(float)sprite.width / 2, (float)sprite.height / 2};
+
+        // Clockwise rotation, with an extra 180 degrees when the sprite is fired from the right hand side
+        float spriteRotation = std::atan2(energy.vy[i], energy.vx[i]) * 180 / M_PI;
+        if (owner.shipSide == Side::RIGHT) spriteRotation += 180;
+
+        renderer.DrawSprite(sprite, src, dest, origin, spriteRotation, owner.energyColor);
+
+        #if DEBUG
+        renderer.DrawCircle(energyPos, energyRadius, Fade(owner.energyColor, 0.5f));
+        #endif
+    }
+}
+
+void World::Reset() {
+    for (auto& ship : ships) {
+        ship->Reset();
+        ship->target = nullptr;
+    }
+    projectiles.Clear();
+    aiScheduler.Resize((int)ships.size());
+}
+
+void World::SaveState(ByteWriter& out) const {
+    out.Varint(ships.size());
+    for (auto& ship : ships) {
+        ship->SaveState(out);
+        out.SignedVarint(ship->target ? ship->target->id : -1);
+    }
+    projectiles.SaveState(out);
+    aiScheduler.SaveState(out);
+}
+
+bool World::LoadState(ByteReader& in) {
+    if (in.Varint() != ships.size()) return false;
+
+    for (auto& ship : ships) {
+        ship->LoadState(in);
+        int64_t target = in.SignedVarint();
+        if (target >= (int64_t)ships.size()) return false;
+        ship->target = target >= 0 ? ships[target].get() : nullptr;
+        shipCenters[ship->id] = ship->GetCenter();
+    }
+
+    return projectiles.LoadState(in) && aiScheduler.LoadState(in) && in.ok;
+}
+
+TeamStats World::GetTeamStats(Side team) const {
+    TeamStats stats;
+    for (auto& ship : ships) {
+        if (ship->shipSide != team) continue;
+
+        stats.ships++;
+        stats.score += ship->score;
+        stats.damageDealt += ship->damageDealt;
+        if (!ship->IsDead()) {
+            stats.alive++;
+            stats.health += ship->health;
+        }
+    }
+    return stats;
+}
+
+// FNV-1a over the raw bytes, so any bit of drift changes the result
+static void HashBytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+}
+
+static void HashPool(uint64_t& hash, const ProjectilePool& pool) {
+    size_t n = (size_t)pool.Count();
+    HashBytes(hash, &n, sizeof(n));
+    HashBytes(hash, pool.x.data(), n * sizeof(float));
+    HashBytes(hash, pool.y.data(), n * sizeof(float));
+    HashBytes(hash, pool.vx.data(), n * sizeof(float));
+    HashBytes(hash, pool.vy.data(), n * sizeof(float));
+    HashBytes(hash, pool.owner.data(), n * sizeof(pool.owner[0]));
+}
+
+uint64_t World::Checksum() const {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (auto& ship : ships) {
+        int target = ship->target ? ship->target->id : -1;
+        HashBytes(hash, &ship->shipRect, sizeof(ship->shipRect));
+        HashBytes(hash, &ship->velocity, sizeof(ship->velocity));
+        HashBytes(hash, &ship->health, sizeof(ship->health));
+        HashBytes(hash, &ship->score, sizeof(ship->score));
+        HashBytes(hash, &target, sizeof(target));
+    }
+
+    HashPool(hash, projectiles.bullets);
+    HashPool(hash, projectiles.energy);
+    return hash;
+}
@@ -0,0 +1,453 @@
+#include "core/batchKernels.hpp"
+#include "core/config.h"
+#include "core/weapons.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define KERNELS_X86 0
+#endif
+
+namespace kernels {
+    // Scalar versions. Also used for the tail of every vector loop.
+
+    static void IntegrateScalar(float* x, float* y, const float* vx, const float* vy, int start, int n, float dt) {
+        for (int i = start; i < n; i++) {
+            x[i] += vx[i] * dt;
+            y[i] += vy[i] * dt;
+        }
+    }
+
+    static int OverlapBoxesScalar(const float* x, const float* y, int start, int n, float w, float h, Rectangle rect, uint8_t* mask) {
+        int hits = 0;
+        for (int i = start; i < n; i++) {
+            // Same comparisons as the vector versions, so edge cases round identically
+            bool hit = x[i] < rect.x + rect.width && x[i] > rect.x - w &&
+                       y[i] < rect.y + rect.height && y[i] > rect.y - h;
+            mask[i] = hit;
+            hits += hit;
+        }
+        return hits;
+    }
+
+    // Distance from the circle center to the closest point of the rect,
+    // compared against the radius
+    static int OverlapCirclesScalar(const float* x, const float* y, int start, int n, float radius, Rectangle rect, uint8_t* mask) {
+        float halfW = rect.width / 2, halfH = rect.height / 2;
+        float cx = rect.x + halfW, cy = rect.y + halfH;
+        float r2 = radius * radius;
+
+        int hits = 0;
+        for (int i = start; i < n; i++) {
+            float dx = x[i] - cx;
+            float dy = y[i] - cy;
+            dx = dx < 0 ? -dx : dx;
+            dy = dy < 0 ? -dy : dy;
+            float qx = dx - halfW > 0 ? dx - halfW : 0;
+            float qy = dy - halfH > 0 ? dy - halfH : 0;
+            bool hit = qx * qx + qy * qy <= r2;
+            mask[i] = hit;
+            hits += hit;
+        }
+        return hits;
+    }
+
+    static void DenseScalar(const float* in, int rows, int inputs, const float* weights, const float* bias, int outputs, bool relu, float* out) {
+        for (int r = 0; r < rows; r++) {
+            const float* x = in + (size_t)r * inputs;
+            float* y = out + (size_t)r * outputs;
+            for (int o = 0; o < outputs; o++) {
+                y[o] = bias[o];
+            }
+            for (int i = 0; i < inputs; i++) {
+                const float* w = weights + (size_t)i * outputs;
+                for (int o = 0; o < outputs; o++) {
+                    y[o] += x[i] * w[o];
+                }
+            }
+            if (!relu) continue;
+            for (int o = 0; o < outputs; o++) {
+                y[o] = y[o] > 0.0f ? y[o] : 0.0f;
+            }
+        }
+    }
+
+#if KERNELS_X86
+    // Writes the low bits of a movemask into 4 or 8 mask bytes
+    static inline int StoreMask(int bits, int lanes, uint8_t* mask) {
+        for (int l = 0; l < lanes; l++) {
+            mask[l] = (bits >> l) & 1;
+        }
+        return __builtin_popcount(bits);
+    }
+
+    static void IntegrateSSE(float* x, float* y, const float* vx, const float* vy, int n, float dt) {
+        __m128 step = _mm_set1_ps(dt);
+        int i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 px = _mm_loadu_ps(x + i);
+            __m128 py = _mm_loadu_ps(y + i);
+            px = _mm_add_ps(px, _mm_mul_ps(_mm_loadu_ps(vx + i), step));
+            py = _mm_add_ps(py, _mm_mul_ps(_mm_loadu_ps(vy + i), step));
+            _mm_storeu_ps(x + i, px);
+            _mm_storeu_ps(y + i, py);
+        }
+        IntegrateScalar(x, y, vx, vy, i, n, dt);
+    }
+
+    static int OverlapBoxesSSE(const float* x, const float* y, int n, float w, float h, Rectangle rect, uint8_t* mask) {
+        __m128 left = _mm_set1_ps(rect.x - w);
+        __m128 right = _mm_set1_ps(rect.x + rect.width);
+        __m128 top = _mm_set1_ps(rect.y - h);
+        __m128 bottom = _mm_set1_ps(rect.y + rect.height);
+
+        int hits = 0;
+        int i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 px = _mm_loadu_ps(x + i);
+            __m128 py = _mm_loadu_ps(y + i);
+            __m128 inX = _mm_and_ps(_mm_cmplt_ps(px, right), _mm_cmpgt_ps(px, left));
+            __m128 inY = _mm_and_ps(_mm_cmplt_ps(py, bottom), _mm_cmpgt_ps(py, top));
+            hits += StoreMask(_mm_movemask_ps(_mm_and_ps(inX, inY)), 4, mask + i);
+        }
+        return hits + OverlapBoxesScalar(x, y, i, n, w, h, rect, mask);
+    }
+
+    static int OverlapCirclesSSE(const float* x, const float* y, int n, float radius, Rectangle rect, uint8_t* mask) {
+        float halfW = rect.width / 2, halfH = rect.height / 2;
+        __m128 cx = _mm_set1_ps(rect.x + halfW);
+        __m128 cy = _mm_set1_ps(rect.y + halfH);
+        __m128 hw = _mm_set1_ps(halfW);
+        __m128 hh = _mm_set1_ps(halfH);
+        __m128 r2 = _mm_set1_ps(radius * radius);
+        __m128 zero = _mm_setzero_ps();
+        __m128 signBit = _mm_set1_ps(-0.0f);
+
+        int hits = 0;
+        int i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 dx = _mm_andnot_ps(signBit, _mm_sub_ps(_mm_loadu_ps(x + i), cx));
+            __m128 dy = _mm_andnot_ps(signBit, _mm_sub_ps(_mm_loadu_ps(y + i), cy));
+            __m128 qx = _mm_max_ps(_mm_sub_ps(dx, hw), zero);
+            __m128 qy = _mm_max_ps(_mm_sub_ps(dy, hh), zero);
+            __m128 d2 = _mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy));
+            hits += StoreMask(_mm_movemask_ps(_mm_cmple_ps(d2, r2)), 4, mask + i);
+        }
+        return hits + OverlapCirclesScalar(x, y, i, n, radius, rect, mask);
+    }
+
+    // R rows by C vectors of outputs starting at column o, held in registers
+    // while the inputs stream past. Each weight load is shared by R rows
+    template <int R, int C>
+    static void DenseBlockSSE(const float* in, int inputs, const float* weights, const float* bias, int outputs, int o, bool relu, float* out) {
+        __m128 acc[R][C];
+        #pragma GCC unroll 8
+        for (int c = 0; c < C; c++) {
+            __m128 b = _mm_loadu_ps(bias + o + 4 * c);
+            #pragma GCC unroll 8
+            for (int r = 0; r < R; r++) acc[r][c] = b;
+        }
+        for (int i = 0; i < inputs; i++) {
+            __m128 w[C];
+            #pragma GCC unroll 8
+            for (int c = 0; c < C; c++) w[c] = _mm_loadu_ps(weights + (size_t)i * outputs + o + 4 * c);
+            #pragma GCC unroll 8
+            for (int r = 0; r < R; r++) {
+                __m128 x = _mm_set1_ps(in[(size_t)r * inputs + i]);
+                #pragma GCC unroll 8
+                for (int c = 0; c < C; c++) acc[r][c] = _mm_add_ps(acc[r][c], _mm_mul_ps(x, w[c]));
+            }
+        }
+        __m128 zero = _mm_setzero_ps();
+        #pragma GCC unroll 8
+        for (int r = 0; r < R; r++) {
+            #pragma GCC unroll 8
+            for (int c = 0; c < C; c++) {
+                _mm_storeu_ps(out + (size_t)r * outputs + o + 4 * c, relu ? _mm_max_ps(acc[r][c], zero) : acc[r][c]);
+            }
+        }
+    }
+
+    // Four rows at a time, then one row at a time with more columns in
+    // flight so the adds don't wait on each other
+    static void DenseSSE(const float* in, int rows, int inputs, const float* weights, const float* bias, int outputs, bool relu, float* out) {
+        int r = 0;
+        for (; r + 4 <= rows; r += 4) {
+            const float* x = in + (size_t)r * inputs;
+            float* y = out + (size_t)r * outputs;
+            for (int o = 0; o < outputs; o += 8) {
+                DenseBlockSSE<4, 2>(x, inputs, weights, bias, outputs, o, relu, y);
+            }
+        }
+        for (; r < rows; r++) {
+            const float* x = in + (size_t)r * inputs;
+            float* y = out + (size_t)r * outputs;
+            int o = 0;
+            for (; o + 16 <= outputs; o += 16) DenseBlockSSE<1, 4>(x, inputs, weights, bias, outputs, o, relu, y);
+            for (; o < outputs; o += 8) DenseBlockSSE<1, 2>(x, inputs, weights, bias, outputs, o, relu, y);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void IntegrateAVX2(float* x, float* y, const float* vx, const float* vy, int n, float dt) {
+        __m256 step = _mm256_set1_ps(dt);
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 px = _mm256_loadu_ps(x + i);
+            __m256 py = _mm256_loadu_ps(y + i);
+            // mul then add rather than fma, so every backend rounds the same way
+            px = _mm256_add_ps(px, _mm256_mul_ps(_mm256_loadu_ps(vx + i), step));
+            py = _mm256_add_ps(py, _mm256_mul_ps(_mm256_loadu_ps(vy + i), step));
+            _mm256_storeu_ps(x + i, px);
+            _mm256_storeu_ps(y + i, py);
+        }
+        IntegrateScalar(x, y, vx, vy, i, n, dt);
+    }
+
+    __attribute__((target("avx2")))
+    static int OverlapBoxesAVX2(const float* x, const float* y, int n, float w, float h, Rectangle rect, uint8_t* mask) {
+        __m256 left = _mm256_set1_ps(rect.x - w);
+        __m256 right = _mm256_set1_ps(rect.x + rect.width);
+        __m256 top = _mm256_set1_ps(rect.y - h);
+        __m256 bottom = _mm256_set1_ps(rect.y + rect.height);
+
+        int hits = 0;
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 px = _mm256_loadu_ps(x + i);
+            __m256 py = _mm256_loadu_ps(y + i);
+            __m256 inX = _mm256_and_ps(_mm256_cmp_ps(px, right, _CMP_LT_OQ), _mm256_cmp_ps(px, left, _CMP_GT_OQ));
+            __m256 inY = _mm256_and_ps(_mm256_cmp_ps(py, bottom, _CMP_LT_OQ), _mm256_cmp_ps(py, top, _CMP_GT_OQ));
+            hits += StoreMask(_mm256_movemask_ps(_mm256_and_ps(inX, inY)), 8, mask + i);
+        }
+        return hits + OverlapBoxesScalar(x, y, i, n, w, h, rect, mask);
+    }
+
+    __attribute__((target("avx2")))
+    static int OverlapCirclesAVX2(const float* x, const float* y, int n, float radius, Rectangle rect, uint8_t* mask) {
+        float halfW = rect.width / 2, halfH = rect.height / 2;
+        __m256 cx = _mm256_set1_ps(rect.x + halfW);
+        __m256 cy = _mm256_set1_ps(rect.y + halfH);
+        __m256 hw = _mm256_set1_ps(halfW);
+        __m256 hh = _mm256_set1_ps(halfH);
+        __m256 r2 = _mm256_set1_ps(radius * radius);
+        __m256 zero = _mm256_setzero_ps();
+        __m256 signBit = _mm256_set1_ps(-0.0f);
+
+        int hits = 0;
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 dx = _mm256_andnot_ps(signBit, _mm256_sub_ps(_mm256_loadu_ps(x + i), cx));
+            __m256 dy = _mm256_andnot_ps(signBit, _mm256_sub_ps(_mm256_loadu_ps(y + i), cy));
+            __m256 qx = _mm256_max_ps(_mm256_sub_ps(dx, hw), zero);
+            __m256 qy = _mm256_max_ps(_mm256_sub_ps(dy, hh), zero);
+            __m256 d2 = _mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qy, qy));
+            hits += StoreMask(_mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ)), 8, mask + i);
+        }
+        return hits + OverlapCirclesScalar(x, y, i, n, radius, rect, mask);
+    }
+
+    template <int R, int C>
+    __attribute__((target("avx2")))
+    static void DenseBlockAVX2(const float* in, int inputs, const float* weights, const float* bias, int outputs, int o, bool relu, float* out) {
+        __m256 acc[R][C];
+        #pragma GCC unroll 8
+        for (int c = 0; c < C; c++) {
+            __m256 b = _mm256_loadu_ps(bias + o + 8 * c);
+            #pragma GCC unroll 8
+            for (int r = 0; r < R; r++) acc[r][c] = b;
+        }
+        for (int i = 0; i < inputs; i++) {
+            __m256 w[C];
+            #pragma GCC unroll 8
+            for (int c = 0; c < C; c++) w[c] = _mm256_loadu_ps(weights + (size_t)i * outputs + o + 8 * c);
+            #pragma GCC unroll 8
+            for (int r = 0; r < R; r++) {
+                __m256 x = _mm256_set1_ps(in[(size_t)r * inputs + i]);
+                // mul then add rather than fma, as in IntegrateAVX2
+                #pragma GCC unroll 8
+                for (int c = 0; c < C; c++) acc[r][c] = _mm256_add_ps(acc[r][c], _mm256_mul_ps(x, w[c]));
+            }
+        }
+        __m256 zero = _mm256_setzero_ps();
+        #pragma GCC unroll 8
+        for (int r = 0; r < R; r++) {
+            #pragma GCC unroll 8
+            for (int c = 0; c < C; c++) {
+                _mm256_storeu_ps(out + (size_t)r * outputs + o + 8 * c, relu ? _mm256_max_ps(acc[r][c], zero) : acc[r][c]);
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void DenseAVX2(const float* in, int rows, int inputs, const float* weights, const float* bias, int outputs, bool relu, float* out) {
+        int r = 0;
+        for (; r + 4 <= rows; r += 4) {
+            const float* x = in + (size_t)r * inputs;
+            float* y = out + (size_t)r * outputs;
+            int o = 0;
+            for (; o + 16 <= outputs; o += 16) DenseBlockAVX2<4, 2>(x, inputs, weights, bias, outputs, o, relu, y);
+            for (; o < outputs; o += 8) DenseBlockAVX2<4, 1>(x, inputs, weights, bias, outputs, o, relu, y);
+        }
+        for (; r < rows; r++) {
+            const float* x = in + (size_t)r * inputs;
+            float* y = out + (size_t)r * outputs;
+            int o = 0;
+            for (; o + 32 <= outputs; o += 32) DenseBlockAVX2<1, 4>(x, inputs, weights, bias, outputs, o, relu, y);
+            for (; o < outputs; o += 8) DenseBlockAVX2<1, 1>(x, inputs, weights, bias, outputs, o, relu, y);
+        }
+    }
+#endif
+
+    static bool Supported(Backend backend) {
+        switch (backend) {
+            case Backend::Scalar:
+                return true;
+            case Backend::SSE:
+                return KERNELS_X86;
+            case Backend::AVX2:
+                #if KERNELS_X86
+                return __builtin_cpu_supports("avx2");
+                #else
+                return false;
+                #endif
+        }
+        return false;
+    }
+
+    static Backend DetectBackend() {
+        if (Supported(Backend::AVX2)) return Backend::AVX2;
+        if (Supported(Backend::SSE)) return Backend::SSE;
+        return Backend::Scalar;
+    }
+
+    static Backend active = DetectBackend();
+
+    Backend ActiveBackend() {
+        return active;
+    }
+
+    const char* BackendName(Backend backend) {
+        switch (backend) {
+            case Backend::Scalar: return "scalar";
+            case Backend::SSE: return "sse";
+            case Backend::AVX2: return "avx2";
+        }
+        return "scalar";
+    }
+
+    void SetBackend(Backend backend) {
+        active = Supported(backend) ? backend : Backend::Scalar;
+    }
+
+    void Integrate(float* x, float* y, const float* vx, const float* vy, int n, float dt) {
+        switch (active) {
+            #if KERNELS_X86
+            case Backend::AVX2: IntegrateAVX2(x, y, vx, vy, n, dt); return;
+            case Backend::SSE: IntegrateSSE(x, y, vx, vy, n, dt); return;
+            #endif
+            default: IntegrateScalar(x, y, vx, vy, 0, n, dt); return;
+        }
+    }
+
+    int OverlapBoxes(const float* x, const float* y, int n, float w, float h, Rectangle rect, uint8_t* mask) {
+        switch (active) {
+            #if KERNELS_X86
+            case Backend::AVX2: return OverlapBoxesAVX2(x, y, n, w, h, rect, mask);
+            case Backend::SSE: return OverlapBoxesSSE(x, y, n, w, h, rect, mask);
+            #endif
+            default: return OverlapBoxesScalar(x, y, 0, n, w, h, rect, mask);
+        }
+    }
+
+    int OverlapCircles(const float* x, const float* y, int n, float radius, Rectangle rect, uint8_t* mask) {
+        switch (active) {
+            #if KERNELS_X86
+            case Backend::AVX2: return OverlapCirclesAVX2(x, y, n, radius, rect, mask);
+            case Backend::SSE: return OverlapCirclesSSE(x, y, n, radius, rect, mask);
+            #endif
+            default: return OverlapCirclesScalar(x, y, 0, n, radius, rect, mask);
+        }
+    }
+
+    void Dense(const float* in, int rows, int inputs, const float* weights, const float* bias, int outputs, bool relu, float* out) {
+        switch (active) {
+            #if KERNELS_X86
+            case Backend::AVX2: DenseAVX2(in, rows, inputs, weights, bias, outputs, relu, out); return;
+            case Backend::SSE: DenseSSE(in, rows, inputs, weights, bias, outputs, relu, out); return;
+            #endif
+            default: DenseScalar(in, rows, inputs, weights, bias, outputs, relu, out); return;
+        }
+    }
+}
+
+// Times the projectile kernels on every backend this CPU supports and checks
+// they agree with the scalar one
+static int RunKernelBench(int count) {
+    std::vector<float> x(count), y(count), vx(count), vy(count);
+    std::vector<uint8_t> expectedBoxes(count), expectedCircles(count), boxMask(count), circleMask(count);
+
+    srand(1);
+    for (int i = 0; i < count; i++) {
+        x[i] = (float)(rand() % WIDTH);
+        y[i] = (float)(rand() % HEIGHT);
+        vx[i] = (float)(rand() % 1000 - 500);
+        vy[i] = (float)(rand() % 1000 - 500);
+    }
+
+    Rectangle target = {WIDTH / 2 - 50, HEIGHT / 2 - 40, 100, 80};
+    const int reps = 200;
+    kernels::Backend original = kernels::ActiveBackend();
+
+    kernels::SetBackend(kernels::Backend::Scalar);
+    kernels::OverlapBoxes(x.data(), y.data(), count, bulletSize.x, bulletSize.y, target, expectedBoxes.data());
+    kernels::OverlapCircles(x.data(), y.data(), count, energyRadius, target, expectedCircles.data());
+
+    for (kernels::Backend backend : {kernels::Backend::Scalar, kernels::Backend::SSE, kernels::Backend::AVX2}) {
+        kernels::SetBackend(backend);
+        if (kernels::ActiveBackend() != backend) continue;
+
+        kernels::OverlapBoxes(x.data(), y.data(), count, bulletSize.x, bulletSize.y, target, boxMask.data());
+        kernels::OverlapCircles(x.data(), y.data(), count, energyRadius, target, circleMask.data());
+        bool matches = boxMask == expectedBoxes && circleMask == expectedCircles;
+
+        // Time on a copy so every backend starts from the same positions
+        std::vector<float> px = x, py = y;
+        auto start = std::chrono::steady_clock::now();
+        int hits = 0;
+        for (int r = 0; r < reps; r++) {
+            kernels::Integrate(px.data(), py.data(), vx.data(), vy.data(), count, 1e-4f);
+            hits += kernels::OverlapBoxes(px.data(), py.data(), count, bulletSize.x, bulletSize.y, target, boxMask.data());
+            hits += kernels::OverlapCircles(px.data(), py.data(), count, energyRadius, target, circleMask.data());
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("%-6s %8.2f ns/projectile per tick  (%d hits, %s)\n",
+            kernels::BackendName(backend), seconds * 1e9 / ((double)reps * count), hits, matches ? "matches scalar" : "MISMATCH");
+    }
+
+    kernels::SetBackend(original);
+    return 0;
+}
+
+int RunKernelBenchCommand(int argc, char** argv) {
+    int count = 0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--kernel-bench" && i + 1 < argc) count = std::atoi(argv[++i]);
+        else {
+            std::printf("usage: main --headless --kernel-bench PROJECTILES\n");
+            return 1;
+        }
+    }
+
+    return RunKernelBench(std::max(1, count));
+}
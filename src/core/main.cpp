@@ -1,7 +1,60 @@
 #include "core/Game.hpp"
+#include "core/Headless.hpp"
+#include "core/BatchRunner.hpp"
+#include "core/Tuner.hpp"
+#include "core/AssetArchive.hpp"
+#include "core/NetSocket.hpp"
+#include "core/config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--headless") {
+        return RunHeadless(argc, argv);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        return RunBatchCommand(argc, argv);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--tune") {
+        return RunTuneCommand(argc, argv);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--pack-assets") {
+        return RunPackCommand(argc, argv);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--bench-load") {
+        return RunLoadBenchCommand(argc, argv);
+    }
 
-int main() {
     Game game;
+
+    // --host [PORT] or --join HOST[:PORT] go straight into a net match,
+    // --spectate HOST[:PORT] into watching a server
+    if (argc > 1 && std::string(argv[1]) == "--host") {
+        uint16_t port = argc > 2 ? (uint16_t)std::atoi(argv[2]) : (uint16_t)NET_DEFAULT_PORT;
+        if (!game.HostNetMatch(port)) return 1;
+    }
+    else if (argc > 2 && std::string(argv[1]) == "--join") {
+        NetAddress host;
+        if (!NetAddress::Parse(argv[2], NET_DEFAULT_PORT, host)) {
+            std::fprintf(stderr, "could not resolve %s\n", argv[2]);
+            return 1;
+        }
+        if (!game.JoinNetMatch(host)) return 1;
+    }
+    else if (argc > 2 && std::string(argv[1]) == "--spectate") {
+        NetAddress server;
+        if (!NetAddress::Parse(argv[2], SPECTATOR_DEFAULT_PORT, server)) {
+            std::fprintf(stderr, "could not resolve %s\n", argv[2]);
+            return 1;
+        }
+        if (!game.Spectate(server)) return 1;
+    }
+
     game.Run();
     return 0;
-}
\ No newline at end of file
+}
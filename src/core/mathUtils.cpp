@@ -19,4 +19,8 @@ namespace math {
     float CrossZ(const Vector2& a, const Vector2& b){
         return a.x * b.y - a.y * b.x;
     }
+
+    Vector2 Lerp(const Vector2& a, const Vector2& b, float t){
+        return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+    }
 }
\ No newline at end of file
@@ -2,24 +2,26 @@
 #include "core/config.h"
 #include "core/spaceship.hpp"
 #include <vector>
-#include "core/ResourceManager.hpp"
+#include <algorithm>
+#include <cmath>
 #include "core/weapons.hpp"
 #include <iostream>
 #include "core/mathUtils.hpp"
+#include "core/batchKernels.hpp"
 
 const float initialHelth = 10.0f;
 const int initialBulletLim = 5;
 const int initialMaxEnergyShots = 1;
 const int initialShipVel = 500; // pixels per second
 const int initialBullVel = 530; // pixels per second
-const Vector2 bulletSize = {15, 5}; // width, height.
 
-Spaceship::Spaceship(const Texture2D& ship, Side side, Sound& shoot, Sound& hit, Texture2D& energyImage, Sound& energyShootingSound, std::unique_ptr<IController> ctrl)
-    : shipImage(ship), shipSide(side), controller(std::move(ctrl)), shootingSound(shoot), hitSound(hit), energyShootSound(energyShootingSound) // These are initialized in the constructor initializer list, since they are references (&)
+Spaceship::Spaceship(const Texture2D& ship, Vector2 size, Side side, uint16_t shipID, Projectiles& pools, IAudioSink& audioSink, const Texture2D& energyImage, std::unique_ptr<IController> ctrl)
+    : shipImage(ship), shipSide(side), id(shipID), projectiles(pools), controller(std::move(ctrl)), audio(audioSink) // pools and audio are initialized in the constructor initializer list, since they are references (&)
     {
-    scale = 0.1f;
-    Vector2 initalPos = side == Side::LEFT ? Vector2{10, 10} : Vector2{(float)WIDTH - 10 - ship.width * scale, (float)HEIGHT - 10 - ship.height * scale};
-    shipRect = {initalPos.x, initalPos.y, (float)ship.width * scale, (float)ship.height * scale};
+    Vector2 initalPos = side == Side::LEFT ? Vector2{10, 10} : Vector2{(float)WIDTH - 10 - size.x, (float)HEIGHT - 10 - size.y};
+    shipRect = {initalPos.x, initalPos.y, size.x, size.y};
+    spawnPos = initalPos;
+    prevPos = initalPos;
     shipVel = initialShipVel;
     bulletVel = initialBullVel;
     health = initialHelth;
@@ -31,10 +33,15 @@ Spaceship::Spaceship(const Texture2D& ship, Side side, Sound& shoot, Sound& hit,
     bulletDamage = 1.0;
 
     energySprite = energyImage;
+    scratch.Reserve(64);
+    bulletHits.reserve(16);
+    energyHits.reserve(16);
+    bulletColor = side == Side::LEFT ? YELLOW : RED;
+    energyColor = side == Side::LEFT ? GREEN : RED;
     rotation = side == Side::RIGHT ? 90.0f : 270.0f; 
 }
 
-bool Spaceship::InBounds(float newX, float newY) {
+bool Spaceship::InBounds(Side shipSide, const Rectangle& shipRect, float newX, float newY) {
     if (shipSide == Side::LEFT) {
         return (newX >= 0 &&
                 newY >= 0 &&
@@ -59,7 +66,7 @@ bool Spaceship::InBounds(float newX, float newY) {
     return false; 
 }
 
-float Spaceship::Accelerate(float current, float target, float& rate, float& dt) {
+float Spaceship::Accelerate(float current, float target, float rate, float dt) {
         if (current < target) {
             return std::min(current + rate * dt, target);
         } else if (current > target) {
@@ -69,6 +76,10 @@ float Spaceship::Accelerate(float current, float target, float& rate, float& dt)
 }
 
 void Spaceship::ApplyMovement(const ControlState& state, float dt) {
+    desiredVelocity = Move(shipRect, velocity, shipSide, shipVel, accel, decel, state, dt);
+}
+
+Vector2 Spaceship::Move(Rectangle& shipRect, Vector2& velocity, Side shipSide, float shipVel, float accel, float decel, const ControlState& state, float dt) {
     Vector2 dir = {state.moveX, state.moveY};
 
     // Add small deadzone since to ensure a zero movement state lerp only approaches zero in PlayerController 
@@ -77,7 +88,7 @@ void Spaceship::ApplyMovement(const ControlState& state, float dt) {
 
     dir = math::NormalizeVec(dir);
 
-    desiredVelocity = {dir.x * shipVel, dir.y * shipVel};
+    Vector2 desiredVelocity = {dir.x * shipVel, dir.y * shipVel};
 
     if (dir.x !=0 || dir.y != 0) {
         velocity.x = Accelerate(velocity.x, desiredVelocity.x, accel, dt);
@@ -91,181 +102,238 @@ void Spaceship::ApplyMovement(const ControlState& state, float dt) {
     float newY = shipRect.y + velocity.y * dt;
 
 
-    if (InBounds(newX, shipRect.y)) {
+    if (InBounds(shipSide, shipRect, newX, shipRect.y)) {
         shipRect.x = newX;
     }
     else {
         velocity.x = 0;
     }
     
-    if (InBounds(shipRect.x, newY)) {
+    if (InBounds(shipSide, shipRect, shipRect.x, newY)) {
         shipRect.y = newY;
     }
     else {
         velocity.y = 0;
     }
+
+    return desiredVelocity;
 }
 
-void Spaceship::Draw() {
+// alpha is how far between the previous and current tick this frame falls
+void Spaceship::Draw(IRenderSink& renderer, float alpha) {
+    Vector2 drawPos = math::Lerp(prevPos, {shipRect.x, shipRect.y}, alpha);
     Rectangle source = {0, 0, (float)shipImage.width, (float)shipImage.height};
     Rectangle dest = {
-        shipRect.x + shipRect.width / 2, 
-        shipRect.y + shipRect.height / 2, 
-        (float)shipImage.width * scale, 
-        (float)shipImage.height * scale};
+        drawPos.x + shipRect.width / 2, 
+        drawPos.y + shipRect.height / 2, 
+        shipRect.width,
+        shipRect.height};
     
     // origin of rotation, about center of ship
     Vector2 origin = {dest.width/2, dest.height/2}; 
-    DrawTexturePro(shipImage, source, dest, origin, rotation, WHITE);
-
-    for (const auto& b : bullets) {
-        DrawRectangleRec(b.rect, b.color);
-    }
-
-    for (auto& e : energyWeapons) {
-        e.Render();
-    }
+    renderer.DrawSprite(shipImage, source, dest, origin, rotation, WHITE);
 
     #if DEBUG
     Rectangle hitbox = GetHitBox();
-    DrawRectangleLinesEx(hitbox, 2, GREEN);
+    hitbox.x += drawPos.x - shipRect.x;
+    hitbox.y += drawPos.y - shipRect.y;
+    renderer.DrawRectLines(hitbox, 2, GREEN);
     #endif
 }
 
 void Spaceship::ShootBullet() {
-    if ((int)bullets.size() < bulletLim) {
-        Bullet b;
-        float bulletX = shipSide == Side::LEFT ? shipRect.x + shipRect.width : shipRect.x;
-        b.pos = {bulletX, shipRect.y + shipRect.height / 2};
-        b.speed = bulletVel;
-        b.active = true;
-        b.rect = {b.pos.x, b.pos.y, bulletSize.x, bulletSize.y};
-        b.damage = bulletDamage;
-        b.color = shipSide == Side::LEFT ? YELLOW : RED;
-        bullets.push_back(b);
-        PlaySound(shootingSound);
-    }
-}
+    if (projectiles.bullets.CountOwnedBy(id) < bulletLim) {
+        Vector2 pos = BulletOrigin(shipRect, shipSide);
+        Vector2 vel = {(shipSide == Side::LEFT ? 1 : -1) * bulletVel, 0};
 
-void Spaceship::ShootEnergy(Spaceship& enemy) {
-
-    if ((int)energyWeapons.size() < maxEnergyShots) {
-        EnergyWeapon EW;
-        EW.pos = {shipRect.x + shipRect.width/2, shipRect.y + shipRect.height/2};;
-        EW.radius = 10;
-        EW.active = true;
-        EW.spriteRotation = 0;
-        Vector2 toTarget = {
-            enemy.shipRect.x + enemy.shipRect.width / 2 - EW.pos.x,
-            enemy.shipRect.y + enemy.shipRect.height / 2 - EW.pos.y
-        };
-        float len = sqrt(toTarget.x*toTarget.x + toTarget.y*toTarget.y);
-        EW.dir = {toTarget.x/len, toTarget.y/len};
-
-        EW.vel = 300;
-        EW.turnSpeed = 7.0f;
-        EW.target = &enemy;
-        EW.color = shipSide == Side::LEFT ? GREEN : RED;
-        EW.timeEmmited = GetTime();
-        EW.damage = energyWeaponDamage;
-        EW.image = energySprite;
-        energyWeapons.push_back(EW);
-        PlaySound(energyShootSound);
+        if (!projectiles.bullets.Spawn(pos, vel, bulletDamage, id, (uint8_t)shipSide).IsNull()) {
+            audio.Play(SoundID::Shoot);
+        }
     }
 }
 
-void Spaceship::HandleEnergyWeapon() {
-    for (auto& e : energyWeapons) {
-        if (e.active) {
-            e.Update();
+void Spaceship::ShootEnergy(Spaceship& enemy, double time) {
+
+    if (projectiles.energy.CountOwnedBy(id) < maxEnergyShots) {
+        Vector2 pos = GetCenter();
+        Vector2 dir = math::NormalizeVec({enemy.GetCenter().x - pos.x, enemy.GetCenter().y - pos.y});
+        Vector2 vel = {dir.x * energySpeed, dir.y * energySpeed};
+
+        if (!projectiles.energy.Spawn(pos, vel, energyWeaponDamage, id, (uint8_t)shipSide, (float)time, enemy.id).IsNull()) {
+            audio.Play(SoundID::EnergyShoot);
         }
     }
+}
 
-    energyWeapons.erase(
-        std::remove_if(energyWeapons.begin(), energyWeapons.end(),
-                       [](const EnergyWeapon& e){ return !e.active; }),
-        energyWeapons.end()
-    );
+// Marks the enemy projectiles that hit this ship. The world removes them
+// once every ship has been checked. ships is indexed by ship id, to credit
+// the shooter with the kill.
+void Spaceship::HandleBeingShot(const std::vector<std::unique_ptr<Spaceship>>& ships) {
+    FindHits();
+    ApplyHits(ships);
 }
 
-void Spaceship::HandleBullets() {
-    float dt = GetFrameTime();
+// Collects the projectiles overlapping this ship. Only the ones the grid puts
+// near the hitbox are tested, in one batch per pool
+void Spaceship::FindHits() {
+    Rectangle hitBox = GetHitBox();
+    bulletHits.clear();
+    energyHits.clear();
+
+    const ProjectilePool& bullets = projectiles.bullets;
+    projectiles.bulletGrid.QueryRect(hitBox, scratch.indices);
+    int candidates = SpatialGrid::Gather(bullets.x.data(), bullets.y.data(), scratch);
+    int hits = kernels::OverlapBoxes(scratch.x.data(), scratch.y.data(), candidates,
+                                     bulletSize.x, bulletSize.y, hitBox, scratch.mask.data());
+    for (int k = 0; k < candidates && hits > 0; k++) {
+        if (!scratch.mask[k]) continue;
+        hits--;
+
+        int i = scratch.indices[k];
+        if (bullets.team[i] != (uint8_t)shipSide) bulletHits.push_back(i);
+    }
 
-    for (auto &b : bullets) {
-        if (b.active) {
-            b.pos.x += (shipSide == Side::LEFT ? 1 : -1) * b.speed * dt;
-            b.rect.x = b.pos.x;
-            b.rect.y = b.pos.y;
-            if (b.pos.x < -10 || b.pos.x > WIDTH) b.active = false;
-        }
+    const ProjectilePool& energy = projectiles.energy;
+    projectiles.energyGrid.QueryRect(shipRect, scratch.indices);
+    candidates = SpatialGrid::Gather(energy.x.data(), energy.y.data(), scratch);
+    hits = kernels::OverlapCircles(scratch.x.data(), scratch.y.data(), candidates,
+                                   energyRadius, shipRect, scratch.mask.data());
+    for (int k = 0; k < candidates && hits > 0; k++) {
+        if (!scratch.mask[k]) continue;
+        hits--;
+
+        int i = scratch.indices[k];
+        if (energy.team[i] != (uint8_t)shipSide) energyHits.push_back(i);
     }
+}
 
-    bullets.erase(
-            std::remove_if(bullets.begin(), bullets.end(),
-            [](const Bullet& b) {return !b.active; }),
-            bullets.end()
-        );
+// Covers the heights the AI asks about: its own or one tick's move up or
+// down, give or take 0.6 ship heights
+void Spaceship::AnalyzeThreats(const TeamThreats& incoming, float dt) {
+    threats.Analyze(shipRect, (uint8_t)shipSide, shipRect.height * 0.6f + shipVel * dt, incoming, projectiles);
 }
 
-void Spaceship::HandleBeingShot(Spaceship& enemy) {
-    // Handle Bullets
-    for (auto& b : enemy.bullets) {
-        if (CheckCollisionRecs(GetHitBox(), b.rect)) {
-            health -= b.damage;
-            b.active = false;
-            if (IsDead()) enemy.score++;
-            PlaySound(hitSound);
-        }
+// Takes damage from the hits FindHits collected. A projectile already used
+// up on a ship that applied its hits earlier this tick is skipped.
+void Spaceship::ApplyHits(const std::vector<std::unique_ptr<Spaceship>>& ships) {
+    ProjectilePool& bullets = projectiles.bullets;
+    for (int i : bulletHits) {
+        if (bullets.IsMarked(i)) continue;
+
+        bool wasAlive = !IsDead();
+        health -= bullets.damage[i];
+        ships[bullets.owner[i]]->damageDealt += bullets.damage[i];
+        bullets.MarkForRemoval(i);
+        if (wasAlive && IsDead()) ships[bullets.owner[i]]->score++;
+        audio.Play(SoundID::Hit);
     }
 
-    // Handle Energy Weapons
-    for (auto& e : enemy.energyWeapons) {
-        if (CheckCollisionCircleRec(e.pos, e.radius, shipRect)){
-            health -= e.damage;
-            e.active = false;
-            if (IsDead()) enemy.score++;
-            PlaySound(hitSound);
-        }
+    ProjectilePool& energy = projectiles.energy;
+    for (int i : energyHits) {
+        if (energy.IsMarked(i)) continue;
+
+        bool wasAlive = !IsDead();
+        health -= energy.damage[i];
+        ships[energy.owner[i]]->damageDealt += energy.damage[i];
+        energy.MarkForRemoval(i);
+        if (wasAlive && IsDead()) ships[energy.owner[i]]->score++;
+        audio.Play(SoundID::Hit);
     }
 }
 
-void Spaceship::ApplyShooting(const ControlState& state, Spaceship& enemy) {
+void Spaceship::ApplyShooting(const ControlState& state, const SimClock& clock) {
     if (state.shootBullet) {
         ShootBullet();
     }
 
-    if (state.shootEnergy) {
-        ShootEnergy(enemy);
+    if (state.shootEnergy && target) {
+        ShootEnergy(*target, clock.time);
     }
+}
 
-    HandleBullets();
-    HandleEnergyWeapon();
+// Thinks, moves and fires. Projectiles are moved and collided by the world
+// once every ship has acted.
+void Spaceship::Update(const SimClock& clock) {
+    Think(clock);
+    Act(clock);
 }
 
-void Spaceship::Update(float dt, Spaceship& enemy) {
-    ControlState state = controller->GetState();
+void Spaceship::Think(const SimClock& clock) {
+    pendingState = QuantizeControl(controller->GetState(clock));
+}
+
+void Spaceship::Coast() {
+    pendingState.shootBullet = false;
+    pendingState.shootEnergy = false;
+}
+
+void Spaceship::Act(const SimClock& clock) {
+    ApplyMovement(pendingState, clock.dt);
+    ApplyShooting(pendingState, clock);
+}
 
-    ApplyMovement(state, dt);
-    ApplyShooting(state, enemy);
-    HandleBeingShot(enemy);
+const ControlState& Spaceship::GetControlState() const {
+    return pendingState;
+}
+
+void Spaceship::SaveState(ByteWriter& out) const {
+    out.F32(shipRect.x);
+    out.F32(shipRect.y);
+    out.F32(velocity.x);
+    out.F32(velocity.y);
+    out.F32(health);
+    out.F32(damageDealt);
+    out.Varint((uint64_t)score);
+    out.F32(pendingState.moveX);
+    out.F32(pendingState.moveY);
+}
+
+void Spaceship::LoadState(ByteReader& in) {
+    shipRect.x = in.F32();
+    shipRect.y = in.F32();
+    velocity.x = in.F32();
+    velocity.y = in.F32();
+    health = in.F32();
+    damageDealt = in.F32();
+    score = (int)in.Varint();
+    pendingState = ControlState();
+    pendingState.moveX = in.F32();
+    pendingState.moveY = in.F32();
+    prevPos = {shipRect.x, shipRect.y};
+}
+
+// Remembers where the ship was before this tick moves it
+void Spaceship::SavePreviousState() {
+    prevPos = {shipRect.x, shipRect.y};
 }
 
 void Spaceship::Reset() {
     health = initialHelth;
-    Vector2 initalPos = shipSide == Side::LEFT ? Vector2{10, 10} : Vector2{(float)WIDTH - 10 - shipImage.width * scale, (float)HEIGHT - 10 - shipImage.height * scale};
-    shipRect = {initalPos.x, initalPos.y, (float)shipImage.width * scale, (float)shipImage.height * scale};
-    // Clear bullets
-    bullets.clear();
-    std::vector<Bullet>().swap(bullets);
-    energyWeapons.clear();
-    std::vector<EnergyWeapon>().swap(energyWeapons);
+    damageDealt = 0.0f;
+    shipRect.x = spawnPos.x;
+    shipRect.y = spawnPos.y;
+    prevPos = spawnPos;
+    velocity = {0, 0};
+    desiredVelocity = {0, 0};
+    pendingState = ControlState();
+}
+
+void Spaceship::SetSpawnPosition(Vector2 pos) {
+    spawnPos = pos;
+    shipRect.x = pos.x;
+    shipRect.y = pos.y;
+    prevPos = pos;
 }
 
-bool Spaceship::IsDead() { 
+bool Spaceship::IsDead() const { 
     return health <= 0;
 }
 
-Rectangle Spaceship::GetHitBox() const{
+Rectangle Spaceship::GetHitBox() const {
+    return HitBox(shipRect);
+}
+
+Rectangle Spaceship::HitBox(const Rectangle& shipRect) {
     float shrinkFactor = 0.6f; // slightly smaller rectangle than shiprect
     float offsetX = (1.0f - shrinkFactor) / 2 * shipRect.width;
     float offsetY = (1.0f - shrinkFactor) / 2 * shipRect.height;
@@ -277,3 +345,12 @@ Rectangle Spaceship::GetHitBox() const{
         shipRect.height * shrinkFactor
     };
 }
+
+Vector2 Spaceship::BulletOrigin(const Rectangle& shipRect, Side shipSide) {
+    float bulletX = shipSide == Side::LEFT ? shipRect.x + shipRect.width : shipRect.x;
+    return {bulletX, shipRect.y + shipRect.height / 2};
+}
+
+Vector2 Spaceship::GetCenter() const {
+    return {shipRect.x + shipRect.width / 2, shipRect.y + shipRect.height / 2};
+}
@@ -1,77 +1,74 @@
 #include "raylib.h"
-#include "core/spaceship.hpp"
+#include "core/config.h"
 #include "core/weapons.hpp"
-#include <iostream>
 #include <cmath>
 #include "core/mathUtils.hpp"
+#include "core/batchKernels.hpp"
 
-void EnergyWeapon::Render() {
-    Rectangle src = {0, 0, (float)image.width, (float)image.height};
-    Rectangle dest = {pos.x, pos.y, (float)image.width, (float)image.height};
+namespace weapons {
+    void UpdateBullets(ProjectilePool& bullets, float dt) {
+        MoveBullets(bullets, dt, 0, bullets.Count());
+        CullBullets(bullets);
+    }
 
-    Vector2 origin = {(float)image.width / 2, (float)image.height / 2};
+    void MoveBullets(ProjectilePool& bullets, float dt, int begin, int end) {
+        kernels::Integrate(bullets.x.data() + begin, bullets.y.data() + begin,
+                           bullets.vx.data() + begin, bullets.vy.data() + begin, end - begin, dt);
+    }
 
-    DrawTexturePro(image, src, dest, origin, spriteRotation, color);
+    void CullBullets(ProjectilePool& bullets) {
+        // Walk backwards so a swap-remove only moves in projectiles already checked
+        for (int i = bullets.Count() - 1; i >= 0; i--) {
+            if (bullets.x[i] < -10 || bullets.x[i] > WIDTH) {
+                bullets.Remove(i);
+            }
+        }
+    }
 
-    #if DEBUG
-    DrawCircleV(pos, radius, Fade(color, 0.5f));
-    #endif
-}
+    void UpdateEnergyWeapons(ProjectilePool& energy, const SimClock& clock, const Vector2* shipCenters) {
+        MoveEnergyWeapons(energy, clock, shipCenters, 0, energy.Count());
+        CullEnergyWeapons(energy);
+    }
 
-void EnergyWeapon::UpdateDirection() {
-    Vector2 toTarget = {
-        target->shipRect.x + target->shipRect.width / 2 - pos.x,
-        target->shipRect.y + target->shipRect.height / 2 - pos.y
-    };
+    void MoveEnergyWeapons(ProjectilePool& energy, const SimClock& clock, const Vector2* shipCenters, int begin, int end) {
+        float dt = clock.dt;
 
-    toTarget = math::NormalizeVec(toTarget);
+        for (int i = begin; i < end; i++) {
+            if (clock.time - energy.spawnTime[i] > energyHomingDuration) {
+                energy.homing[i] = 0;
+            }
 
-    // Blend current direction toward target direction
-    float dt = GetFrameTime();
-    float homingStrength = 5.0f; // tweak this higher/lower to adjust responsiveness
+            if (energy.homing[i]) {
+                Vector2 dir = EnergyDirection(energy, i);
+                float speed = sqrtf(energy.vx[i] * energy.vx[i] + energy.vy[i] * energy.vy[i]);
 
-    dir.x += (toTarget.x - dir.x) * homingStrength * dt;
-    dir.y += (toTarget.y - dir.y) * homingStrength * dt;
+                Vector2 targetCenter = shipCenters[energy.target[i]];
+                Vector2 toTarget = math::NormalizeVec({targetCenter.x - energy.x[i], targetCenter.y - energy.y[i]});
 
-    dir = math::NormalizeVec(dir);
-}
+                // Blend current direction toward target direction
+                dir.x += (toTarget.x - dir.x) * energyHomingStrength * dt;
+                dir.y += (toTarget.y - dir.y) * energyHomingStrength * dt;
 
-void EnergyWeapon::UpdateSpriteRotation() {
-    spriteRotation = std::atan2(dir.y, dir.x) * 180 / M_PI;
+                dir = math::NormalizeVec(dir);
+                energy.vx[i] = dir.x * speed;
+                energy.vy[i] = dir.y * speed;
+            }
+        }
 
-    // extra 180 degrees rotation when is the sprite is being fired from the right hand ship
-    if (target->shipSide == Side::LEFT) {
-        spriteRotation += 180;
+        kernels::Integrate(energy.x.data() + begin, energy.y.data() + begin,
+                           energy.vx.data() + begin, energy.vy.data() + begin, end - begin, dt);
     }
-}
-
-void EnergyWeapon::Move() {
-    float dt = GetFrameTime();
 
-    pos.x += dir.x * vel * dt;
-    pos.y += dir.y * vel * dt;
-}
-
-// Helper Function to update active and is homing status
-void EnergyWeapon::UpdateStatus() {
-    if (GetTime() - timeEmmited > homingDuration) {
-        isHoming = false;
+    void CullEnergyWeapons(ProjectilePool& energy) {
+        for (int i = energy.Count() - 1; i >= 0; i--) {
+            bool outOfBounds = energy.x[i] < 0 || energy.x[i] > WIDTH || energy.y[i] < 0 || energy.y[i] > HEIGHT;
+            if (outOfBounds && !energy.homing[i]) {
+                energy.Remove(i);
+            }
+        }
     }
-    bool inBounds = pos.x < 0 || pos.x > WIDTH || pos.y < 0 || pos.y > HEIGHT;
-    if (inBounds && !isHoming) {
-        active = false;
-    }
-
-}
-
-void EnergyWeapon::Update() {
-    if (!active) return;
 
-    UpdateStatus();
-
-    if (isHoming){ // Homing only lasts for 5 seconds
-        UpdateDirection();
-        UpdateSpriteRotation();
+    Vector2 EnergyDirection(const ProjectilePool& energy, int i) {
+        return math::NormalizeVec({energy.vx[i], energy.vy[i]});
     }
-    Move();
-}
\ No newline at end of file
+}
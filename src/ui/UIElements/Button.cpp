@@ -40,4 +40,11 @@ namespace ui{
     bool Button::WasClicked() const {
         return clicked;
     }
+
+    void Button::SetText(const std::string& newText) {
+        float centerX = bounds.x + bounds.width / 2;
+        text = newText;
+        bounds.width = (float)MeasureText(text.c_str(), fontSize);
+        bounds.x = centerX - bounds.width / 2;
+    }
 }
\ No newline at end of file